@@ -0,0 +1,69 @@
+#include <unicodedata.h>
+
+#include <cstdio>
+
+#include "common.h"
+
+using namespace commonlib2;
+
+bool get_case_kind(const std::string &name, CaseKind &kind) {
+    const char *names[] = {"lower", "upper", "title", "fold", "simplefold"};
+    for (auto i = 0; i < case_kind_count; i++) {
+        if (name == names[i]) {
+            kind = (CaseKind)i;
+            return true;
+        }
+    }
+    Clog << "error:unknown case:" << name << " (lower|upper|title|fold|simplefold)\n";
+    return false;
+}
+
+//convert utf-8 from fp by blocks. each block is cut before the last code point which is neither cased
+//nor case ignorable, so title case and final sigma see the same context as the whole text
+int case_stream(const CaseTable &table, CaseKind kind, FILE *fp) {
+    std::string out;
+    return read_utf8_blocks(fp, [&](const char *in, size_t len, size_t, bool eof) {
+        auto cut = eof ? len : table.last_break(in, len);
+        if (!cut && len >= utf8_stream_block) {
+            //no break in a whole block. context is lost only at this cut
+            cut = len;
+        }
+        out.clear();
+        table.convert(kind, in, cut, out);
+        Cout.write(out.data(), out.size());
+        return cut;
+    });
+}
+
+int case_text(int argc, char **argv, int i) {
+    TextOptions opt;
+    if (!parse_text_options(i, argc, argv, opt)) {
+        return -1;
+    }
+    if (i >= argc) {
+        Clog << "error: need more argument\n";
+        return -1;
+    }
+    CaseKind kind;
+    if (!get_case_kind(argv[i], kind)) {
+        return -1;
+    }
+    i++;
+    const CaseTable *table = nullptr;
+    std::string out;
+    TextCommand cmd;
+    cmd.failure = "failed to build case table";
+    cmd.load = [&](UnicodeData &data) {
+        table = &get_case_table(data);
+        return table->built;
+    };
+    cmd.stream = [&](FILE *fp) {
+        return case_stream(*table, kind, fp);
+    };
+    cmd.word = [&](const char *str, size_t size) {
+        out.clear();
+        table->convert(kind, str, size, out);
+        Cout << out << "\n";
+    };
+    return run_text_command(opt, i, argc, argv, cmd);
+}
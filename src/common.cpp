@@ -1,5 +1,16 @@
 #include "common.h"
 
+#include <unicodedata.h>
+#include <utf_bulk.h>
+
+#include <cstdio>
+#include <thread>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
 using namespace commonlib2;
 
 bool get_morearg(std::string &output, int &i, int argc, char **argv) {
@@ -12,6 +23,163 @@ bool get_morearg(std::string &output, int &i, int argc, char **argv) {
     return true;
 }
 
+HUNICODEDATA open_unicodedata(std::string &infile, bool bin) {
+    if (!infile.size()) {
+        infile = "./unicodedata.txt or ./unicodedata.bin";
+        return get_default_unicodedata();
+    }
+    if (bin) {
+        return unicodedata_from_binary(infile.c_str());
+    }
+    Cout << "as text\n";
+    return unicodedata_from_text(infile.c_str());
+}
+
+size_t utf8_incomplete_tail(const char *p, size_t size) {
+    for (size_t back = 1; back <= 3 && back <= size; back++) {
+        auto c = (unsigned char)p[size - back];
+        if ((c & 0xc0) == 0x80) continue;
+        size_t need = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+        return need > back ? back : 0;
+    }
+    return 0;
+}
+
+FILE *open_input(const std::string &name) {
+    if (name == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        return stdin;
+    }
+    FILE *fp = nullptr;
+#ifdef _WIN32
+    std::wstring path;
+    Reader(name) >> path;
+    _wfopen_s(&fp, path.c_str(), L"rb");
+#else
+    fp = ::fopen(name.c_str(), "rb");
+#endif
+    if (!fp) {
+        Clog << "error:file " << name << " couldn't open\n";
+    }
+    return fp;
+}
+
+void close_input(FILE *fp) {
+    if (fp && fp != stdin) {
+        ::fclose(fp);
+    }
+}
+
+bool get_threads(size_t &threads, int &i, int argc, char **argv) {
+    std::string tmp;
+    if (!get_morearg(tmp, i, argc, argv)) {
+        return false;
+    }
+    size_t num = ~0;
+    Reader(tmp) >> num;
+    if (num == ~0) {
+        Clog << "error:not number:" << tmp << "\n";
+        return false;
+    }
+    threads = num ? num : std::thread::hardware_concurrency();
+    return true;
+}
+
+bool parse_text_options(int &i, int argc, char **argv, TextOptions &opt, const std::function<int(char c, int &i)> &extra) {
+    for (; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg[0] != '-') break;
+        for (auto c : std::string_view(arg).substr(1)) {
+            auto took = extra ? extra(c, i) : 0;
+            if (took < 0) {
+                return false;
+            }
+            else if (took) {
+                continue;
+            }
+            else if (!opt.infile.size() && (c == 't' || c == 'b')) {
+                if (!get_morearg(opt.infile, i, argc, argv)) {
+                    return false;
+                }
+                opt.bin = c == 'b';
+            }
+            else if (!opt.input.size() && c == 'i') {
+                if (!get_morearg(opt.input, i, argc, argv)) {
+                    return false;
+                }
+            }
+            else if (!opt.output && c == 'o') {
+                if (!openfile(i, argc, argv)) {
+                    return false;
+                }
+                opt.output = true;
+            }
+            else {
+                Clog << "warning: ignored '" << c << "'\n";
+            }
+        }
+    }
+    return true;
+}
+
+int run_text_command(TextOptions &opt, int i, int argc, char **argv, const TextCommand &cmd) {
+    HUNICODEDATA data = open_unicodedata(opt.infile, opt.bin);
+    if (!data) {
+        Clog << "error:failed to load unicodedata from " << opt.infile << "\n";
+        return -1;
+    }
+    if (!cmd.load(*(UnicodeData *)data)) {
+        Clog << "error:" << cmd.failure << "\n";
+        release_unicodedata(data);
+        return -1;
+    }
+    auto ret = 0;
+    if (opt.input.size()) {
+        auto fp = open_input(opt.input);
+        ret = fp ? cmd.stream(fp) : -1;
+        close_input(fp);
+    }
+    else {
+        for (; i < argc; i++) {
+            auto size = ::strlen(argv[i]);
+            auto res = utf8_validate(Sized<const char>{argv[i], size});
+            if (res.err) {
+                Clog << "warning: invalid utf8 sequence at offset " << res.read << " of " << argv[i] << "\n";
+                continue;
+            }
+            cmd.word(argv[i], size);
+        }
+    }
+    release_unicodedata(data);
+    return ret;
+}
+
+int read_utf8_blocks(FILE *fp, const std::function<size_t(const char *in, size_t len, size_t offset, bool eof)> &f,
+                     bool lossy) {
+    std::string in(utf8_stream_block, 0);
+    size_t carry = 0, offset = 0;
+    while (true) {
+        if (in.size() - carry < utf8_stream_block) {
+            in.resize(carry + utf8_stream_block);
+        }
+        auto size = carry + ::fread(&in[carry], 1, utf8_stream_block, fp);
+        auto eof = size == carry;
+        auto len = size - (eof ? 0 : utf8_incomplete_tail(in.data(), size));
+        if (auto res = lossy ? UTFResult{} : utf8_validate(Sized<const char>{in.data(), len}); res.err) {
+            Clog << "error:invalid utf8 sequence at offset " << offset + res.read << "\n";
+            return -1;
+        }
+        auto took = f(in.data(), len, offset, eof);
+        if (eof) break;
+        offset += took;
+        ::memmove(&in[0], &in[took], size - took);
+        carry = size - took;
+    }
+    return 0;
+}
+
 bool openfile(int &i, int argc, char **argv) {
     std::string output;
     if (!get_morearg(output, i, argc, argv)) {
@@ -84,6 +252,20 @@ void print_codeinfo(CODEINFO info, bool u8, bool few) {
     }
 }
 
+void print_replace_report(const UTFErrorReport &report, size_t unit) {
+    if (!report.count) {
+        return;
+    }
+    Clog << "warning:" << report.count << " invalid sequences replaced with U+FFFD\n";
+    auto stored = report.count < report.max_offsets ? report.count : report.max_offsets;
+    for (size_t i = 0; i < stored; i++) {
+        Clog << "    at offset " << report.offsets[i] * unit << "\n";
+    }
+    if (report.count > stored) {
+        Clog << "    ...\n";
+    }
+}
+
 bool get_range(const char *str, uint32_t &begin, uint32_t &end, const char *msg) {
     begin = ~0, end = ~0;
     Reader f(str);
@@ -186,4 +368,55 @@ bool logic_parse(int &i, int argc, char **argv, Logic &logic) {
         return false;
     }
     return true;
-}
\ No newline at end of file
+}
+
+CodeSet logic_compile(const Logic &logic, HUNICODEDATA data) {
+    auto &udata = *(UnicodeData *)data;
+    auto &sets = get_property_sets(udata);
+    auto values = [&](PropertyKind kind, bool strict) {
+        CodeSet ret;
+        for (size_t id = 0; id < sets.sets[kind].size(); id++) {
+            std::string_view name = udata.flat.property(kind, (std::uint32_t)id);
+            if (strict ? name == logic.str : name.find(logic.str) != ~0) {
+                ret = CodeSet::unite(ret, sets.sets[kind][id]);
+            }
+        }
+        return ret;
+    };
+    auto within = [&](uint32_t first, uint32_t last) {
+        CodeSet ret;
+        if (first <= last && first < codepoint_limit) {
+            ret.add(first, (std::min)(last, (uint32_t)codepoint_limit - 1));
+        }
+        return CodeSet::intersect(sets.assigned, ret);
+    };
+    switch (logic.type) {
+        case LogicType::and_:
+            return CodeSet::intersect(logic_compile(logic.child[0], data), logic_compile(logic.child[1], data));
+        case LogicType::or_:
+            return CodeSet::unite(logic_compile(logic.child[0], data), logic_compile(logic.child[1], data));
+        case LogicType::not_:
+            return CodeSet::subtract(sets.assigned, logic_compile(logic.child[0], data));
+        case LogicType::range:
+            return within(logic.code1, logic.code2);
+        case LogicType::code:
+            return within(logic.code1, logic.code1);
+        case LogicType::strict:
+        case LogicType::name: {
+            CodeSet ret;
+            std::vector<CodeInterval> hits;
+            get_name_index(udata).find(logic.str, logic.type == LogicType::strict, hits);
+            for (auto &hit : hits) {
+                ret.add(hit.first, hit.second);
+            }
+            return ret;
+        }
+        case LogicType::category:
+            return values(property_category, false);
+        case LogicType::block:
+            return values(property_block, true);
+        case LogicType::includes:
+            return values(property_block, false);
+    }
+    return CodeSet();
+}
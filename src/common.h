@@ -2,6 +2,10 @@
 #include <coutwrapper.h>
 #include <extension_operator.h>
 
+#include <unicodedata.h>
+
+#include <cstdio>
+#include <functional>
 #include <vector>
 #define DLL_EXPORT __declspec(dllexport)
 #include "runtime.h"
@@ -26,37 +30,16 @@ struct Logic {
     uint32_t code1 = ~0;
     uint32_t code2 = ~0;
     std::vector<Logic> child;
-
-    bool operator()(uint32_t code, const char *name, const char *category, const char *block) {
-        switch (type) {
-            case LogicType::and_:
-                return child[0](code, name, category, block) && child[1](code, name, category, block);
-            case LogicType::or_:
-                return child[0](code, name, category, block) || child[1](code, name, category, block);
-            case LogicType::not_:
-                return !child[0](code, name, category, block);
-            case LogicType::range:
-                return code >= code1 && code <= code2;
-            case LogicType::strict:
-                return str == name;
-            case LogicType::name:
-                return std::string(name).find(str) != ~0;
-            case LogicType::code:
-                return code1 == code;
-            case LogicType::category:
-                return std::string(category).find(str) != ~0;
-            case LogicType::block:
-                return str == block;
-            case LogicType::includes:
-                return std::string(block).find(str) != ~0;
-        }
-    }
 };
 
 void print_u8str(CODEINFO info, bool noline, const char *prefix = "raw: ");
 void print_codeinfo(CODEINFO info, bool u8, bool few);
 bool get_code(const char *str, uint32_t &code, const char *msg = "warning");
 bool logic_parse(int &i, int argc, char **argv, Logic &logic);
+//evaluate whole expression once as set algebra over assigned code points
+commonlib2::CodeSet logic_compile(const Logic &logic, HUNICODEDATA data);
+//warn count and first offsets (in bytes of unit sized input) of lossy decoding
+void print_replace_report(const commonlib2::UTFErrorReport &report, size_t unit);
 bool get_range(const char *str, uint32_t &begin, uint32_t &end, const char *msg = "warning");
 
 int binarymake(int argc, char **argv, int i);
@@ -65,8 +48,74 @@ bool get_morearg(std::string &output, int &i, int argc, char **argv);
 
 bool openfile(int &i, int argc, char **argv);
 
-int search(int argc, char **argv, int i = 2, bool rnflag = false);
+//parse argument of -j as count of threads (0 is hardware concurrency)
+bool get_threads(size_t &threads, int &i, int argc, char **argv);
+
+//load unicodedata from infile (bin or text) or default files if infile is empty (infile is set to them)
+HUNICODEDATA open_unicodedata(std::string &infile, bool bin);
+
+//open name ("-" is stdin) for binary reading. print error and return nullptr on failure
+FILE *open_input(const std::string &name);
+void close_input(FILE *fp);
+
+//bytes at the end of p which begin an incomplete utf-8 sequence
+size_t utf8_incomplete_tail(const char *p, size_t size);
+
+//options shared by text commands: -t/-b <file> (unicodedata), -i <file> (streaming input) and -o <file>
+struct TextOptions {
+    std::string infile;
+    std::string input;
+    bool bin = false;
+    bool output = false;
+};
+
+//parse leading options of a text command and leave i at the first word. other flags go to extra,
+//which returns 1 if it took the flag, 0 if not and -1 on error
+bool parse_text_options(int &i, int argc, char **argv, TextOptions &opt,
+                        const std::function<int(char c, int &i)> &extra = nullptr);
+
+//derived table of a text command and what the command does with text
+struct TextCommand {
+    //get the table from data. false if it is not built
+    std::function<bool(commonlib2::UnicodeData &data)> load;
+    //error printed when load fails
+    std::string failure;
+    //text of -i <file>
+    std::function<int(FILE *fp)> stream;
+    //each valid utf-8 word of the command line
+    std::function<void(const char *str, size_t size)> word;
+};
+
+//load unicodedata of opt and the table of cmd, run text of -i or argv[i..] through cmd and release them
+int run_text_command(TextOptions &opt, int i, int argc, char **argv, const TextCommand &cmd);
+
+constexpr size_t utf8_stream_block = 1 << 20;
+
+//read utf-8 from fp by blocks and call f(in, len, offset, eof) with validated whole code points at offset of
+//the input. f returns how many bytes it took and the rest is carried to the next block.
+//invalid sequence is reported with its offset and returns -1, unless lossy leaves it to f
+int read_utf8_blocks(FILE *fp, const std::function<size_t(const char *in, size_t len, size_t offset, bool eof)> &f,
+                     bool lossy = false);
+
+//threads is the default of -j
+int search(int argc, char **argv, int i = 2, bool rnflag = false, size_t threads = 1);
 
 int utfshow(std::string &cmd, int argc, char **argv, int i);
 
-int random_gen(int argc, char **argv, int i);
\ No newline at end of file
+int random_gen(int argc, char **argv, int i);
+
+int file_encoder(int argc, char **argv, int i);
+
+int file_length(int argc, char **argv, int i);
+
+int normalize_text(int argc, char **argv, int i);
+
+int case_text(int argc, char **argv, int i);
+
+int graphemes_text(int argc, char **argv, int i);
+
+int width_text(int argc, char **argv, int i);
+
+int segment_text(int argc, char **argv, int i);
+
+int scripts_text(int argc, char **argv, int i);
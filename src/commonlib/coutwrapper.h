@@ -155,6 +155,33 @@ namespace PROJECT_NAME {
             return *this;
         }
 
+        //write utf-8 block without formatting
+        StdOutWrapper& write(const char* p, size_t size) {
+            if (onlybuffer) {
+                ss.write(p, size);
+                return *this;
+            }
+            if (fout != base) {
+                fwrite(p, 1, size, fout);
+                if (!multiout) {
+                    return *this;
+                }
+            }
+            if (cb) {
+                cb(p, size, ctx);
+                return *this;
+            }
+            if (!Able_continue()) throw std::runtime_error("not called IOWrapper::Init() before io function");
+#ifdef _WIN32
+            std::wstring tmp;
+            Reader(std::string(p, size)) >> tmp;
+            fwrite(tmp.c_str(), sizeof(tmp[0]), tmp.size(), base);
+#else
+            fwrite(p, 1, size, base);
+#endif
+            return *this;
+        }
+
        private:
         bool open_detail(FILE** pfp, const char* filename) {
             fopen_s(pfp, filename, "w");
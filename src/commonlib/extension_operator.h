@@ -10,6 +10,7 @@
 #include <type_traits>
 
 #include "basic_helper.h"
+#include "utf_bulk.h"
 #include "utf_helper.h"
 #include "utfreader.h"
 
@@ -76,6 +77,32 @@ namespace PROJECT_NAME {
     template<class Buf,size_t size>
     inline constexpr bool bcsizeeq=size==b_char_size_v<Buf>;*/
 
+    //transcode rest of r at once by utf_bulk.h when both ends are contiguous memory.
+    //returns false with r and str untouched if not applicable or input is invalid (unit-wise path handles it)
+    template <class Buf, class Str>
+    std::enable_if_t<is_contiguous_buf<remove_cv_ref<Buf>>::value && is_resizable_buf<Str>::value, bool>
+    output_str_bulk(Reader<Buf>& r, Str& str) {
+        auto size = r.readable();
+        if (size == 0) return false;
+        auto src = contiguous_data(r.ref()) + r.readpos();
+        auto old = str.size();
+        str.resize(old + utf_output_bound(size, sizeof(src[0]), sizeof(str[0])));
+        auto res = utf_transcode(src, size, str.data() + old, str.size() - old);
+        if (res.err) {
+            str.resize(old);
+            return false;
+        }
+        str.resize(old + res.written);
+        r.seekend();
+        return true;
+    }
+
+    template <class Buf, class Str>
+    std::enable_if_t<!is_contiguous_buf<remove_cv_ref<Buf>>::value || !is_resizable_buf<Str>::value, bool>
+    output_str_bulk(Reader<Buf>&, Str&) {
+        return false;
+    }
+
     template <class Buf, class Str>
     auto& output_str(Reader<std::enable_if_t<bcsizeeq<Buf, 1>, Buf>>&& r, std::enable_if_t<bcsizeeq<Str, 1>, Str>& str) {
         //if CONSTEXPRIF(bcsizeeq<Str,1>){
@@ -95,6 +122,7 @@ namespace PROJECT_NAME {
 
     template <class Buf, class Str>
     auto& output_str(Reader<std::enable_if_t<bcsizeeq<Buf, 1>, Buf>>&& r, std::enable_if_t<bcsizeeq<Str, 2>, Str>& str) {
+        if (output_str_bulk(r, str)) return r;
         int ctx = 0;
         r.readwhile(str, utf8toutf16, &ctx);
         return r;
@@ -102,6 +130,7 @@ namespace PROJECT_NAME {
 
     template <class Buf, class Str>
     auto& output_str(Reader<std::enable_if_t<bcsizeeq<Buf, 1>, Buf>>&& r, std::enable_if_t<bcsizeeq<Str, 4>, Str>& str) {
+        if (output_str_bulk(r, str)) return r;
         int ctx = 0;
         r.readwhile(str, utf8toutf32, &ctx);
         return r;
@@ -109,6 +138,7 @@ namespace PROJECT_NAME {
 
     template <class Buf, class Str>
     auto& output_str(Reader<std::enable_if_t<bcsizeeq<Buf, 2>, Buf>>&& r, std::enable_if_t<bcsizeeq<Str, 1>, Str>& str) {
+        if (output_str_bulk(r, str)) return r;
         //if CONSTEXPRIF(bcsizeeq<Str,1>){
         int ctx = 0;
         r.readwhile(str, utf16toutf8, &ctx);
@@ -133,6 +163,7 @@ namespace PROJECT_NAME {
 
     template <class Buf, class Str>
     auto& output_str(Reader<std::enable_if_t<bcsizeeq<Buf, 2>, Buf>>&& r, std::enable_if_t<bcsizeeq<Str, 4>, Str>& str) {
+        if (output_str_bulk(r, str)) return r;
         int ctx = 0;
         r.readwhile(str, utf16toutf32, &ctx);
         return r;
@@ -140,6 +171,7 @@ namespace PROJECT_NAME {
 
     template <class Buf, class Str>
     auto& output_str(Reader<std::enable_if_t<bcsizeeq<Buf, 4>, Buf>>&& r, std::enable_if_t<bcsizeeq<Str, 1>, Str>& str) {
+        if (output_str_bulk(r, str)) return r;
         //if CONSTEXPRIF(bcsizeeq<Str,1>){
         int ctx = 0;
         r.readwhile(str, utf32toutf8, &ctx);
@@ -157,6 +189,7 @@ namespace PROJECT_NAME {
 
     template <class Buf, class Str>
     auto& output_str(Reader<std::enable_if_t<bcsizeeq<Buf, 4>, Buf>>&& r, std::enable_if_t<bcsizeeq<Str, 2>, Str>& str) {
+        if (output_str_bulk(r, str)) return r;
         int ctx = 0;
         r.readwhile(str, utf32toutf16, &ctx);
         return r;
@@ -199,19 +232,18 @@ namespace PROJECT_NAME {
     auto filter_char_size(IStream&& in, U8Filter_Type (*)()) {
         Reader<std::string> r;
         constexpr int size = sizeof(typename IStream::char_type);
-        int C = 0;
         if CONSTEXPRIF (size == 1) {
             in >> r.ref();
         }
         else if CONSTEXPRIF (size == 2) {
             Reader<std::conditional_t<sizeof(wchar_t) == 2, std::wstring, std::u16string>> str;
             in >> str.ref();
-            str.readwhile(r.ref(), utf16toutf8, &C);
+            str >> r.ref();
         }
         else if CONSTEXPRIF (size == 4) {
             Reader<std::conditional_t<sizeof(wchar_t) == 4, std::wstring, std::u32string>> str;
             in >> str.ref();
-            str.readwhile(r.ref(), utf32toutf8, &C);
+            str >> r.ref();
         }
         return r;
     }
@@ -220,11 +252,10 @@ namespace PROJECT_NAME {
     auto filter_char_size(IStream&& in, U16Filter_Type (*)()) {
         Reader<std::conditional_t<sizeof(wchar_t) == 2, std::wstring, std::u16string>> r;
         constexpr int size = sizeof(typename IStream::char_type);
-        int C = 0;
         if CONSTEXPRIF (size == 1) {
             Reader<std::string> str;
             in >> str.ref();
-            str.readwhile(r.ref(), utf8toutf16, &C);
+            str >> r.ref();
         }
         else if CONSTEXPRIF (size == 2) {
             in >> r.ref();
@@ -232,7 +263,7 @@ namespace PROJECT_NAME {
         else if CONSTEXPRIF (size == 4) {
             Reader<std::conditional_t<sizeof(wchar_t) == 4, std::wstring, std::u32string>> str;
             in >> str.ref();
-            str.readwhile(r.ref(), utf32toutf16, &C);
+            str >> r.ref();
         }
         return r;
     }
@@ -241,16 +272,15 @@ namespace PROJECT_NAME {
     auto filter_char_size(IStream&& in, U32Filter_Type (*)()) {
         Reader<std::conditional_t<sizeof(wchar_t) == 4, std::wstring, std::u32string>> r;
         constexpr int size = sizeof(typename IStream::char_type);
-        int C = 0;
         if CONSTEXPRIF (size == 1) {
             Reader<std::string> str;
             in >> str.ref();
-            str.readwhile(r.ref(), utf8toutf32, &C);
+            str >> r.ref();
         }
         else if CONSTEXPRIF (size == 2) {
             Reader<std::conditional_t<sizeof(wchar_t) == 2, std::wstring, std::u16string>> str;
             in >> str.ref();
-            str.readwhile(r.ref(), utf16toutf32, &C);
+            str >> r.ref();
         }
         else if CONSTEXPRIF (size == 4) {
             in >> r.ref();
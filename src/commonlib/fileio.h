@@ -550,6 +550,27 @@ namespace PROJECT_NAME {
         FileWriter(C* path, bool add = false) {
             open(path, add);
         }
+
+        ~FileWriter() noexcept {
+            close();
+        }
+
+       private:
+        void move(FileWriter&& in) {
+            close();
+            fp = in.fp;
+            in.fp = nullptr;
+        }
+
+       public:
+        FileWriter(FileWriter&& in) noexcept {
+            move(std::forward<FileWriter>(in));
+        }
+
+        FileWriter& operator=(FileWriter&& in) {
+            move(std::forward<FileWriter>(in));
+            return *this;
+        }
 #ifdef _WIN32
         bool open(const wchar_t* path, bool add = false) {
             FILE* tmp = nullptr;
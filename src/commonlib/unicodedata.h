@@ -7,20 +7,90 @@
 
 #pragma once
 
+#include <algorithm>
+#include <bitset>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 #include "extutil.h"
 #include "fileio.h"
 #include "project_name.h"
 #include "reader.h"
 #include "serializer.h"
+#include "utf_bulk.h"
 
 namespace PROJECT_NAME {
 
+    enum PropertyKind {
+        property_category,
+        property_bidiclass,
+        property_east_asian_width,
+        property_block,
+        property_decomposition_command,
+        property_script,             //Scripts.txt (range properties)
+        property_script_extensions,  //script sets of ScriptExtensions.txt as long names joined by space
+        property_count,
+    };
+
+    //interned property values shared by every CodeInfo
+    //id 0 is always empty string (no value)
+    struct PropertyDict {
+        std::vector<std::string> names[property_count];
+        std::map<std::string, std::uint16_t> ids[property_count];
+
+        PropertyDict() {
+            for (auto i = 0; i < property_count; i++) {
+                intern((PropertyKind)i, "");
+            }
+        }
+
+        static size_t limit(PropertyKind kind) {
+            return kind == property_block ? 0x10000 : 0x100;
+        }
+
+        std::uint16_t intern(PropertyKind kind, const std::string& name) {
+            if (auto found = ids[kind].find(name); found != ids[kind].end()) {
+                return (*found).second;
+            }
+            auto ret = (std::uint16_t)names[kind].size();
+            names[kind].push_back(name);
+            ids[kind].emplace(name, ret);
+            return ret;
+        }
+
+        bool find(PropertyKind kind, const std::string& name, std::uint16_t& id) const {
+            if (auto found = ids[kind].find(name); found != ids[kind].end()) {
+                id = (*found).second;
+                return true;
+            }
+            return false;
+        }
+
+        const std::string& name(PropertyKind kind, std::uint16_t id) const {
+            return id < names[kind].size() ? names[kind][id] : names[kind][0];
+        }
+
+        bool is_valid() const {
+            for (auto i = 0; i < property_count; i++) {
+                if (names[i].size() > limit((PropertyKind)i)) return false;
+            }
+            return true;
+        }
+    };
+
     struct Decomposition {
-        std::string command;
+        std::uint8_t command = 0;
         std::u32string to;
     };
 
@@ -56,59 +126,2885 @@ namespace PROJECT_NAME {
             if (flag & large_numbit) {
                 ret += std::to_string(v3_L);
             }
-            else {
-                ret += std::to_string(v3_S._1);
-                if (flag & exist_two_bit) {
-                    ret += "/" + std::to_string(v3_S._2);
+            else {
+                ret += std::to_string(v3_S._1);
+                if (flag & exist_two_bit) {
+                    ret += "/" + std::to_string(v3_S._2);
+                }
+            }
+            return ret;
+        }
+
+        //same text as stringify() without allocation. returns length
+        size_t stringify(char* buf, size_t size) const {
+            if (!size) return 0;
+            int ret = 0;
+            if (!flag) {
+                buf[0] = 0;
+            }
+            else if (flag & large_numbit) {
+                ret = ::snprintf(buf, size, "%s%lld", flag & signbit ? "-" : "", v3_L);
+            }
+            else if (flag & exist_two_bit) {
+                ret = ::snprintf(buf, size, "%s%d/%d", flag & signbit ? "-" : "", v3_S._1, v3_S._2);
+            }
+            else {
+                ret = ::snprintf(buf, size, "%s%d", flag & signbit ? "-" : "", v3_S._1);
+            }
+            return ret < 0 ? 0 : (size_t)ret;
+        }
+
+        double num() const {
+            double ret = 0;
+            if (!flag) return NAN;
+            if (flag & large_numbit) {
+                ret = (double)v3_L;
+            }
+            else {
+                ret = (double)v3_S._1;
+                if (flag & exist_two_bit) {
+                    ret = ret / v3_S._2;
+                }
+            }
+            if (flag & signbit) {
+                ret = -ret;
+            }
+            return ret;
+        }
+    };
+
+    struct CaseMap {
+        char32_t upper = (char32_t)-1;
+        char32_t lower = (char32_t)-1;
+        char32_t title = (char32_t)-1;
+        unsigned char flag = 0;
+    };
+
+    enum CaseKind {
+        case_lower,
+        case_upper,
+        case_title,
+        case_fold_full,    //full case folding (CaseFolding.txt status C and F)
+        case_fold_simple,  //simple case folding (status C and S)
+        case_kind_count,
+    };
+
+    //mapping of SpecialCasing.txt (unconditional ones) or CaseFolding.txt
+    struct CaseMapping {
+        char32_t codepoint = 0;
+        std::uint8_t kind = 0;  //CaseKind
+        std::u32string to;
+    };
+
+    //properties given to code point ranges by UCD text other than UnicodeData.txt
+    enum RangePropertyKind {
+        range_grapheme_break,         //GraphemeBreak value
+        range_extended_pictographic,  //1 (emoji-data.txt)
+        range_emoji_presentation,     //1 (emoji-data.txt)
+        range_word_break,             //WordBreak value
+        range_sentence_break,         //SentenceBreak value
+        range_script,                 //id of property_script
+        range_script_extensions,      //id of property_script_extensions
+        range_property_kind_count,
+    };
+
+    //Grapheme_Cluster_Break values of GraphemeBreakProperty.txt
+    enum GraphemeBreak {
+        gb_other,
+        gb_cr,
+        gb_lf,
+        gb_control,
+        gb_extend,
+        gb_zwj,
+        gb_regional_indicator,
+        gb_prepend,
+        gb_spacing_mark,
+        gb_l,
+        gb_v,
+        gb_t,
+        gb_lv,
+        gb_lvt,
+        gb_extended_pictographic,  //not a value of the file. Other with Extended_Pictographic
+        grapheme_break_count,
+    };
+
+    constexpr const char* grapheme_break_names[] = {
+        "Other", "CR", "LF", "Control", "Extend", "ZWJ", "Regional_Indicator",
+        "Prepend", "SpacingMark", "L", "V", "T", "LV", "LVT", "Extended_Pictographic",
+    };
+
+    //Word_Break values of WordBreakProperty.txt
+    enum WordBreak {
+        wb_other,
+        wb_cr,
+        wb_lf,
+        wb_newline,
+        wb_extend,
+        wb_zwj,
+        wb_regional_indicator,
+        wb_format,
+        wb_katakana,
+        wb_hebrew_letter,
+        wb_aletter,
+        wb_single_quote,
+        wb_double_quote,
+        wb_midnumlet,
+        wb_midletter,
+        wb_midnum,
+        wb_numeric,
+        wb_extendnumlet,
+        wb_wsegspace,
+        wb_extended_pictographic,  //not a value of the file. Other with Extended_Pictographic
+        wb_aletter_pictographic,   //not a value of the file. ALetter with Extended_Pictographic
+        word_break_count,
+    };
+
+    constexpr const char* word_break_names[] = {
+        "Other", "CR", "LF", "Newline", "Extend", "ZWJ", "Regional_Indicator", "Format",
+        "Katakana", "Hebrew_Letter", "ALetter", "Single_Quote", "Double_Quote", "MidNumLet",
+        "MidLetter", "MidNum", "Numeric", "ExtendNumLet", "WSegSpace", "Extended_Pictographic",
+        "ALetter_Extended_Pictographic",
+    };
+
+    //Sentence_Break values of SentenceBreakProperty.txt
+    enum SentenceBreak {
+        sb_other,
+        sb_cr,
+        sb_lf,
+        sb_extend,
+        sb_sep,
+        sb_format,
+        sb_sp,
+        sb_lower,
+        sb_upper,
+        sb_oletter,
+        sb_numeric,
+        sb_aterm,
+        sb_sterm,
+        sb_close,
+        sb_scontinue,
+        sentence_break_count,
+    };
+
+    constexpr const char* sentence_break_names[] = {
+        "Other", "CR", "LF", "Extend", "Sep", "Format", "Sp", "Lower",
+        "Upper", "OLetter", "Numeric", "ATerm", "STerm", "Close", "SContinue",
+    };
+
+    struct RangeProperty {
+        char32_t first = 0;
+        char32_t last = 0;
+        std::uint8_t kind = 0;  //RangePropertyKind
+        std::uint16_t value = 0;
+    };
+
+    struct CodeInfo {
+        char32_t codepoint;
+        std::string name;
+        std::uint16_t block = 0;
+        std::uint8_t category = 0;
+        unsigned int ccc = 0;  //Canonical_Combining_Class
+        std::uint8_t bidiclass = 0;
+        std::uint8_t east_asian_width = 0;
+        Decomposition decomposition;
+        Numeric numeric;
+        bool mirrored = false;
+        CaseMap casemap;
+        CodeInfo* range = nullptr;
+    };
+
+    struct CodeRange {
+        CodeInfo* begin = nullptr;
+        CodeInfo* end = nullptr;
+    };
+
+    constexpr char32_t codepoint_limit = 0x110000;
+    constexpr unsigned int codetable_shift = 8;
+    constexpr char32_t codetable_page = 1 << codetable_shift;
+
+    //two-stage lookup table: code point -> page -> record index
+    //pages which have same contents are shared and ranged code points point to the first record of range
+    //records[0] is always nullptr so that unassigned code point needs no branch
+    struct CodeTable {
+        std::vector<CodeInfo*> records;
+        std::vector<std::uint16_t> stage1;
+        std::vector<std::uint16_t> stage2;
+
+        std::uint16_t index(char32_t code) const {
+            return stage2[((size_t)stage1[code >> codetable_shift] << codetable_shift) | (code & (codetable_page - 1))];
+        }
+
+        CodeInfo* find(char32_t code) const {
+            if (code >= codepoint_limit || !stage1.size()) return nullptr;
+            return records[index(code)];
+        }
+
+        void clear() {
+            records.clear();
+            stage1.clear();
+            stage2.clear();
+        }
+    };
+
+    //UDv5: fixed size records, offset tables and string blob
+    //the image is written in native byte order so that it can be used in place via FileMap
+    constexpr int flat_version = 5;
+    constexpr std::uint32_t flat_byte_order = 0x01020304;
+    constexpr std::uint32_t flat_alignment = 8;
+
+    //property kinds of the first UDv5 images. names of later kinds follow range properties
+    constexpr int flat_base_property_count = property_script;
+
+    enum FlatSectionIndex {
+        flat_stage1,
+        flat_stage2,
+        flat_records,
+        flat_decomposition,
+        flat_strings,
+        flat_properties,
+        flat_case_mappings = flat_properties + flat_base_property_count,
+        flat_range_properties,
+        flat_late_properties,
+        flat_section_count = flat_late_properties + property_count - flat_base_property_count,
+    };
+
+    constexpr int flat_property_section(int kind) {
+        return kind < flat_base_property_count ? flat_properties + kind : flat_late_properties + kind - flat_base_property_count;
+    }
+
+    //sections of the first UDv5 images. later sections are optional and empty if missing
+    constexpr int flat_base_section_count = flat_case_mappings;
+
+    constexpr unsigned char flat_range_first = 0x1;
+    constexpr unsigned char flat_range_last = 0x2;
+
+    struct FlatSection {
+        std::uint32_t offset = 0;
+        std::uint32_t size = 0;
+    };
+
+    struct FlatHeader {
+        char magic[4] = {'U', 'D', 'v', '5'};
+        std::uint32_t byte_order = flat_byte_order;
+        std::uint32_t header_size = sizeof(FlatHeader);
+        std::uint32_t record_size = 0;
+        std::uint32_t record_count = 0;
+        std::uint32_t section_count = flat_section_count;
+        FlatSection sections[flat_section_count];
+    };
+
+    struct FlatCodeInfo {
+        std::uint32_t codepoint = 0;
+        std::uint32_t name = 0;           //offset of string blob
+        std::uint32_t decomposition = 0;  //index of decomposition pool
+        std::uint32_t upper = (std::uint32_t)-1;
+        std::uint32_t lower = (std::uint32_t)-1;
+        std::uint32_t title = (std::uint32_t)-1;
+        std::int64_t numeric = -1;  //same bits as Numeric::v3_L
+        std::int8_t digit = -1;
+        std::int8_t decimal = -1;
+        std::uint8_t numeric_flag = 0;
+        std::uint8_t case_flag = 0;
+        std::uint8_t category = 0;
+        std::uint8_t bidiclass = 0;
+        std::uint8_t east_asian_width = 0;
+        std::uint8_t ccc = 0;
+        std::uint8_t decomposition_command = 0;
+        std::uint8_t decomposition_size = 0;
+        std::uint8_t mirrored = 0;
+        std::uint8_t range = 0;
+        std::uint16_t block = 0;
+        std::uint16_t reserved = 0;
+
+        Numeric numeric_value() const {
+            Numeric ret;
+            ret.v1 = digit;
+            ret.v2 = decimal;
+            ret.flag = numeric_flag;
+            ::memcpy(&ret.v3_L, &numeric, sizeof(numeric));
+            return ret;
+        }
+
+        CaseMap casemap() const {
+            CaseMap ret;
+            ret.upper = upper;
+            ret.lower = lower;
+            ret.title = title;
+            ret.flag = case_flag;
+            return ret;
+        }
+    };
+
+    static_assert(sizeof(FlatCodeInfo) == 48, "FlatCodeInfo is on-disk layout");
+
+    //sorted by codepoint then kind
+    struct FlatCaseMapping {
+        std::uint32_t codepoint = 0;
+        std::uint8_t kind = 0;  //CaseKind
+        std::uint8_t size = 0;
+        std::uint16_t reserved = 0;
+        std::uint32_t offset = 0;  //index of decomposition pool
+    };
+
+    static_assert(sizeof(FlatCaseMapping) == 12, "FlatCaseMapping is on-disk layout");
+
+    //sorted by kind then first. ranges of one kind do not overlap
+    struct FlatRangeProperty {
+        std::uint32_t first = 0;
+        std::uint32_t last = 0;
+        std::uint16_t kind = 0;  //RangePropertyKind
+        std::uint16_t value = 0;
+    };
+
+    static_assert(sizeof(FlatRangeProperty) == 12, "FlatRangeProperty is on-disk layout");
+
+    //view of UDv5 image. image is not owned
+    struct FlatTable {
+        const FlatHeader* header = nullptr;
+        const std::uint16_t* stage1 = nullptr;
+        const std::uint16_t* stage2 = nullptr;
+        size_t stage2_size = 0;
+        const FlatCodeInfo* records = nullptr;  //records[0] is dummy
+        size_t record_count = 0;
+        const char32_t* decomposition = nullptr;
+        size_t decomposition_size = 0;
+        const char* strings = nullptr;
+        size_t strings_size = 0;
+        const std::uint32_t* properties[property_count] = {nullptr};
+        size_t property_size[property_count] = {0};
+        const FlatCaseMapping* case_mappings = nullptr;
+        size_t case_mapping_count = 0;
+        const FlatRangeProperty* range_properties = nullptr;
+        size_t range_property_count = 0;
+
+        std::uint16_t index(char32_t code) const {
+            return stage2[((size_t)stage1[code >> codetable_shift] << codetable_shift) | (code & (codetable_page - 1))];
+        }
+
+        //batched index(); out of range code points map to the dummy record 0
+        void indexes(const char32_t* codes, size_t size, std::uint16_t* out) const {
+            for (size_t i = 0; i < size; i++) {
+                auto code = codes[i];
+                auto valid = code < codepoint_limit;
+                out[i] = index(valid ? code : 0) & (valid ? 0xffff : 0);
+            }
+        }
+
+        const FlatCodeInfo* find(char32_t code) const {
+            if (code >= codepoint_limit || !stage1) return nullptr;
+            auto idx = index(code);
+            return idx ? records + idx : nullptr;
+        }
+
+        const char* str(std::uint32_t offset) const {
+            return strings + offset;
+        }
+
+        const char* property(PropertyKind kind, std::uint32_t id) const {
+            if (id >= property_size[kind]) return "";
+            return strings + properties[kind][id];
+        }
+
+        bool find_property(PropertyKind kind, const char* name, std::uint32_t& id) const {
+            for (size_t i = 0; i < property_size[kind]; i++) {
+                if (::strcmp(strings + properties[kind][i], name) == 0) {
+                    id = (std::uint32_t)i;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //ranges of kind in range_properties
+        std::pair<const FlatRangeProperty*, const FlatRangeProperty*> ranges_of(RangePropertyKind kind) const {
+            auto end = range_properties + range_property_count;
+            auto begin = std::lower_bound(range_properties, end, kind, [](auto& r, auto k) {
+                return r.kind < k;
+            });
+            return {begin, std::lower_bound(begin, end, kind + 1, [](auto& r, auto k) {
+                        return r.kind < k;
+                    })};
+        }
+
+        const char32_t* decomposition_of(const FlatCodeInfo& info) const {
+            return decomposition + info.decomposition;
+        }
+
+        bool is_loaded() const {
+            return header != nullptr;
+        }
+
+        bool load(const char* image, size_t size) {
+            *this = FlatTable();
+            if (!image || size < sizeof(FlatHeader)) return false;
+            if ((std::uintptr_t)image % flat_alignment) return false;
+            auto head = (const FlatHeader*)image;
+            if (::memcmp(head->magic, "UDv5", 4) != 0 || head->byte_order != flat_byte_order ||
+                head->record_size != sizeof(FlatCodeInfo) || head->section_count < flat_base_section_count ||
+                head->section_count > flat_section_count ||
+                head->header_size != offsetof(FlatHeader, sections) + head->section_count * sizeof(FlatSection)) {
+                return false;
+            }
+            FlatSection sections[flat_section_count];
+            for (std::uint32_t i = 0; i < head->section_count; i++) {
+                sections[i] = head->sections[i];
+                if (sections[i].offset % flat_alignment || (size_t)sections[i].offset + sections[i].size > size) return false;
+            }
+            auto section = [&](int i) {
+                return image + sections[i].offset;
+            };
+            auto section_size = [&](int i) {
+                return (size_t)sections[i].size;
+            };
+            constexpr size_t stage1_size = (codepoint_limit >> codetable_shift) * sizeof(std::uint16_t);
+            constexpr size_t page_size = codetable_page * sizeof(std::uint16_t);
+            if (section_size(flat_stage1) != stage1_size || !section_size(flat_stage2) ||
+                section_size(flat_stage2) % page_size ||
+                section_size(flat_records) != (size_t)head->record_count * sizeof(FlatCodeInfo) ||
+                !head->record_count || section_size(flat_decomposition) % sizeof(char32_t) ||
+                !section_size(flat_strings) || section(flat_strings)[section_size(flat_strings) - 1] != 0 ||
+                section_size(flat_case_mappings) % sizeof(FlatCaseMapping) ||
+                section_size(flat_range_properties) % sizeof(FlatRangeProperty)) {
+                return false;
+            }
+            FlatTable tmp;
+            tmp.header = head;
+            tmp.stage1 = (const std::uint16_t*)section(flat_stage1);
+            tmp.stage2 = (const std::uint16_t*)section(flat_stage2);
+            tmp.stage2_size = section_size(flat_stage2) / sizeof(std::uint16_t);
+            tmp.records = (const FlatCodeInfo*)section(flat_records);
+            tmp.record_count = head->record_count;
+            tmp.decomposition = (const char32_t*)section(flat_decomposition);
+            tmp.decomposition_size = section_size(flat_decomposition) / sizeof(char32_t);
+            tmp.strings = section(flat_strings);
+            tmp.strings_size = section_size(flat_strings);
+            for (auto i = 0; i < property_count; i++) {
+                if (section_size(flat_property_section(i)) % sizeof(std::uint32_t)) return false;
+                tmp.properties[i] = (const std::uint32_t*)section(flat_property_section(i));
+                tmp.property_size[i] = section_size(flat_property_section(i)) / sizeof(std::uint32_t);
+                for (size_t k = 0; k < tmp.property_size[i]; k++) {
+                    if (tmp.properties[i][k] >= tmp.strings_size) return false;
+                }
+            }
+            tmp.case_mappings = (const FlatCaseMapping*)section(flat_case_mappings);
+            tmp.case_mapping_count = section_size(flat_case_mappings) / sizeof(FlatCaseMapping);
+            for (size_t i = 0; i < tmp.case_mapping_count; i++) {
+                auto& m = tmp.case_mappings[i];
+                if (m.kind >= case_kind_count || (size_t)m.offset + m.size >= tmp.decomposition_size ||
+                    (i && (tmp.case_mappings[i - 1].codepoint > m.codepoint ||
+                           (tmp.case_mappings[i - 1].codepoint == m.codepoint && tmp.case_mappings[i - 1].kind >= m.kind)))) {
+                    return false;
+                }
+            }
+            //unknown kinds of later versions are kept and not looked up
+            tmp.range_properties = (const FlatRangeProperty*)section(flat_range_properties);
+            tmp.range_property_count = section_size(flat_range_properties) / sizeof(FlatRangeProperty);
+            for (size_t i = 0; i < tmp.range_property_count; i++) {
+                auto& r = tmp.range_properties[i];
+                if (r.first > r.last || r.last >= codepoint_limit) return false;
+                if (i) {
+                    auto& prev = tmp.range_properties[i - 1];
+                    if (prev.kind > r.kind || (prev.kind == r.kind && prev.last >= r.first)) return false;
+                }
+            }
+            auto pages = section_size(flat_stage2) / page_size;
+            for (size_t i = 0; i < stage1_size / sizeof(std::uint16_t); i++) {
+                if (tmp.stage1[i] >= pages) return false;
+            }
+            for (size_t i = 0; i < pages * codetable_page; i++) {
+                if (tmp.stage2[i] >= tmp.record_count) return false;
+            }
+            for (size_t i = 0; i < tmp.record_count; i++) {
+                auto& rec = tmp.records[i];
+                if (rec.name >= tmp.strings_size ||
+                    (size_t)rec.decomposition + rec.decomposition_size >= tmp.decomposition_size ||
+                    rec.category >= tmp.property_size[property_category] ||
+                    rec.bidiclass >= tmp.property_size[property_bidiclass] ||
+                    rec.east_asian_width >= tmp.property_size[property_east_asian_width] ||
+                    rec.block >= tmp.property_size[property_block] ||
+                    rec.decomposition_command >= tmp.property_size[property_decomposition_command]) {
+                    return false;
+                }
+            }
+            *this = tmp;
+            return true;
+        }
+    };
+
+    //name shown for code points inside a range: "<CJK Ideograph, First>" -> "CJK Ideograph"
+    inline std::string_view range_name(const char* name) {
+        std::string_view ret = name;
+        if (ret.size() < 9) return ret;
+        return ret.substr(1, ret.size() - 9);
+    }
+
+    //trigram inverted index over character names
+    //entries are runs of code points sharing one name, in code point order
+    struct NameIndex {
+        struct Entry {
+            std::string_view name;
+            char32_t first = 0;
+            char32_t last = 0;
+        };
+        std::vector<Entry> entries;
+        std::deque<std::string> synthesized;
+        std::vector<std::uint32_t> trigrams;  //sorted keys
+        std::vector<std::uint32_t> offsets;   //trigrams.size()+1 offsets into postings
+        std::vector<std::uint32_t> postings;  //entry ids, ascending per trigram
+        std::vector<std::uint32_t> sorted;    //entry ids ordered by name
+        bool built = false;
+
+        static std::uint32_t trigram(const char* s) {
+            return ((std::uint32_t)(unsigned char)s[0] << 16) | ((std::uint32_t)(unsigned char)s[1] << 8) |
+                   (std::uint32_t)(unsigned char)s[2];
+        }
+
+        void clear() {
+            *this = NameIndex();
+        }
+
+        bool build(const FlatTable& flat) {
+            clear();
+            if (!flat.is_loaded()) return false;
+            constexpr std::uint32_t none = ~0;
+            std::vector<std::uint32_t> exact(flat.record_count + 1, none), ranged(flat.record_count + 1, none);
+            std::vector<std::uint32_t> range_names(flat.record_count + 1, none);
+            std::uint32_t prev_key = none;
+            for (char32_t code = 0; code < codepoint_limit; code++) {
+                auto idx = flat.index(code);
+                if (!idx) {
+                    prev_key = none;
+                    continue;
+                }
+                auto& rec = flat.records[idx];
+                bool is_exact = rec.codepoint == code;
+                std::uint32_t key = is_exact ? idx : idx | 0x80000000;
+                if (key == prev_key) {
+                    entries.back().last = code;
+                    continue;
+                }
+                prev_key = key;
+                Entry e;
+                e.first = e.last = code;
+                if (is_exact) {
+                    e.name = flat.str(rec.name);
+                }
+                else {
+                    if (range_names[idx] == none) {
+                        range_names[idx] = (std::uint32_t)synthesized.size();
+                        auto name = range_name(flat.str(rec.name));
+                        synthesized.push_back(std::string(name.size() ? name : flat.str(rec.name)));
+                    }
+                    e.name = synthesized[range_names[idx]];
+                }
+                entries.push_back(e);
+            }
+            std::vector<std::uint64_t> pairs;
+            for (std::uint32_t id = 0; id < entries.size(); id++) {
+                auto& name = entries[id].name;
+                for (size_t i = 0; i + 3 <= name.size(); i++) {
+                    pairs.push_back(((std::uint64_t)trigram(name.data() + i) << 32) | id);
+                }
+            }
+            std::sort(pairs.begin(), pairs.end());
+            pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+            postings.reserve(pairs.size());
+            for (auto p : pairs) {
+                auto key = (std::uint32_t)(p >> 32);
+                if (!trigrams.size() || trigrams.back() != key) {
+                    trigrams.push_back(key);
+                    offsets.push_back((std::uint32_t)postings.size());
+                }
+                postings.push_back((std::uint32_t)p);
+            }
+            offsets.push_back((std::uint32_t)postings.size());
+            sorted.resize(entries.size());
+            for (std::uint32_t id = 0; id < entries.size(); id++) {
+                sorted[id] = id;
+            }
+            std::stable_sort(sorted.begin(), sorted.end(), [&](auto a, auto b) {
+                return entries[a].name < entries[b].name;
+            });
+            built = true;
+            return true;
+        }
+
+        //appends matching code point ranges in code point order
+        template <class Ranges>
+        void find(std::string_view str, bool strict, Ranges& out) const {
+            auto push = [&](std::uint32_t id) {
+                out.push_back({entries[id].first, entries[id].last});
+            };
+            if (strict) {
+                auto range = std::equal_range(sorted.begin(), sorted.end(), str, Compare{this});
+                std::vector<std::uint32_t> ids(range.first, range.second);
+                std::sort(ids.begin(), ids.end());
+                for (auto id : ids) {
+                    push(id);
+                }
+                return;
+            }
+            if (str.size() < 3) {
+                for (std::uint32_t id = 0; id < entries.size(); id++) {
+                    if (entries[id].name.find(str) != ~0) {
+                        push(id);
+                    }
+                }
+                return;
+            }
+            //verify candidates of the rarest trigram in str
+            size_t begin = 0, end = 0;
+            bool first = true;
+            for (size_t i = 0; i + 3 <= str.size(); i++) {
+                auto key = trigram(str.data() + i);
+                auto found = std::lower_bound(trigrams.begin(), trigrams.end(), key);
+                if (found == trigrams.end() || *found != key) return;
+                auto pos = found - trigrams.begin();
+                if (first || offsets[pos + 1] - offsets[pos] < end - begin) {
+                    begin = offsets[pos];
+                    end = offsets[pos + 1];
+                    first = false;
+                }
+            }
+            for (auto i = begin; i < end; i++) {
+                auto id = postings[i];
+                if (entries[id].name.find(str) != ~0) {
+                    push(id);
+                }
+            }
+        }
+
+        struct Compare {
+            const NameIndex* self;
+            bool operator()(std::uint32_t id, std::string_view str) const {
+                return self->entries[id].name < str;
+            }
+            bool operator()(std::string_view str, std::uint32_t id) const {
+                return str < self->entries[id].name;
+            }
+        };
+    };
+
+    using CodeInterval = std::pair<char32_t, char32_t>;
+
+    //sorted, disjoint and non-adjacent inclusive code point ranges
+    struct CodeSet {
+        std::vector<CodeInterval> ranges;
+
+        //codes must be added in ascending order
+        void add(char32_t first, char32_t last) {
+            if (ranges.size() && ranges.back().second + 1 >= first) {
+                if (ranges.back().second < last) ranges.back().second = last;
+                return;
+            }
+            ranges.push_back({first, last});
+        }
+
+        void add(char32_t code) {
+            add(code, code);
+        }
+
+        bool contains(char32_t code) const {
+            auto found = std::upper_bound(ranges.begin(), ranges.end(), code, [](char32_t c, auto& range) {
+                return c < range.first;
+            });
+            return found != ranges.begin() && code <= (*(found - 1)).second;
+        }
+
+        size_t count() const {
+            size_t ret = 0;
+            for (auto& r : ranges) {
+                ret += (size_t)(r.second - r.first) + 1;
+            }
+            return ret;
+        }
+
+        template <class F>
+        void each(F&& f) const {
+            for (auto& r : ranges) {
+                for (auto code = r.first;; code++) {
+                    f(code);
+                    if (code == r.second) break;
+                }
+            }
+        }
+
+        static CodeSet unite(const CodeSet& a, const CodeSet& b) {
+            CodeSet ret;
+            auto x = a.ranges.begin(), y = b.ranges.begin();
+            while (x != a.ranges.end() || y != b.ranges.end()) {
+                if (y == b.ranges.end() || (x != a.ranges.end() && (*x).first < (*y).first)) {
+                    ret.add((*x).first, (*x).second);
+                    x++;
+                }
+                else {
+                    ret.add((*y).first, (*y).second);
+                    y++;
+                }
+            }
+            return ret;
+        }
+
+        static CodeSet intersect(const CodeSet& a, const CodeSet& b) {
+            CodeSet ret;
+            auto x = a.ranges.begin(), y = b.ranges.begin();
+            while (x != a.ranges.end() && y != b.ranges.end()) {
+                auto first = (std::max)((*x).first, (*y).first);
+                auto last = (std::min)((*x).second, (*y).second);
+                if (first <= last) {
+                    ret.add(first, last);
+                }
+                if ((*x).second < (*y).second) {
+                    x++;
+                }
+                else {
+                    y++;
+                }
+            }
+            return ret;
+        }
+
+        //complement within [0,codepoint_limit)
+        static CodeSet invert(const CodeSet& a) {
+            CodeSet ret;
+            char32_t next = 0;
+            for (auto& r : a.ranges) {
+                if (r.first > next) {
+                    ret.add(next, r.first - 1);
+                }
+                next = r.second + 1;
+            }
+            if (next < codepoint_limit) {
+                ret.add(next, codepoint_limit - 1);
+            }
+            return ret;
+        }
+
+        static CodeSet subtract(const CodeSet& a, const CodeSet& b) {
+            return intersect(a, invert(b));
+        }
+    };
+
+    //code point sets of each property value, and of all assigned code points
+    struct PropertySets {
+        std::vector<CodeSet> sets[property_count];
+        CodeSet assigned;
+        bool built = false;
+
+        void clear() {
+            *this = PropertySets();
+        }
+
+        bool build(const FlatTable& flat) {
+            clear();
+            if (!flat.is_loaded()) return false;
+            for (auto i = 0; i < property_count; i++) {
+                sets[i].resize(flat.property_size[i]);
+            }
+            for (char32_t code = 0; code < codepoint_limit; code++) {
+                auto idx = flat.index(code);
+                if (!idx) continue;
+                auto& rec = flat.records[idx];
+                assigned.add(code);
+                sets[property_category][rec.category].add(code);
+                sets[property_bidiclass][rec.bidiclass].add(code);
+                sets[property_east_asian_width][rec.east_asian_width].add(code);
+                sets[property_block][rec.block].add(code);
+                sets[property_decomposition_command][rec.decomposition_command].add(code);
+            }
+            //ranges of one kind are sorted and disjoint, so each set gets them in ascending order
+            auto add_ranges = [&](RangePropertyKind range, PropertyKind kind) {
+                auto found = flat.ranges_of(range);
+                for (auto r = found.first; r != found.second; r++) {
+                    if (r->value < sets[kind].size()) sets[kind][r->value].add(r->first, r->last);
+                }
+            };
+            add_ranges(range_script, property_script);
+            add_ranges(range_script_extensions, property_script_extensions);
+            built = true;
+            return true;
+        }
+
+        const CodeSet* find(PropertyKind kind, size_t id) const {
+            return id < sets[kind].size() ? &sets[kind][id] : nullptr;
+        }
+    };
+
+    enum NormalizeForm {
+        normalize_nfc,
+        normalize_nfd,
+        normalize_nfkc,
+        normalize_nfkd,
+        normalize_form_count,
+    };
+
+    //value of NFC_QC, NFD_QC, NFKC_QC and NFKD_QC
+    enum NormalizeCheck {
+        normalize_yes,
+        normalize_no,
+        normalize_maybe,
+    };
+
+    constexpr char32_t hangul_sbase = 0xac00;
+    constexpr char32_t hangul_lbase = 0x1100;
+    constexpr char32_t hangul_vbase = 0x1161;
+    constexpr char32_t hangul_tbase = 0x11a7;
+    constexpr char32_t hangul_lcount = 19;
+    constexpr char32_t hangul_vcount = 21;
+    constexpr char32_t hangul_tcount = 28;
+    constexpr char32_t hangul_ncount = hangul_vcount * hangul_tcount;
+    constexpr char32_t hangul_scount = hangul_lcount * hangul_ncount;
+
+    //CompositionExclusions.txt (script specifics and post composition version)
+    //singletons and non-starter decompositions are derived from UnicodeData
+    constexpr CodeInterval composition_exclusions[] = {
+        {0x958, 0x95f},
+        {0x9dc, 0x9dd},
+        {0x9df, 0x9df},
+        {0xa33, 0xa33},
+        {0xa36, 0xa36},
+        {0xa59, 0xa5b},
+        {0xa5e, 0xa5e},
+        {0xb5c, 0xb5d},
+        {0xf43, 0xf43},
+        {0xf4d, 0xf4d},
+        {0xf52, 0xf52},
+        {0xf57, 0xf57},
+        {0xf5c, 0xf5c},
+        {0xf69, 0xf69},
+        {0xf76, 0xf76},
+        {0xf78, 0xf78},
+        {0xf93, 0xf93},
+        {0xf9d, 0xf9d},
+        {0xfa2, 0xfa2},
+        {0xfa7, 0xfa7},
+        {0xfac, 0xfac},
+        {0xfb9, 0xfb9},
+        {0x2adc, 0x2adc},
+        {0xfb1d, 0xfb1d},
+        {0xfb1f, 0xfb1f},
+        {0xfb2a, 0xfb36},
+        {0xfb38, 0xfb3c},
+        {0xfb3e, 0xfb3e},
+        {0xfb40, 0xfb41},
+        {0xfb43, 0xfb44},
+        {0xfb46, 0xfb4e},
+        {0x1d15e, 0x1d164},
+        {0x1d1bb, 0x1d1c0},
+    };
+
+    //normalization forms of UAX #15 over FlatTable
+    //full decompositions are expanded at build time so that decomposing is one lookup per code point.
+    //runs which pass quick check are copied as is and only segments between two boundaries
+    //(code points which are yes and starter) around a failure are normalized
+    struct NormalizeTable {
+        struct Entry {
+            std::uint8_t ccc = 0;
+            std::uint8_t check = 0;  //NormalizeCheck of each form, 2 bits per form
+            std::uint8_t canonical_size = 0;
+            std::uint8_t compat_size = 0;
+            std::uint32_t canonical = 0;  //offset of full canonical decomposition in pool
+            std::uint32_t compat = 0;     //offset of full compatibility decomposition in pool
+        };
+        std::vector<Entry> entries;  //entries[0] is yes for every form, ccc 0 and no decomposition
+        std::vector<std::uint16_t> stage1;
+        std::vector<std::uint16_t> stage2;
+        std::vector<char32_t> pool;
+        std::vector<std::uint64_t> pairs;  //(first << 32) | second of primary composites, sorted
+        std::vector<char32_t> composites;  //composite of pairs[i]
+        char32_t quick_below[normalize_form_count] = {0};  //code points below are yes and starter
+        bool built = false;
+
+        void clear() {
+            *this = NormalizeTable();
+        }
+
+        static NormalizeCheck check_of(const Entry& e, NormalizeForm form) {
+            return (NormalizeCheck)((e.check >> (form * 2)) & 0x3);
+        }
+
+        static bool is_compat(NormalizeForm form) {
+            return form == normalize_nfkc || form == normalize_nfkd;
+        }
+
+        static bool is_composed(NormalizeForm form) {
+            return form == normalize_nfc || form == normalize_nfkc;
+        }
+
+        //expand single level mappings recursively. canonical mappings only if !compat
+        static void expand(const FlatTable& flat, char32_t code, bool compat, std::u32string& out) {
+            if (code - hangul_sbase < hangul_scount) {
+                auto s = code - hangul_sbase;
+                out.push_back(hangul_lbase + s / hangul_ncount);
+                out.push_back(hangul_vbase + (s % hangul_ncount) / hangul_tcount);
+                if (s % hangul_tcount) {
+                    out.push_back(hangul_tbase + s % hangul_tcount);
+                }
+                return;
+            }
+            auto rec = flat.find(code);
+            if (rec && rec->codepoint == code && rec->decomposition_size && (compat || !rec->decomposition_command)) {
+                auto p = flat.decomposition_of(*rec);
+                for (size_t i = 0; i < rec->decomposition_size; i++) {
+                    expand(flat, p[i], compat, out);
+                }
+                return;
+            }
+            out.push_back(code);
+        }
+
+        bool build(const FlatTable& flat) {
+            clear();
+            if (!flat.is_loaded()) return false;
+            auto ccc = [&](char32_t code) {
+                auto rec = flat.find(code);
+                return rec ? rec->ccc : (std::uint8_t)0;
+            };
+            CodeSet excluded, seconds;
+            for (auto& r : composition_exclusions) {
+                excluded.add(r.first, r.second);
+            }
+            std::vector<std::pair<std::uint64_t, char32_t>> composed;
+            for (size_t i = 1; i < flat.record_count; i++) {
+                auto& rec = flat.records[i];
+                if (rec.decomposition_command || !rec.decomposition_size) continue;
+                auto p = flat.decomposition_of(rec);
+                if (rec.decomposition_size == 1 || rec.ccc || ccc(p[0]) || excluded.contains(rec.codepoint)) continue;
+                composed.push_back({((std::uint64_t)p[0] << 32) | p[1], rec.codepoint});
+            }
+            std::sort(composed.begin(), composed.end());
+            std::vector<char32_t> second_codes;
+            for (auto& c : composed) {
+                pairs.push_back(c.first);
+                composites.push_back(c.second);
+                second_codes.push_back((char32_t)c.first);
+            }
+            std::vector<char32_t> primary(composites);
+            std::sort(primary.begin(), primary.end());
+            std::sort(second_codes.begin(), second_codes.end());
+            for (auto c : second_codes) {
+                seconds.add(c);
+            }
+            seconds = CodeSet::unite(seconds, CodeSet{{{hangul_vbase, hangul_vbase + hangul_vcount - 1}}});
+            seconds = CodeSet::unite(seconds, CodeSet{{{hangul_tbase + 1, hangul_tbase + hangul_tcount - 1}}});
+            std::map<std::pair<std::uint64_t, std::uint32_t>, std::uint16_t> ids;
+            auto intern = [&](const Entry& e) {
+                std::pair<std::uint64_t, std::uint32_t> key{
+                    ((std::uint64_t)e.ccc << 56) | ((std::uint64_t)e.check << 48) | ((std::uint64_t)e.canonical_size << 40) |
+                        ((std::uint64_t)e.compat_size << 32) | e.canonical,
+                    e.compat};
+                if (auto found = ids.find(key); found != ids.end()) {
+                    return (*found).second;
+                }
+                auto id = (std::uint16_t)entries.size();
+                entries.push_back(e);
+                ids.emplace(key, id);
+                return id;
+            };
+            intern(Entry());
+            for (auto& q : quick_below) {
+                q = codepoint_limit;
+            }
+            std::vector<std::uint16_t> flatmap(codepoint_limit, 0);
+            std::u32string canon, compat;
+            for (char32_t code = 0; code < codepoint_limit; code++) {
+                auto rec = flat.find(code);
+                auto mapped = code - hangul_sbase < hangul_scount || (rec && rec->codepoint == code && rec->decomposition_size);
+                auto canonical = code - hangul_sbase < hangul_scount || (mapped && !rec->decomposition_command);
+                Entry e;
+                e.ccc = rec ? rec->ccc : 0;
+                if (mapped) {
+                    canon.clear();
+                    compat.clear();
+                    expand(flat, code, false, canon);
+                    expand(flat, code, true, compat);
+                    if (canonical) {
+                        e.canonical = (std::uint32_t)pool.size();
+                        e.canonical_size = (std::uint8_t)canon.size();
+                        pool.insert(pool.end(), canon.begin(), canon.end());
+                    }
+                    if (canonical && compat == canon) {
+                        e.compat = e.canonical;
+                    }
+                    else {
+                        e.compat = (std::uint32_t)pool.size();
+                        pool.insert(pool.end(), compat.begin(), compat.end());
+                    }
+                    e.compat_size = (std::uint8_t)compat.size();
+                }
+                auto is_second = seconds.contains(code);
+                NormalizeCheck check[normalize_form_count];
+                auto composite = code - hangul_sbase < hangul_scount ||
+                                 (canonical && std::binary_search(primary.begin(), primary.end(), code));
+                check[normalize_nfd] = canonical ? normalize_no : normalize_yes;
+                check[normalize_nfkd] = mapped ? normalize_no : normalize_yes;
+                check[normalize_nfc] = canonical && !composite ? normalize_no : is_second ? normalize_maybe : normalize_yes;
+                check[normalize_nfkc] = check[normalize_nfc];
+                if (mapped && compat != canon) {
+                    check[normalize_nfkc] = normalize_no;
+                }
+                for (auto f = 0; f < normalize_form_count; f++) {
+                    e.check |= check[f] << (f * 2);
+                    if ((check[f] != normalize_yes || e.ccc) && quick_below[f] == codepoint_limit) {
+                        quick_below[f] = code;
+                    }
+                }
+                if (entries.size() == 0xffff) return false;
+                flatmap[code] = intern(e);
+            }
+            std::map<std::vector<std::uint16_t>, std::uint16_t> pages;
+            stage1.resize(codepoint_limit >> codetable_shift);
+            for (size_t i = 0; i < stage1.size(); i++) {
+                auto begin = flatmap.begin() + (i << codetable_shift);
+                std::vector<std::uint16_t> page(begin, begin + codetable_page);
+                auto found = pages.find(page);
+                if (found == pages.end()) {
+                    auto id = (std::uint16_t)pages.size();
+                    stage2.insert(stage2.end(), page.begin(), page.end());
+                    found = pages.emplace(std::move(page), id).first;
+                }
+                stage1[i] = (*found).second;
+            }
+            built = true;
+            return true;
+        }
+
+        const Entry& get(char32_t code) const {
+            if (code >= codepoint_limit) return entries[0];
+            return entries[stage2[((size_t)stage1[code >> codetable_shift] << codetable_shift) | (code & (codetable_page - 1))]];
+        }
+
+        //true if nothing before code interacts with code or after in form
+        bool is_boundary(NormalizeForm form, char32_t code) const {
+            if (code < quick_below[form]) return true;
+            auto& e = get(code);
+            return !e.ccc && check_of(e, form) == normalize_yes;
+        }
+
+        bool compose(char32_t first, char32_t second, char32_t& composite) const {
+            if (first - hangul_lbase < hangul_lcount && second - hangul_vbase < hangul_vcount) {
+                composite = hangul_sbase + ((first - hangul_lbase) * hangul_vcount + second - hangul_vbase) * hangul_tcount;
+                return true;
+            }
+            if (first - hangul_sbase < hangul_scount && (first - hangul_sbase) % hangul_tcount == 0 &&
+                second - hangul_tbase - 1 < hangul_tcount - 1) {
+                composite = first + second - hangul_tbase;
+                return true;
+            }
+            auto key = ((std::uint64_t)first << 32) | second;
+            auto found = std::lower_bound(pairs.begin(), pairs.end(), key);
+            if (found == pairs.end() || *found != key) return false;
+            composite = composites[found - pairs.begin()];
+            return true;
+        }
+
+        void decompose(NormalizeForm form, char32_t code, std::u32string& out) const {
+            auto& e = get(code);
+            if (is_compat(form) ? e.compat_size : e.canonical_size) {
+                auto p = pool.data() + (is_compat(form) ? e.compat : e.canonical);
+                out.append(p, is_compat(form) ? e.compat_size : e.canonical_size);
+            }
+            else {
+                out.push_back(code);
+            }
+        }
+
+        //canonical ordering of out[base..]. runs of non-starters are stably sorted by ccc
+        void reorder(std::u32string& out, size_t base) const {
+            for (size_t i = base + 1; i < out.size(); i++) {
+                auto cc = get(out[i]).ccc;
+                if (!cc) continue;
+                auto code = out[i];
+                auto k = i;
+                for (; k > base && get(out[k - 1]).ccc > cc; k--) {
+                    out[k] = out[k - 1];
+                }
+                out[k] = code;
+            }
+        }
+
+        //canonical composition of out[base..] which is decomposed and reordered
+        void compose(std::u32string& out, size_t base) const {
+            size_t starter = 0, w = base;
+            bool has_starter = false;
+            std::uint8_t last = 0;
+            for (auto r = base; r < out.size(); r++) {
+                auto code = out[r];
+                auto& e = get(code);
+                //only maybe can be second of a pair
+                if (has_starter && check_of(e, normalize_nfc) == normalize_maybe &&
+                    (w - 1 == starter || (last && last < e.ccc))) {
+                    char32_t composite;
+                    if (compose(out[starter], code, composite)) {
+                        out[starter] = composite;
+                        continue;
+                    }
+                }
+                if (!e.ccc) {
+                    starter = w;
+                    has_starter = true;
+                }
+                last = e.ccc;
+                out[w++] = code;
+            }
+            out.resize(w);
+        }
+
+        //normalize a segment into out which has no boundary except the first code point
+        void normalize_segment(NormalizeForm form, std::u32string& out, size_t base) const {
+            reorder(out, base);
+            if (is_composed(form)) {
+                compose(out, base);
+            }
+        }
+
+        //appends in normalized to form to out
+        void normalize(NormalizeForm form, const char32_t* in, size_t size, std::u32string& out) const {
+            auto below = quick_below[form];
+            size_t flushed = 0, starter = 0, i = 0;
+            std::uint8_t last = 0;
+            while (i < size) {
+                auto code = in[i];
+                if (code < below) {
+                    starter = i++;
+                    last = 0;
+                    continue;
+                }
+                auto& e = get(code);
+                if (check_of(e, form) == normalize_yes && (!e.ccc || last <= e.ccc)) {
+                    if (!e.ccc) starter = i;
+                    last = e.ccc;
+                    i++;
+                    continue;
+                }
+                //back to the last starter which may combine with code, forward to the next boundary
+                out.append(in + flushed, starter - flushed);
+                auto base = out.size();
+                for (i = starter; i < size && (i == starter || !is_boundary(form, in[i])); i++) {
+                    decompose(form, in[i], out);
+                }
+                normalize_segment(form, out, base);
+                flushed = starter = i;
+                last = 0;
+            }
+            out.append(in + flushed, size - flushed);
+        }
+
+        //appends str normalized to form to out. str must be valid utf-8 (see utf8_validate)
+        void normalize(NormalizeForm form, const char* str, size_t size, std::string& out) const {
+            auto in = (const unsigned char*)str;
+            auto below = quick_below[form];
+            size_t flushed = 0, starter = 0, i = 0;
+            std::uint8_t last = 0;
+            std::u32string work;
+            while (i < size) {
+                if (in[i] < 0x80) {
+                    //quick_below is never less than 0x80
+                    while (i + 8 <= size) {
+                        std::uint64_t word;
+                        ::memcpy(&word, in + i, 8);
+                        if (word & 0x8080808080808080) break;
+                        i += 8;
+                    }
+                    for (; i < size && in[i] < 0x80; i++) {
+                    }
+                    starter = i - 1;
+                    last = 0;
+                    continue;
+                }
+                char32_t code;
+                int len;
+                utf_detail::utf8_decode_one(in + i, size - i, code, len);
+                if (code < below) {
+                    starter = i;
+                    i += len;
+                    last = 0;
+                    continue;
+                }
+                auto& e = get(code);
+                if (check_of(e, form) == normalize_yes && (!e.ccc || last <= e.ccc)) {
+                    if (!e.ccc) starter = i;
+                    last = e.ccc;
+                    i += len;
+                    continue;
+                }
+                out.append(str + flushed, starter - flushed);
+                work.clear();
+                for (i = starter; i < size; i += len) {
+                    utf_detail::utf8_decode_one(in + i, size - i, code, len);
+                    if (i != starter && is_boundary(form, code)) break;
+                    decompose(form, code, work);
+                }
+                normalize_segment(form, work, 0);
+                char buf[4];
+                for (auto c : work) {
+                    out.append(buf, utf_detail::encode_one(c, buf, false));
+                }
+                flushed = starter = i;
+                last = 0;
+            }
+            out.append(str + flushed, size - flushed);
+        }
+
+        //quick check of UAX #15. maybe means normalize and compare to know the answer
+        template <class F>
+        NormalizeCheck quick_check_each(NormalizeForm form, F&& next) const {
+            auto below = quick_below[form];
+            auto ret = normalize_yes;
+            std::uint8_t last = 0;
+            char32_t code;
+            while (next(code)) {
+                if (code < below) {
+                    last = 0;
+                    continue;
+                }
+                auto& e = get(code);
+                if (e.ccc && last > e.ccc) return normalize_no;
+                auto check = check_of(e, form);
+                if (check == normalize_no) return normalize_no;
+                if (check == normalize_maybe) ret = normalize_maybe;
+                last = e.ccc;
+            }
+            return ret;
+        }
+
+        NormalizeCheck quick_check(NormalizeForm form, const char32_t* in, size_t size) const {
+            size_t i = 0;
+            return quick_check_each(form, [&](char32_t& code) {
+                if (i >= size) return false;
+                code = in[i++];
+                return true;
+            });
+        }
+
+        //quick check of utf-8 str which validates it on the way. invalid str is no and res has the error like utf8_validate
+        NormalizeCheck quick_check(NormalizeForm form, const char* str, size_t size, UTFResult& res) const {
+            auto in = (const unsigned char*)str;
+            auto below = quick_below[form];
+            //two byte sequences with lead byte below this are below quick_below
+            auto lead2 = below < 0x800 ? (unsigned char)(0xc0 | (below >> 6)) : (unsigned char)0xe0;
+            auto ret = normalize_yes;
+            std::uint8_t last = 0;
+            size_t i = 0;
+            res = UTFResult();
+            while (i < size) {
+                if (in[i] < 0x80) {
+                    while (i + 8 <= size) {
+                        std::uint64_t word;
+                        ::memcpy(&word, in + i, 8);
+                        if (word & 0x8080808080808080) break;
+                        i += 8;
+                    }
+                    for (; i < size && in[i] < 0x80; i++) {
+                    }
+                    last = 0;
+                    continue;
+                }
+                auto short2 = [&] {
+                    return i + 1 < size && in[i] >= 0xc2 && in[i] < lead2 && (in[i + 1] & 0xc0) == 0x80;
+                };
+                if (short2()) {
+                    //run of yes starters in two bytes
+                    do {
+                        i += 2;
+                    } while (short2());
+                    last = 0;
+                    continue;
+                }
+                char32_t code;
+                int len;
+                if (auto err = utf_detail::utf8_decode_one(in + i, size - i, code, len)) {
+                    res.err = err;
+                    break;
+                }
+                i += len;
+                if (code < below) {
+                    last = 0;
+                    continue;
+                }
+                auto& e = get(code);
+                auto check = check_of(e, form);
+                if ((e.ccc && last > e.ccc) || check == normalize_no) {
+                    //the answer is known. the rest is only validated
+                    ret = normalize_no;
+                    res = utf8_validate(Sized<const char>{str + i, size - i});
+                    break;
+                }
+                if (check == normalize_maybe) ret = normalize_maybe;
+                last = e.ccc;
+            }
+            if (res.err) {
+                res.read += i;
+                return normalize_no;
+            }
+            res.read = size;
+            return ret;
+        }
+
+        //str must be valid utf-8
+        NormalizeCheck quick_check(NormalizeForm form, const char* str, size_t size) const {
+            UTFResult res;
+            return quick_check(form, str, size, res);
+        }
+
+        //offset of the last boundary in valid utf-8 str, or 0. text before it is normalized independently of text after it
+        size_t last_boundary(NormalizeForm form, const char* str, size_t size) const {
+            auto in = (const unsigned char*)str;
+            for (auto i = size; i > 0;) {
+                i--;
+                if ((in[i] & 0xc0) == 0x80) continue;
+                char32_t code;
+                int len;
+                utf_detail::utf8_decode_one(in + i, size - i, code, len);
+                if (is_boundary(form, code)) return i;
+            }
+            return 0;
+        }
+    };
+
+    constexpr std::uint8_t case_cased = 0x1;      //Lu, Ll, Lt or has a case mapping
+    constexpr std::uint8_t case_ignorable = 0x2;  //Mn, Me, Cf, Lm, Sk and case_ignorable_marks
+
+    //Word_Break MidLetter, MidNumLet and Single_Quote which are Case_Ignorable
+    constexpr char32_t case_ignorable_marks[] = {0x27, 0x2e, 0x3a, 0xb7, 0x387, 0x55f, 0x5f4, 0x2018, 0x2019,
+                                                 0x2024, 0x2027, 0xfe13, 0xfe52, 0xfe55, 0xff07, 0xff0e, 0xff1a};
+
+    //index of the code point before str[i] of valid utf-8 or utf-32
+    inline size_t utf_prev_index(const char* str, size_t i) {
+        do {
+            i--;
+        } while (i > 0 && ((unsigned char)str[i] & 0xc0) == 0x80);
+        return i;
+    }
+
+    inline size_t utf_prev_index(const char32_t*, size_t i) {
+        return i - 1;
+    }
+
+    //decode the code point at str[i] of valid utf-8 or utf-32 and return its length in units
+    inline int utf_decode_at(const char* str, size_t i, size_t size, char32_t& code) {
+        int len;
+        utf_detail::utf8_decode_one((const unsigned char*)str + i, size - i, code, len);
+        return len;
+    }
+
+    inline int utf_decode_at(const char32_t* str, size_t i, size_t, char32_t& code) {
+        code = str[i];
+        return 1;
+    }
+
+    //full case mappings over FlatTable
+    //most code points map to one code point, which is stored as delta in shared entries.
+    //only SpecialCasing and CaseFolding mappings to several code points are looked up by key.
+    //without CaseFolding.txt folding falls back to lowercase mapping
+    struct CaseTable {
+        struct Entry {
+            std::int32_t delta[case_kind_count] = {0};
+            std::uint8_t special = 0;  //1 << CaseKind which maps to several code points
+            std::uint8_t flags = 0;    //case_cased, case_ignorable
+            std::uint16_t reserved = 0;
+        };
+        std::vector<Entry> entries;  //entries[0] maps to itself
+        std::vector<std::uint16_t> stage1;
+        std::vector<std::uint16_t> stage2;
+        std::vector<std::uint32_t> special_keys;  //(code << 3) | kind, sorted
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> special_spans;  //offset in pool and size
+        std::vector<char32_t> pool;
+        bool built = false;
+
+        void clear() {
+            *this = CaseTable();
+        }
+
+        static const FlatCaseMapping* find_mapping(const FlatTable& flat, char32_t code, CaseKind kind) {
+            auto end = flat.case_mappings + flat.case_mapping_count;
+            auto found = std::lower_bound(flat.case_mappings, end, std::make_pair(code, kind), [](auto& m, auto key) {
+                return m.codepoint < key.first || (m.codepoint == key.first && m.kind < key.second);
+            });
+            if (found == end || found->codepoint != code || found->kind != kind) return nullptr;
+            return found;
+        }
+
+        bool build(const FlatTable& flat) {
+            clear();
+            if (!flat.is_loaded()) return false;
+            std::uint32_t cased_ids[3], ignorable_ids[5];
+            const char* cased_names[] = {"Lu", "Ll", "Lt"};
+            const char* ignorable_names[] = {"Mn", "Me", "Cf", "Lm", "Sk"};
+            for (auto i = 0; i < 3; i++) {
+                cased_ids[i] = ~0;
+                flat.find_property(property_category, cased_names[i], cased_ids[i]);
+            }
+            for (auto i = 0; i < 5; i++) {
+                ignorable_ids[i] = ~0;
+                flat.find_property(property_category, ignorable_names[i], ignorable_ids[i]);
+            }
+            bool folding = false;
+            for (size_t i = 0; i < flat.case_mapping_count; i++) {
+                folding = folding || flat.case_mappings[i].kind == case_fold_full || flat.case_mappings[i].kind == case_fold_simple;
+            }
+            std::map<std::vector<std::int32_t>, std::uint16_t> ids;
+            std::uint16_t last = 0;
+            auto intern = [&](const Entry& e) {
+                //neighbors mostly share an entry
+                if (::memcmp(&entries[last], &e, sizeof(Entry)) == 0) {
+                    return last;
+                }
+                std::vector<std::int32_t> key(e.delta, e.delta + case_kind_count);
+                key.push_back(e.special | (e.flags << 8));
+                if (auto found = ids.find(key); found != ids.end()) {
+                    return last = (*found).second;
+                }
+                last = (std::uint16_t)entries.size();
+                entries.push_back(e);
+                ids.emplace(std::move(key), last);
+                return last;
+            };
+            entries.push_back(Entry());
+            ids.emplace(std::vector<std::int32_t>(case_kind_count + 1, 0), 0);
+            std::vector<std::uint16_t> flatmap(codepoint_limit, 0);
+            for (char32_t code = 0; code < codepoint_limit; code++) {
+                auto rec = flat.find(code);
+                if (!rec) continue;
+                Entry e;
+                char32_t simple[case_kind_count] = {code, code, code, code, code};
+                if (rec->codepoint == code) {
+                    if (rec->case_flag & has_lowercase) simple[case_lower] = rec->lower;
+                    if (rec->case_flag & has_uppercase) simple[case_upper] = rec->upper;
+                    if (rec->case_flag & has_titlecase) simple[case_title] = rec->title;
+                }
+                for (auto k : {case_lower, case_upper, case_title}) {
+                    if (simple[k] != code) e.flags |= case_cased;
+                }
+                for (auto id : cased_ids) {
+                    if (rec->category == id) e.flags |= case_cased;
+                }
+                for (auto id : ignorable_ids) {
+                    if (rec->category == id) e.flags |= case_ignorable;
+                }
+                if (std::find(std::begin(case_ignorable_marks), std::end(case_ignorable_marks), code) != std::end(case_ignorable_marks)) {
+                    e.flags |= case_ignorable;
+                }
+                simple[case_fold_full] = simple[case_fold_simple] = simple[case_lower];
+                if (folding) {
+                    //status S if any, otherwise C
+                    auto full = find_mapping(flat, code, case_fold_full), s = find_mapping(flat, code, case_fold_simple);
+                    auto m = s && s->size == 1 ? s : full && full->size == 1 ? full : nullptr;
+                    simple[case_fold_full] = code;
+                    simple[case_fold_simple] = m ? flat.decomposition[m->offset] : code;
+                }
+                for (auto k = 0; k < case_kind_count; k++) {
+                    //simple folding is never several code points. full folding is full lowercase without CaseFolding.txt
+                    const FlatCaseMapping* m = nullptr;
+                    if (k == case_fold_full) {
+                        m = find_mapping(flat, code, folding ? case_fold_full : case_lower);
+                    }
+                    else if (k != case_fold_simple) {
+                        m = find_mapping(flat, code, (CaseKind)k);
+                    }
+                    if (m && m->size == 1) {
+                        simple[k] = flat.decomposition[m->offset];
+                    }
+                    else if (m) {
+                        e.special |= 1 << k;
+                        special_keys.push_back((code << 3) | k);
+                        special_spans.push_back({(std::uint32_t)pool.size(), m->size});
+                        pool.insert(pool.end(), flat.decomposition + m->offset, flat.decomposition + m->offset + m->size);
+                    }
+                    e.delta[k] = (std::int32_t)simple[k] - (std::int32_t)code;
+                }
+                if (entries.size() == 0xffff) return false;
+                flatmap[code] = intern(e);
+            }
+            std::map<std::vector<std::uint16_t>, std::uint16_t> pages;
+            stage1.resize(codepoint_limit >> codetable_shift);
+            for (size_t i = 0; i < stage1.size(); i++) {
+                auto begin = flatmap.begin() + (i << codetable_shift);
+                std::vector<std::uint16_t> page(begin, begin + codetable_page);
+                auto found = pages.find(page);
+                if (found == pages.end()) {
+                    auto id = (std::uint16_t)pages.size();
+                    stage2.insert(stage2.end(), page.begin(), page.end());
+                    found = pages.emplace(std::move(page), id).first;
+                }
+                stage1[i] = (*found).second;
+            }
+            built = true;
+            return true;
+        }
+
+        const Entry& get(char32_t code) const {
+            if (code >= codepoint_limit) return entries[0];
+            return entries[stage2[((size_t)stage1[code >> codetable_shift] << codetable_shift) | (code & (codetable_page - 1))]];
+        }
+
+        //mapping of code which is special in e
+        const char32_t* special(CaseKind kind, char32_t code, size_t& size) const {
+            auto found = std::lower_bound(special_keys.begin(), special_keys.end(), (code << 3) | kind);
+            auto& span = special_spans[found - special_keys.begin()];
+            size = span.second;
+            return pool.data() + span.first;
+        }
+
+        //Final_Sigma of SpecialCasing: in[begin,end) follows a cased letter and is not followed by one.
+        //case ignorable ones between them are skipped
+        template <class C>
+        bool final_sigma(const C* in, size_t begin, size_t end, size_t size) const {
+            char32_t code;
+            bool before = false;
+            for (auto i = begin; i > 0;) {
+                i = utf_prev_index(in, i);
+                utf_decode_at(in, i, size, code);
+                auto& e = get(code);
+                if (e.flags & case_ignorable) continue;
+                before = e.flags & case_cased;
+                break;
+            }
+            if (!before) return false;
+            for (auto i = end; i < size;) {
+                i += utf_decode_at(in, i, size, code);
+                auto& e = get(code);
+                if (e.flags & case_ignorable) continue;
+                return !(e.flags & case_cased);
+            }
+            return true;
+        }
+
+        //appends in mapped by kind to out. in must be valid (see utf8_validate)
+        //title maps a letter following a cased letter to lowercase and others to titlecase like str.title of python,
+        //but case ignorable ones like apostrophe do not end a word
+        template <class C, class Out>
+        void convert(CaseKind kind, const C* in, size_t size, Out& out) const {
+            using Unit = std::conditional_t<sizeof(C) == 1, char, char32_t>;
+            auto str = (const Unit*)in;
+            size_t i = 0, w = out.size();
+            bool cased = false;
+            auto reserve = [&](size_t n) {
+                if (out.size() < w + n) {
+                    out.resize((std::max)(out.size() * 2, w + n));
+                }
+            };
+            auto put = [&](char32_t code) {
+                w += utf_detail::encode_one(code, (Unit*)&out[w], false);
+            };
+            constexpr size_t max_units = sizeof(C) == 1 ? 4 : 1;
+            while (i < size) {
+                if (kind != case_title && (char32_t)str[i] < 0x80) {
+                    reserve(size - i);
+                    auto n = ascii_case(Sized<const Unit>{str + i, size - i}, (Unit*)&out[w], kind == case_upper);
+                    i += n;
+                    w += n;
+                    continue;
+                }
+                char32_t code;
+                auto len = utf_decode_at(str, i, size, code);
+                auto& e = get(code);
+                auto k = kind;
+                if (kind == case_title) {
+                    k = cased ? case_lower : case_title;
+                    if (!(e.flags & case_ignorable)) {
+                        cased = e.flags & case_cased;
+                    }
+                }
+                if (e.special & (1 << k)) {
+                    size_t n;
+                    auto p = special(k, code, n);
+                    reserve(n * max_units);
+                    for (size_t j = 0; j < n; j++) {
+                        put(p[j]);
+                    }
+                }
+                else {
+                    reserve(max_units);
+                    if (code == 0x3a3 && k == case_lower && final_sigma(str, i, i + len, size)) {
+                        put(0x3c2);
+                    }
+                    else {
+                        put(code + e.delta[k]);
+                    }
+                }
+                i += len;
+            }
+            out.resize(w);
+        }
+
+        void to_lower(const char* in, size_t size, std::string& out) const {
+            convert(case_lower, in, size, out);
+        }
+
+        void to_upper(const char* in, size_t size, std::string& out) const {
+            convert(case_upper, in, size, out);
+        }
+
+        void to_title(const char* in, size_t size, std::string& out) const {
+            convert(case_title, in, size, out);
+        }
+
+        void case_fold(const char* in, size_t size, std::string& out) const {
+            convert(case_fold_full, in, size, out);
+        }
+
+        void to_lower(const char32_t* in, size_t size, std::u32string& out) const {
+            convert(case_lower, in, size, out);
+        }
+
+        void to_upper(const char32_t* in, size_t size, std::u32string& out) const {
+            convert(case_upper, in, size, out);
+        }
+
+        void to_title(const char32_t* in, size_t size, std::u32string& out) const {
+            convert(case_title, in, size, out);
+        }
+
+        void case_fold(const char32_t* in, size_t size, std::u32string& out) const {
+            convert(case_fold_full, in, size, out);
+        }
+
+        //offset of the last code point in valid utf-8 str which is neither cased nor case ignorable, or 0.
+        //text before it is converted independently of text after it
+        size_t last_break(const char* str, size_t size) const {
+            for (auto i = size; i > 0;) {
+                i = utf_prev_index(str, i);
+                char32_t code;
+                utf_decode_at(str, i, size, code);
+                if (!(get(code).flags & (case_cased | case_ignorable))) return i;
+            }
+            return 0;
+        }
+    };
+
+    //guesses of GraphemeBreakProperty.txt and emoji-data.txt for binaries without them
+    constexpr CodeInterval guessed_prepend[] = {
+        {0x600, 0x605},
+        {0x6dd, 0x6dd},
+        {0x70f, 0x70f},
+        {0x8e2, 0x8e2},
+        {0x110bd, 0x110bd},
+        {0x110cd, 0x110cd},
+    };
+
+    //Extend which are not Mn or Me
+    constexpr CodeInterval guessed_extend[] = {
+        {0x200c, 0x200c},
+        {0xff9e, 0xff9f},
+        {0x1f3fb, 0x1f3ff},
+        {0xe0020, 0xe007f},
+    };
+
+    constexpr CodeInterval guessed_hangul[] = {
+        {0x1100, 0x115f},  //L
+        {0xa960, 0xa97c},
+        {0x1160, 0x11a7},  //V
+        {0xd7b0, 0xd7c6},
+        {0x11a8, 0x11ff},  //T
+        {0xd7cb, 0xd7fb},
+    };
+
+    //Extended_Pictographic of emoji-data 13.0
+    constexpr CodeInterval guessed_pictographic[] = {
+        {0xa9, 0xa9},
+        {0xae, 0xae},
+        {0x203c, 0x203c},
+        {0x2049, 0x2049},
+        {0x2122, 0x2122},
+        {0x2139, 0x2139},
+        {0x2194, 0x2199},
+        {0x21a9, 0x21aa},
+        {0x231a, 0x231b},
+        {0x2328, 0x2328},
+        {0x2388, 0x2388},
+        {0x23cf, 0x23cf},
+        {0x23e9, 0x23f3},
+        {0x23f8, 0x23fa},
+        {0x24c2, 0x24c2},
+        {0x25aa, 0x25ab},
+        {0x25b6, 0x25b6},
+        {0x25c0, 0x25c0},
+        {0x25fb, 0x25fe},
+        {0x2600, 0x2605},
+        {0x2607, 0x2612},
+        {0x2614, 0x2685},
+        {0x2690, 0x2705},
+        {0x2708, 0x2712},
+        {0x2714, 0x2714},
+        {0x2716, 0x2716},
+        {0x271d, 0x271d},
+        {0x2721, 0x2721},
+        {0x2728, 0x2728},
+        {0x2733, 0x2734},
+        {0x2744, 0x2744},
+        {0x2747, 0x2747},
+        {0x274c, 0x274c},
+        {0x274e, 0x274e},
+        {0x2753, 0x2755},
+        {0x2757, 0x2757},
+        {0x2763, 0x2767},
+        {0x2795, 0x2797},
+        {0x27a1, 0x27a1},
+        {0x27b0, 0x27b0},
+        {0x27bf, 0x27bf},
+        {0x2934, 0x2935},
+        {0x2b05, 0x2b07},
+        {0x2b1b, 0x2b1c},
+        {0x2b50, 0x2b50},
+        {0x2b55, 0x2b55},
+        {0x3030, 0x3030},
+        {0x303d, 0x303d},
+        {0x3297, 0x3297},
+        {0x3299, 0x3299},
+        {0x1f000, 0x1f0ff},
+        {0x1f10d, 0x1f10f},
+        {0x1f12f, 0x1f12f},
+        {0x1f16c, 0x1f171},
+        {0x1f17e, 0x1f17f},
+        {0x1f18e, 0x1f18e},
+        {0x1f191, 0x1f19a},
+        {0x1f1ad, 0x1f1e5},
+        {0x1f201, 0x1f20f},
+        {0x1f21a, 0x1f21a},
+        {0x1f22f, 0x1f22f},
+        {0x1f232, 0x1f23a},
+        {0x1f23c, 0x1f23f},
+        {0x1f249, 0x1f3fa},
+        {0x1f400, 0x1f53d},
+        {0x1f546, 0x1f64f},
+        {0x1f680, 0x1f6ff},
+        {0x1f774, 0x1f77f},
+        {0x1f7d5, 0x1f7ff},
+        {0x1f80c, 0x1f80f},
+        {0x1f848, 0x1f84f},
+        {0x1f85a, 0x1f85f},
+        {0x1f888, 0x1f88f},
+        {0x1f8ae, 0x1f8ff},
+        {0x1f90c, 0x1f93a},
+        {0x1f93c, 0x1f945},
+        {0x1f947, 0x1faff},
+        {0x1fc00, 0x1fffd},
+    };
+
+    inline bool in_intervals(const CodeInterval* begin, const CodeInterval* end, char32_t code) {
+        auto found = std::upper_bound(begin, end, code, [](auto c, auto& r) {
+            return c < r.first;
+        });
+        return found != begin && code <= found[-1].second;
+    }
+
+    template <size_t N>
+    bool in_intervals(const CodeInterval (&list)[N], char32_t code) {
+        return in_intervals(list, list + N, code);
+    }
+
+    //Extended_Pictographic ranges of emoji-data.txt, or guessed_pictographic if the binary doesn't have it
+    template <class F>
+    void each_pictographic(const FlatTable& flat, F&& f) {
+        auto pictographic = flat.ranges_of(range_extended_pictographic);
+        if (pictographic.first == pictographic.second) {
+            for (auto& r : guessed_pictographic) {
+                f(r.first, r.second);
+            }
+        }
+        for (auto r = pictographic.first; r != pictographic.second; r++) {
+            if (r->value) f((char32_t)r->first, (char32_t)r->last);
+        }
+    }
+
+    //small value of each code point in two stages. equal pages are shared
+    template <class T>
+    struct StageTable {
+        std::vector<std::uint16_t> stage1;
+        std::vector<T> stage2;
+
+        //values has codepoint_limit entries
+        void build(const std::vector<T>& values) {
+            stage1.clear();
+            stage2.clear();
+            //pages are compared as bytes
+            std::map<std::string, std::uint16_t> pages;
+            stage1.resize(codepoint_limit >> codetable_shift);
+            for (size_t i = 0; i < stage1.size(); i++) {
+                auto begin = values.begin() + (i << codetable_shift);
+                std::string page((const char*)&*begin, codetable_page * sizeof(T));
+                auto found = pages.find(page);
+                if (found == pages.end()) {
+                    auto id = (std::uint16_t)pages.size();
+                    stage2.insert(stage2.end(), begin, begin + codetable_page);
+                    found = pages.emplace(std::move(page), id).first;
+                }
+                stage1[i] = (*found).second;
+            }
+        }
+
+        T get(char32_t code) const {
+            if (code >= codepoint_limit) return 0;
+            return stage2[((size_t)stage1[code >> codetable_shift] << codetable_shift) | (code & (codetable_page - 1))];
+        }
+    };
+
+    //break class of each code point
+    using BreakClassTable = StageTable<std::uint8_t>;
+
+    enum GraphemeState {
+        grapheme_start = grapheme_break_count,  //before the first code point
+        grapheme_ep_zwj,                        //Extended_Pictographic Extend* ZWJ
+        grapheme_ri_pair,                       //second Regional_Indicator of a pair
+        grapheme_state_count,
+    };
+
+    constexpr std::uint8_t grapheme_break_bit = 0x80;
+
+    //rules of UAX #29 as a transition table. states below grapheme_break_count are the last class
+    //(gb_extended_pictographic is Extended_Pictographic Extend*)
+    struct GraphemeMachine {
+        std::uint8_t next[grapheme_state_count][grapheme_break_count] = {};
+
+        static constexpr bool joins(int s, int c) {
+            if (s == grapheme_start) return true;
+            if (s == gb_cr && c == gb_lf) return true;                                            //GB3
+            if (s == gb_cr || s == gb_lf || s == gb_control) return false;                        //GB4
+            if (c == gb_cr || c == gb_lf || c == gb_control) return false;                        //GB5
+            if (s == gb_l && (c == gb_l || c == gb_v || c == gb_lv || c == gb_lvt)) return true;  //GB6
+            if ((s == gb_lv || s == gb_v) && (c == gb_v || c == gb_t)) return true;               //GB7
+            if ((s == gb_lvt || s == gb_t) && c == gb_t) return true;                             //GB8
+            if (c == gb_extend || c == gb_zwj || c == gb_spacing_mark) return true;               //GB9, GB9a
+            if (s == gb_prepend) return true;                                                     //GB9b
+            if (s == grapheme_ep_zwj && c == gb_extended_pictographic) return true;               //GB11
+            if (s == gb_regional_indicator && c == gb_regional_indicator) return true;            //GB12, GB13
+            return false;                                                                         //GB999
+        }
+
+        static constexpr int advance(int s, int c) {
+            if (s == gb_extended_pictographic && c == gb_extend) return s;
+            if (s == gb_extended_pictographic && c == gb_zwj) return grapheme_ep_zwj;
+            if (s == gb_regional_indicator && c == gb_regional_indicator) return grapheme_ri_pair;
+            return c;
+        }
+
+        constexpr GraphemeMachine() {
+            for (auto s = 0; s < grapheme_state_count; s++) {
+                for (auto c = 0; c < grapheme_break_count; c++) {
+                    next[s][c] = (std::uint8_t)(advance(s, c) | (joins(s, c) ? 0 : grapheme_break_bit));
+                }
+            }
+        }
+    };
+
+    inline constexpr GraphemeMachine grapheme_machine;
+
+    //extended grapheme cluster boundaries over FlatTable. nothing is allocated while iterating
+    //classes come from GraphemeBreakProperty.txt and emoji-data.txt if the binary has them,
+    //otherwise they are guessed from general category
+    struct GraphemeTable {
+        BreakClassTable classes;
+        bool guessed = false;
+        bool built = false;
+
+        void clear() {
+            *this = GraphemeTable();
+        }
+
+        static std::uint8_t guess(const FlatTable& flat, char32_t code, const std::uint32_t (&ids)[7]) {
+            enum { cc, zl, zp, cf, mn, me, mc };
+            if (code == 0xd) return gb_cr;
+            if (code == 0xa) return gb_lf;
+            if (code == 0x200d) return gb_zwj;
+            if (code >= 0x1f1e6 && code <= 0x1f1ff) return gb_regional_indicator;
+            if (code >= hangul_sbase && code < hangul_sbase + hangul_scount) {
+                return (code - hangul_sbase) % hangul_tcount ? gb_lvt : gb_lv;
+            }
+            for (auto i = 0; i < 6; i++) {
+                if (in_intervals(guessed_hangul + i, guessed_hangul + i + 1, code)) return gb_l + i / 2;
+            }
+            if (in_intervals(guessed_prepend, code)) return gb_prepend;
+            if (in_intervals(guessed_extend, code)) return gb_extend;
+            auto rec = flat.find(code);
+            auto category = rec ? rec->category : (std::uint32_t)-1;
+            if (category == ids[mn] || category == ids[me]) return gb_extend;
+            if (category == ids[mc]) return gb_spacing_mark;
+            if (category == ids[cc] || category == ids[zl] || category == ids[zp] || category == ids[cf]) return gb_control;
+            return gb_other;
+        }
+
+        bool build(const FlatTable& flat) {
+            clear();
+            if (!flat.is_loaded()) return false;
+            std::vector<std::uint8_t> table(codepoint_limit, gb_other);
+            auto breaks = flat.ranges_of(range_grapheme_break);
+            guessed = breaks.first == breaks.second;
+            if (guessed) {
+                std::uint32_t ids[7];
+                const char* names[] = {"Cc", "Zl", "Zp", "Cf", "Mn", "Me", "Mc"};
+                for (auto i = 0; i < 7; i++) {
+                    ids[i] = ~0;
+                    flat.find_property(property_category, names[i], ids[i]);
+                }
+                for (char32_t code = 0; code < codepoint_limit; code++) {
+                    table[code] = guess(flat, code, ids);
+                }
+            }
+            for (auto r = breaks.first; r != breaks.second; r++) {
+                if (r->value >= gb_extended_pictographic) return false;
+                std::fill(table.begin() + r->first, table.begin() + r->last + 1, (std::uint8_t)r->value);
+            }
+            each_pictographic(flat, [&](char32_t first, char32_t last) {
+                for (auto code = first; code <= last; code++) {
+                    if (table[code] == gb_other) table[code] = gb_extended_pictographic;
+                }
+            });
+            classes.build(table);
+            built = true;
+            return true;
+        }
+
+        //GraphemeBreak of code
+        std::uint8_t get(char32_t code) const {
+            return classes.get(code);
+        }
+
+        //feed code as the next code point of text. true if a cluster boundary is before it.
+        //state starts with grapheme_start, so no boundary is reported before the first code point
+        bool step(std::uint8_t& state, char32_t code) const {
+            auto next = grapheme_machine.next[state][get(code)];
+            state = next & ~grapheme_break_bit;
+            return next & grapheme_break_bit;
+        }
+
+        //end of the cluster which begins at in[pos] of valid utf-8 or utf-32
+        template <class C>
+        size_t next_boundary(const C* in, size_t size, size_t pos) const {
+            using Unit = std::conditional_t<sizeof(C) == 1, char, char32_t>;
+            auto str = (const Unit*)in;
+            std::uint8_t state = grapheme_start;
+            while (pos < size) {
+                char32_t code;
+                auto len = utf_decode_at(str, pos, size, code);
+                if (step(state, code)) break;
+                pos += len;
+            }
+            return pos;
+        }
+
+        //call f with offset of each boundary in in[0,size) other than the start of text.
+        //state is carried over chunks, which must be split between code points
+        template <class C, class F>
+        void boundaries(std::uint8_t& state, const C* in, size_t size, F&& f) const {
+            using Unit = std::conditional_t<sizeof(C) == 1, char, char32_t>;
+            auto str = (const Unit*)in;
+            for (size_t i = 0; i < size;) {
+                char32_t code;
+                auto len = utf_decode_at(str, i, size, code);
+                if (step(state, code)) f(i);
+                i += len;
+            }
+        }
+
+        //count of clusters in valid utf-8 or utf-32
+        template <class C>
+        size_t count(const C* in, size_t size) const {
+            size_t ret = size ? 1 : 0;
+            std::uint8_t state = grapheme_start;
+            boundaries(state, in, size, [&](size_t) {
+                ret++;
+            });
+            return ret;
+        }
+    };
+
+    //guesses of WordBreakProperty.txt and SentenceBreakProperty.txt for binaries without them
+    constexpr CodeInterval guessed_newline[] = {
+        {0xb, 0xc},
+        {0x85, 0x85},
+        {0x2028, 0x2029},
+    };
+
+    constexpr CodeInterval guessed_katakana[] = {
+        {0x3031, 0x3035},
+        {0x309b, 0x309c},
+        {0x30a0, 0x30fa},
+        {0x30fc, 0x30ff},
+        {0x31f0, 0x31ff},
+        {0x32d0, 0x32fe},
+        {0x3300, 0x3357},
+        {0xff66, 0xff9d},
+        {0x1aff0, 0x1affe},
+        {0x1b000, 0x1b000},
+        {0x1b120, 0x1b122},
+        {0x1b164, 0x1b167},
+    };
+
+    constexpr CodeInterval guessed_hebrew_letter[] = {
+        {0x5d0, 0x5ea},
+        {0x5ef, 0x5f2},
+        {0xfb1d, 0xfb1d},
+        {0xfb1f, 0xfb28},
+        {0xfb2a, 0xfb4f},
+    };
+
+    //letters which are not ALetter (ideographs, Hiragana and scripts without spaces)
+    constexpr CodeInterval guessed_not_aletter[] = {
+        {0xe00, 0xeff},
+        {0x1000, 0x109f},
+        {0x1780, 0x17ff},
+        {0x1950, 0x19df},
+        {0x1a20, 0x1aaf},
+        {0x2e80, 0x2fdf},
+        {0x3005, 0x3007},
+        {0x3021, 0x3029},
+        {0x3038, 0x303b},
+        {0x3040, 0x309f},
+        {0x3400, 0x4dbf},
+        {0x4e00, 0x9fff},
+        {0xa9e0, 0xa9ff},
+        {0xaa60, 0xaadf},
+        {0xf900, 0xfaff},
+        {0x11700, 0x1174f},
+        {0x1b001, 0x1b11f},
+        {0x20000, 0x3ffff},
+    };
+
+    constexpr CodeInterval guessed_midnumlet[] = {
+        {0x2e, 0x2e},
+        {0x2018, 0x2019},
+        {0x2024, 0x2024},
+        {0xfe52, 0xfe52},
+        {0xff07, 0xff07},
+        {0xff0e, 0xff0e},
+    };
+
+    constexpr CodeInterval guessed_midletter[] = {
+        {0x3a, 0x3a},
+        {0xb7, 0xb7},
+        {0x387, 0x387},
+        {0x55f, 0x55f},
+        {0x5f4, 0x5f4},
+        {0x2027, 0x2027},
+        {0xfe13, 0xfe13},
+        {0xfe55, 0xfe55},
+        {0xff1a, 0xff1a},
+    };
+
+    constexpr CodeInterval guessed_midnum[] = {
+        {0x2c, 0x2c},
+        {0x3b, 0x3b},
+        {0x37e, 0x37e},
+        {0x589, 0x589},
+        {0x60c, 0x60d},
+        {0x66c, 0x66c},
+        {0x7f8, 0x7f8},
+        {0x2044, 0x2044},
+        {0xfe10, 0xfe10},
+        {0xfe14, 0xfe14},
+        {0xfe50, 0xfe50},
+        {0xfe54, 0xfe54},
+        {0xff0c, 0xff0c},
+        {0xff1b, 0xff1b},
+    };
+
+    //White_Space other than line and paragraph separators
+    constexpr CodeInterval guessed_sentence_space[] = {
+        {0x9, 0x9},
+        {0xb, 0xc},
+        {0x20, 0x20},
+        {0xa0, 0xa0},
+        {0x1680, 0x1680},
+        {0x2000, 0x200a},
+        {0x202f, 0x202f},
+        {0x205f, 0x205f},
+        {0x3000, 0x3000},
+    };
+
+    constexpr CodeInterval guessed_aterm[] = {
+        {0x2e, 0x2e},
+        {0x2024, 0x2024},
+        {0xfe52, 0xfe52},
+        {0xff0e, 0xff0e},
+    };
+
+    constexpr CodeInterval guessed_sterm[] = {
+        {0x21, 0x21},
+        {0x3f, 0x3f},
+        {0x589, 0x589},
+        {0x61d, 0x61f},
+        {0x6d4, 0x6d4},
+        {0x700, 0x702},
+        {0x7f9, 0x7f9},
+        {0x837, 0x837},
+        {0x839, 0x839},
+        {0x83d, 0x83e},
+        {0x964, 0x965},
+        {0x104a, 0x104b},
+        {0x1362, 0x1362},
+        {0x1367, 0x1368},
+        {0x166e, 0x166e},
+        {0x1735, 0x1736},
+        {0x1803, 0x1803},
+        {0x1809, 0x1809},
+        {0x1944, 0x1945},
+        {0x1aa8, 0x1aab},
+        {0x1b5a, 0x1b5b},
+        {0x1b5e, 0x1b5f},
+        {0x1c3b, 0x1c3c},
+        {0x1c7e, 0x1c7f},
+        {0x203c, 0x203d},
+        {0x2047, 0x2049},
+        {0x2e2e, 0x2e2e},
+        {0x2e3c, 0x2e3c},
+        {0x3002, 0x3002},
+        {0xa4ff, 0xa4ff},
+        {0xa60e, 0xa60f},
+        {0xa6f3, 0xa6f3},
+        {0xa6f7, 0xa6f7},
+        {0xa876, 0xa877},
+        {0xa8ce, 0xa8cf},
+        {0xa92f, 0xa92f},
+        {0xa9c8, 0xa9c9},
+        {0xaa5d, 0xaa5f},
+        {0xaaf0, 0xaaf1},
+        {0xabeb, 0xabeb},
+        {0xfe56, 0xfe57},
+        {0xff01, 0xff01},
+        {0xff1f, 0xff1f},
+        {0xff61, 0xff61},
+    };
+
+    constexpr CodeInterval guessed_scontinue[] = {
+        {0x2c, 0x2d},
+        {0x3a, 0x3b},
+        {0x37e, 0x37e},
+        {0x55d, 0x55d},
+        {0x60c, 0x60d},
+        {0x7f8, 0x7f8},
+        {0x1802, 0x1802},
+        {0x1808, 0x1808},
+        {0x2013, 0x2014},
+        {0x3001, 0x3001},
+        {0xfe10, 0xfe11},
+        {0xfe13, 0xfe13},
+        {0xfe31, 0xfe32},
+        {0xfe50, 0xfe51},
+        {0xfe55, 0xfe55},
+        {0xfe58, 0xfe58},
+        {0xfe63, 0xfe63},
+        {0xff0c, 0xff0d},
+        {0xff1a, 0xff1b},
+        {0xff64, 0xff64},
+    };
+
+    //bits of SegmentMachine entries over the next state
+    constexpr std::uint16_t segment_state_mask = 0xff;
+    constexpr std::uint16_t segment_break = 0x100;    //boundary before the code point
+    constexpr std::uint16_t segment_pending = 0x200;  //boundary before the code point unless later ones cancel it
+    constexpr std::uint16_t segment_resolve = 0x400;  //the pending boundary is a boundary
+
+    constexpr int segment_max_states = 64;
+    constexpr int segment_max_classes = 24;
+
+    //rules of segmentation as a transition table of states and break classes.
+    //the column after the last class is end of text
+    struct SegmentMachine {
+        int states = 0;
+        int classes = 0;
+        std::uint16_t next[segment_max_states][segment_max_classes] = {};
+
+        constexpr SegmentMachine(int states, int classes, std::uint16_t (*transition)(int, int))
+            : states(states), classes(classes) {
+            for (auto s = 0; s < states; s++) {
+                for (auto c = 0; c <= classes; c++) {
+                    next[s][c] = transition(s, c);
+                }
+            }
+        }
+    };
+
+    //what decides word boundaries after text so far. a state is WordState * 4,
+    //+2 after ZWJ (WB3c) and +1 after WSegSpace (WB3d)
+    enum WordState {
+        word_start,  //before the first code point
+        word_cr,
+        word_newline,
+        word_other,
+        word_hebrew_letter,
+        word_aletter,
+        word_numeric,
+        word_katakana,
+        word_extendnumlet,
+        word_ri_odd,
+        word_ri_even,
+        word_aletter_mid,    //AHLetter (MidLetter | MidNumLetQ), boundary before mid pending (WB6)
+        word_hebrew_dquote,  //Hebrew_Letter Double_Quote, boundary before quote pending (WB7b)
+        word_numeric_mid,    //Numeric (MidNum | MidNumLetQ), boundary before mid pending (WB12)
+        word_hebrew_squote,  //Hebrew_Letter Single_Quote (WB7a)
+        word_state_kinds,
+    };
+
+    constexpr int word_state_count = word_state_kinds * 4;
+
+    constexpr int word_state(int kind, int c) {
+        return kind * 4 + (c == wb_zwj ? 2 : 0) + (c == wb_wsegspace ? 1 : 0);
+    }
+
+    constexpr int word_kind_of(int c) {
+        switch (c) {
+            case wb_cr:
+                return word_cr;
+            case wb_lf:
+            case wb_newline:
+                return word_newline;
+            case wb_hebrew_letter:
+                return word_hebrew_letter;
+            case wb_aletter:
+            case wb_aletter_pictographic:
+                return word_aletter;
+            case wb_numeric:
+                return word_numeric;
+            case wb_katakana:
+                return word_katakana;
+            case wb_extendnumlet:
+                return word_extendnumlet;
+            case wb_regional_indicator:
+                return word_ri_odd;
+            default:
+                return word_other;
+        }
+    }
+
+    constexpr bool is_ahletter(int c) {
+        return c == wb_hebrew_letter || c == wb_aletter || c == wb_aletter_pictographic;
+    }
+
+    //rules of UAX #29 word boundaries. c == word_break_count is end of text
+    constexpr std::uint16_t word_transition(int s, int c) {
+        auto kind = s / 4;
+        auto pending = kind == word_aletter_mid || kind == word_hebrew_dquote || kind == word_numeric_mid;
+        std::uint16_t resolve = pending ? segment_resolve : 0;
+        if (c == word_break_count) return (std::uint16_t)(s | resolve);
+        auto fresh = (std::uint16_t)word_state(word_kind_of(c), c);
+        if (kind == word_start) return fresh;
+        if (kind == word_cr && c == wb_lf) return fresh;                                    //WB3
+        if (kind == word_cr || kind == word_newline) return fresh | segment_break;          //WB3a
+        if (c == wb_cr || c == wb_lf || c == wb_newline) return fresh | segment_break | resolve;  //WB3b
+        if (c == wb_extend || c == wb_format || c == wb_zwj) {
+            return (std::uint16_t)(kind * 4 + (c == wb_zwj ? 2 : 0));  //WB4
+        }
+        auto joins = (s & 2) && (c == wb_extended_pictographic || c == wb_aletter_pictographic);  //WB3c
+        joins = joins || ((s & 1) && c == wb_wsegspace);                                          //WB3d
+        if (kind == word_aletter_mid || kind == word_hebrew_squote) {
+            if (is_ahletter(c)) return fresh;  //WB7
+            kind = word_other;
+        }
+        else if (kind == word_hebrew_dquote) {
+            if (c == wb_hebrew_letter) return fresh;  //WB7c
+            kind = word_other;
+        }
+        else if (kind == word_numeric_mid) {
+            if (c == wb_numeric) return fresh;  //WB11
+            kind = word_other;
+        }
+        auto mid = c == wb_midnumlet || c == wb_single_quote;
+        switch (kind) {
+            case word_hebrew_letter:
+                if (c == wb_single_quote) return (std::uint16_t)word_state(word_hebrew_squote, c);  //WB7a
+                if (c == wb_double_quote) {
+                    return (std::uint16_t)(word_state(word_hebrew_dquote, c) | segment_pending);  //WB7b
+                }
+                [[fallthrough]];
+            case word_aletter:
+                if (is_ahletter(c) || c == wb_numeric || c == wb_extendnumlet) joins = true;  //WB5, WB9, WB13a
+                else if (c == wb_midletter || mid) {
+                    return (std::uint16_t)(word_state(word_aletter_mid, c) | segment_pending);  //WB6
+                }
+                break;
+            case word_numeric:
+                if (is_ahletter(c) || c == wb_numeric || c == wb_extendnumlet) joins = true;  //WB8, WB10, WB13a
+                else if (c == wb_midnum || mid) {
+                    return (std::uint16_t)(word_state(word_numeric_mid, c) | segment_pending);  //WB12
+                }
+                break;
+            case word_katakana:
+                if (c == wb_katakana || c == wb_extendnumlet) joins = true;  //WB13, WB13a
+                break;
+            case word_extendnumlet:
+                if (is_ahletter(c) || c == wb_numeric || c == wb_katakana || c == wb_extendnumlet) joins = true;  //WB13a, WB13b
+                break;
+            case word_ri_odd:
+                if (c == wb_regional_indicator) return (std::uint16_t)(word_state(word_ri_even, c) | resolve);  //WB15, WB16
+                break;
+        }
+        return fresh | resolve | (joins ? 0 : segment_break);  //WB999
+    }
+
+    //what decides sentence boundaries after text so far
+    enum SentenceState {
+        sentence_start,  //before the first code point
+        sentence_cr,
+        sentence_parasep,
+        sentence_other,
+        sentence_upper_lower,
+        sentence_pending,  //ATerm Close* Sp* X, boundary before X pending until Lower cancels it (SB8)
+        sentence_aterm,
+        sentence_upper_aterm,  //(Upper | Lower) ATerm (SB7)
+        sentence_aterm_close,
+        sentence_aterm_sp,
+        sentence_sterm,
+        sentence_sterm_close,
+        sentence_sterm_sp,
+        sentence_state_count,
+    };
+
+    //rules of UAX #29 sentence boundaries. c == sentence_break_count is end of text
+    constexpr std::uint16_t sentence_transition(int s, int c) {
+        if (c == sentence_break_count) return (std::uint16_t)(s | (s == sentence_pending ? segment_resolve : 0));
+        auto parasep = c == sb_cr || c == sb_lf || c == sb_sep;
+        std::uint16_t fresh = sentence_other;
+        if (c == sb_cr) fresh = sentence_cr;
+        else if (parasep) fresh = sentence_parasep;
+        else if (c == sb_upper || c == sb_lower) fresh = sentence_upper_lower;
+        else if (c == sb_aterm) fresh = s == sentence_upper_lower ? sentence_upper_aterm : sentence_aterm;
+        else if (c == sb_sterm) fresh = sentence_sterm;
+        if (s == sentence_start) return fresh;
+        if (s == sentence_cr && c == sb_lf) return fresh;                        //SB3
+        if (s == sentence_cr || s == sentence_parasep) return fresh | segment_break;  //SB4
+        if (c == sb_extend || c == sb_format) return (std::uint16_t)s;           //SB5
+        auto closing = parasep || c == sb_oletter || c == sb_upper || c == sb_lower || c == sb_aterm || c == sb_sterm;
+        if (s == sentence_pending) {
+            if (c == sb_lower) return fresh;  //SB8
+            return closing ? fresh | segment_resolve : (std::uint16_t)s;
+        }
+        if (s < sentence_aterm) return fresh;  //SB998
+        auto aterm = s <= sentence_aterm_sp;
+        if ((s == sentence_aterm || s == sentence_upper_aterm) && c == sb_numeric) return fresh;  //SB6
+        if (s == sentence_upper_aterm && c == sb_upper) return fresh;                             //SB7
+        auto spaced = s == sentence_aterm_sp || s == sentence_sterm_sp;
+        if (c == sb_close && !spaced) return aterm ? sentence_aterm_close : sentence_sterm_close;  //SB9
+        if (c == sb_sp) return aterm ? sentence_aterm_sp : sentence_sterm_sp;                      //SB9, SB10
+        if (parasep) return fresh;                                                                 //SB9, SB10
+        if (c == sb_scontinue || c == sb_aterm || c == sb_sterm) return fresh;                     //SB8a
+        if (aterm && c == sb_lower) return fresh;                                                  //SB8
+        if (aterm && !closing) return sentence_pending | segment_pending;                          //SB8
+        return fresh | segment_break;                                                              //SB11
+    }
+
+    inline constexpr SegmentMachine word_machine(word_state_count, word_break_count, word_transition);
+    inline constexpr SegmentMachine sentence_machine(sentence_state_count, sentence_break_count, sentence_transition);
+
+    //position in text carried over chunks of it
+    struct SegmentCursor {
+        std::uint8_t state = 0;  //start of text
+        size_t offset = 0;       //offset of the next chunk
+        size_t pending = 0;      //offset of the pending boundary
+    };
+
+    //word or sentence boundaries over FlatTable by precomputed transitions. nothing is allocated while iterating.
+    //rules which look ahead (WB6, WB7b, WB12 and SB8) leave a pending boundary which later code points
+    //settle, so a boundary may be reported after the code points following it are fed
+    struct SegmentTable {
+        BreakClassTable classes;
+        const SegmentMachine* machine = nullptr;
+        bool guessed = false;
+        bool built = false;
+
+        enum { mn, me, mc, cf, lu, ll, lt, lm, lo, nl, nd, pc, zs, ps, pe, pi, pf, category_count };
+
+        void clear() {
+            *this = SegmentTable();
+        }
+
+        static std::uint8_t guess_word(const FlatTable& flat, char32_t code, const std::uint32_t* ids) {
+            if (code == 0xd) return wb_cr;
+            if (code == 0xa) return wb_lf;
+            if (code == 0x200d) return wb_zwj;
+            if (code == 0x22) return wb_double_quote;
+            if (code == 0x27) return wb_single_quote;
+            if (code == 0x202f) return wb_extendnumlet;
+            if (code >= 0x1f1e6 && code <= 0x1f1ff) return wb_regional_indicator;
+            if (in_intervals(guessed_newline, code)) return wb_newline;
+            if (in_intervals(guessed_extend, code)) return wb_extend;
+            if (in_intervals(guessed_katakana, code)) return wb_katakana;
+            if (in_intervals(guessed_midnumlet, code)) return wb_midnumlet;
+            if (in_intervals(guessed_midletter, code)) return wb_midletter;
+            if (in_intervals(guessed_midnum, code)) return wb_midnum;
+            auto rec = flat.find(code);
+            auto category = rec ? rec->category : (std::uint32_t)-1;
+            auto is = [&](int i) {
+                return category == ids[i];
+            };
+            if (is(mn) || is(me) || is(mc)) return wb_extend;
+            if (is(cf)) return code == 0x200b ? wb_other : wb_format;
+            if (is(nd)) return wb_numeric;
+            if (is(pc)) return wb_extendnumlet;
+            if (is(zs)) return code == 0xa0 || code == 0x2007 ? wb_other : wb_wsegspace;
+            if (is(lu) || is(ll) || is(lt) || is(lm) || is(lo) || is(nl)) {
+                if (in_intervals(guessed_hebrew_letter, code)) return wb_hebrew_letter;
+                return in_intervals(guessed_not_aletter, code) ? wb_other : wb_aletter;
+            }
+            return wb_other;
+        }
+
+        static std::uint8_t guess_sentence(const FlatTable& flat, char32_t code, const std::uint32_t* ids) {
+            if (code == 0xd) return sb_cr;
+            if (code == 0xa) return sb_lf;
+            if (code == 0x85 || code == 0x2028 || code == 0x2029) return sb_sep;
+            if (code == 0x200d || in_intervals(guessed_extend, code)) return sb_extend;
+            if (code == 0x22 || code == 0x27) return sb_close;
+            if (code == 0xaa || code == 0xba) return sb_lower;
+            if (in_intervals(guessed_sentence_space, code)) return sb_sp;
+            if (in_intervals(guessed_aterm, code)) return sb_aterm;
+            if (in_intervals(guessed_sterm, code)) return sb_sterm;
+            if (in_intervals(guessed_scontinue, code)) return sb_scontinue;
+            auto rec = flat.find(code);
+            auto category = rec ? rec->category : (std::uint32_t)-1;
+            auto is = [&](int i) {
+                return category == ids[i];
+            };
+            if (is(mn) || is(me) || is(mc)) return sb_extend;
+            if (is(cf)) return sb_format;
+            if (is(ll)) return sb_lower;
+            if (is(lu) || is(lt)) return sb_upper;
+            if (is(lm) || is(lo) || is(nl)) return sb_oletter;
+            if (is(nd)) return sb_numeric;
+            if (is(ps) || is(pe) || is(pi) || is(pf)) return sb_close;
+            return sb_other;
+        }
+
+        //kind is range_word_break or range_sentence_break
+        bool build(const FlatTable& flat, RangePropertyKind kind) {
+            clear();
+            if (!flat.is_loaded()) return false;
+            auto word = kind == range_word_break;
+            if (!word && kind != range_sentence_break) return false;
+            std::vector<std::uint8_t> table(codepoint_limit, 0);
+            auto breaks = flat.ranges_of(kind);
+            guessed = breaks.first == breaks.second;
+            if (guessed) {
+                std::uint32_t ids[category_count];
+                const char* names[] = {"Mn", "Me", "Mc", "Cf", "Lu", "Ll", "Lt", "Lm", "Lo",
+                                       "Nl", "Nd", "Pc", "Zs", "Ps", "Pe", "Pi", "Pf"};
+                for (auto i = 0; i < category_count; i++) {
+                    ids[i] = ~0;
+                    flat.find_property(property_category, names[i], ids[i]);
+                }
+                for (char32_t code = 0; code < codepoint_limit; code++) {
+                    table[code] = word ? guess_word(flat, code, ids) : guess_sentence(flat, code, ids);
+                }
+            }
+            for (auto r = breaks.first; r != breaks.second; r++) {
+                if (r->value >= (word ? (int)wb_extended_pictographic : (int)sentence_break_count)) return false;
+                std::fill(table.begin() + r->first, table.begin() + r->last + 1, (std::uint8_t)r->value);
+            }
+            if (word) {
+                each_pictographic(flat, [&](char32_t first, char32_t last) {
+                    for (auto code = first; code <= last; code++) {
+                        if (table[code] == wb_other) table[code] = wb_extended_pictographic;
+                        else if (table[code] == wb_aletter) table[code] = wb_aletter_pictographic;
+                    }
+                });
+            }
+            classes.build(table);
+            machine = word ? &word_machine : &sentence_machine;
+            built = true;
+            return true;
+        }
+
+        //WordBreak or SentenceBreak of code
+        std::uint8_t get(char32_t code) const {
+            return classes.get(code);
+        }
+
+        //feed code at offset pos of text. f is called with offsets of boundaries settled by it in order
+        template <class F>
+        void step(SegmentCursor& cur, char32_t code, size_t pos, F&& f) const {
+            auto next = machine->next[cur.state][get(code)];
+            cur.state = (std::uint8_t)(next & segment_state_mask);
+            if (next & segment_resolve) f(cur.pending);
+            if (next & segment_pending) cur.pending = pos;
+            if (next & segment_break) f(pos);
+        }
+
+        //call f with offset of each boundary in text other than the start and the end of it.
+        //chunks must be split between code points. offsets count from the first chunk
+        template <class C, class F>
+        void boundaries(SegmentCursor& cur, const C* in, size_t size, F&& f) const {
+            using Unit = std::conditional_t<sizeof(C) == 1, char, char32_t>;
+            auto str = (const Unit*)in;
+            for (size_t i = 0; i < size;) {
+                char32_t code;
+                auto len = utf_decode_at(str, i, size, code);
+                step(cur, code, cur.offset + i, f);
+                i += len;
+            }
+            cur.offset += size;
+        }
+
+        //true if a boundary at cur.pending is not settled yet
+        bool is_pending(const SegmentCursor& cur) const {
+            return machine->next[cur.state][machine->classes] & segment_resolve;
+        }
+
+        //end of text. f is called with the pending boundary if any
+        template <class F>
+        void finish(SegmentCursor& cur, F&& f) const {
+            auto next = machine->next[cur.state][machine->classes];
+            cur.state = (std::uint8_t)(next & segment_state_mask);
+            if (next & segment_resolve) f(cur.pending);
+        }
+
+        //end of the segment which begins at in[pos] of valid utf-8 or utf-32
+        template <class C>
+        size_t next_boundary(const C* in, size_t size, size_t pos) const {
+            using Unit = std::conditional_t<sizeof(C) == 1, char, char32_t>;
+            auto str = (const Unit*)in;
+            SegmentCursor cur;
+            auto found = size;
+            auto done = false;
+            auto settle = [&](size_t at) {
+                if (!done) found = at;
+                done = true;
+            };
+            for (auto i = pos; i < size && !done;) {
+                char32_t code;
+                auto len = utf_decode_at(str, i, size, code);
+                step(cur, code, i, settle);
+                i += len;
+            }
+            if (!done) finish(cur, settle);
+            return found;
+        }
+
+        //count of segments in valid utf-8 or utf-32
+        template <class C>
+        size_t count(const C* in, size_t size) const {
+            size_t ret = size ? 1 : 0;
+            SegmentCursor cur;
+            auto add = [&](size_t) {
+                ret++;
+            };
+            boundaries(cur, in, size, add);
+            finish(cur, add);
+            return ret;
+        }
+    };
+
+    //scripts by property_script id. PropertyDict::limit of scripts
+    using ScriptSet = std::bitset<0x100>;
+
+    //maximal run of text in one script. script is property_script id
+    struct ScriptRun {
+        size_t begin = 0;
+        size_t end = 0;
+        std::uint16_t script = 0;
+    };
+
+    //run of text carried over chunks of it
+    struct ScriptCursor {
+        ScriptSet candidates = ScriptSet().set();  //scripts every code point of the run can be in
+        int script = -1;                           //first strong script of the run still in candidates
+        size_t begin = 0;
+        size_t offset = 0;  //offset of the next chunk
+    };
+
+    //Script and Script_Extensions over FlatTable for itemizing text into script runs (UAX #24).
+    //Common and Inherited take the script of the run around them and a code point with Script_Extensions
+    //continues a run in any of its scripts. runs are found in one pass without allocation
+    struct ScriptTable {
+        struct Entry {
+            ScriptSet scripts;     //scripts of runs the code point can be in
+            std::uint16_t script = 0;
+            bool strong = false;   //script is not Common or Inherited
+            bool any = false;      //scripts has all bits
+        };
+
+        StageTable<std::uint16_t> index;
+        std::vector<Entry> entries;
+        std::uint16_t common = 0;
+        bool built = false;
+
+        void clear() {
+            *this = ScriptTable();
+        }
+
+        //false if the binary has no Scripts.txt
+        bool build(const FlatTable& flat) {
+            clear();
+            if (!flat.is_loaded()) return false;
+            auto scripts = flat.ranges_of(range_script);
+            if (scripts.first == scripts.second || flat.property_size[property_script] > ScriptSet().size()) return false;
+            std::uint32_t unknown = 0, common_id = 0, inherited = ~0;
+            flat.find_property(property_script, "Unknown", unknown);
+            flat.find_property(property_script, "Common", common_id);
+            flat.find_property(property_script, "Inherited", inherited);
+            common = (std::uint16_t)common_id;
+            std::vector<std::uint16_t> sc(codepoint_limit, (std::uint16_t)unknown), scx(codepoint_limit, 0);
+            for (auto r = scripts.first; r != scripts.second; r++) {
+                std::fill(sc.begin() + r->first, sc.begin() + r->last + 1, r->value);
+            }
+            auto extensions = flat.ranges_of(range_script_extensions);
+            for (auto r = extensions.first; r != extensions.second; r++) {
+                std::fill(scx.begin() + r->first, scx.begin() + r->last + 1, r->value);
+            }
+            std::vector<ScriptSet> sets(flat.property_size[property_script_extensions]);
+            for (size_t i = 1; i < sets.size(); i++) {
+                std::string_view names = flat.property(property_script_extensions, (std::uint32_t)i);
+                while (names.size()) {
+                    auto end = names.find(' ');
+                    std::uint32_t id;
+                    if (flat.find_property(property_script, std::string(names.substr(0, end)).c_str(), id)) {
+                        sets[i][id] = true;
+                    }
+                    names = end == ~0 ? std::string_view() : names.substr(end + 1);
+                }
+            }
+            std::map<std::pair<std::uint16_t, std::uint16_t>, std::uint16_t> ids;
+            std::vector<std::uint16_t> table(codepoint_limit);
+            for (char32_t code = 0; code < codepoint_limit; code++) {
+                if (code && sc[code] == sc[code - 1] && scx[code] == scx[code - 1]) {
+                    table[code] = table[code - 1];
+                    continue;
+                }
+                auto key = std::make_pair(sc[code], scx[code]);
+                auto found = ids.find(key);
+                if (found == ids.end()) {
+                    Entry e;
+                    e.script = sc[code];
+                    e.strong = e.script != common && e.script != inherited;
+                    if (scx[code] && scx[code] < sets.size() && sets[scx[code]].any()) {
+                        e.scripts = sets[scx[code]];
+                    }
+                    else if (e.strong) {
+                        e.scripts[e.script] = true;
+                    }
+                    else {
+                        e.scripts.set();
+                    }
+                    e.any = e.scripts.all();
+                    found = ids.emplace(key, (std::uint16_t)entries.size()).first;
+                    entries.push_back(e);
+                }
+                table[code] = (*found).second;
+            }
+            index.build(table);
+            built = true;
+            return true;
+        }
+
+        //Script of code as property_script id
+        std::uint16_t get(char32_t code) const {
+            return entries[index.get(code)].script;
+        }
+
+        std::uint16_t resolve(const ScriptCursor& cur) const {
+            if (cur.script >= 0) return (std::uint16_t)cur.script;
+            if (cur.candidates.all()) return common;
+            for (size_t i = 0; i < cur.candidates.size(); i++) {
+                if (cur.candidates[i]) return (std::uint16_t)i;
+            }
+            return common;
+        }
+
+        //call f(begin, end, script) with each run of text but the last one, which finish reports.
+        //chunks must be split between code points. offsets count from the first chunk
+        template <class C, class F>
+        void each_run(ScriptCursor& cur, const C* in, size_t size, F&& f) const {
+            using Unit = std::conditional_t<sizeof(C) == 1, char, char32_t>;
+            auto str = (const Unit*)in;
+            for (size_t i = 0; i < size;) {
+                char32_t code;
+                auto len = utf_decode_at(str, i, size, code);
+                auto& e = entries[index.get(code)];
+                i += len;
+                if (e.any) continue;
+                auto next = cur.candidates & e.scripts;
+                if (next.none()) {
+                    auto pos = cur.offset + i - len;
+                    f(cur.begin, pos, resolve(cur));
+                    cur.begin = pos;
+                    cur.script = -1;
+                    next = e.scripts;
+                }
+                cur.candidates = next;
+                if (cur.script >= 0 && !next[cur.script]) cur.script = -1;
+                if (cur.script < 0 && e.strong && next[e.script]) cur.script = e.script;
+            }
+            cur.offset += size;
+        }
+
+        //end of text. f is called with the last run if text is not empty
+        template <class F>
+        void finish(ScriptCursor& cur, F&& f) const {
+            if (cur.offset > cur.begin) f(cur.begin, cur.offset, resolve(cur));
+            cur.candidates.set();
+            cur.script = -1;
+            cur.begin = cur.offset;
+        }
+    };
+
+    //maximal same-script runs of valid utf-8 or utf-32. nothing but the result is allocated
+    template <class C>
+    std::vector<ScriptRun> script_runs(const ScriptTable& table, const C* in, size_t size) {
+        std::vector<ScriptRun> ret;
+        ScriptCursor cur;
+        auto add = [&](size_t begin, size_t end, std::uint16_t script) {
+            ret.push_back(ScriptRun{begin, end, script});
+        };
+        table.each_run(cur, in, size, add);
+        table.finish(cur, add);
+        return ret;
+    }
+
+    //columns of a code point in terminals like wcwidth
+    enum DisplayWidth {
+        width_zero,
+        width_narrow,
+        width_wide,
+        width_control,  //C0, C1 and DEL. no columns
+    };
+
+    //Hangul Jungseong and Jongseong are zero width though they are Lo
+    constexpr CodeInterval zero_width_jamo[] = {
+        {0x1160, 0x11ff},
+        {0xd7b0, 0xd7ff},
+    };
+
+    //display width of code points packed in 2 bits over FlatTable.
+    //East_Asian_Width W and F and Emoji_Presentation (emoji-data.txt if the binary has it) are wide,
+    //Mn, Me and Cf other than soft hyphen are zero width
+    struct WidthTable {
+        static constexpr size_t page_bytes = codetable_page / 4;
+        std::vector<std::uint16_t> stage1;
+        std::vector<std::uint8_t> stage2;  //pages of page_bytes
+        bool built = false;
+
+        void clear() {
+            *this = WidthTable();
+        }
+
+        bool build(const FlatTable& flat) {
+            clear();
+            if (!flat.is_loaded()) return false;
+            std::uint32_t ids[7], wide[2];
+            const char* names[] = {"Cc", "Mn", "Me", "Cf", "Zl", "Zp", "Cn"};
+            const char* wide_names[] = {"W", "F"};
+            for (auto i = 0; i < 7; i++) {
+                ids[i] = ~0;
+                flat.find_property(property_category, names[i], ids[i]);
+            }
+            for (auto i = 0; i < 2; i++) {
+                wide[i] = ~0;
+                flat.find_property(property_east_asian_width, wide_names[i], wide[i]);
+            }
+            std::vector<std::uint8_t> widths(codepoint_limit, width_narrow);
+            for (char32_t code = 0; code < codepoint_limit; code++) {
+                auto rec = flat.find(code);
+                auto& w = widths[code];
+                if (!rec || rec->category == ids[6]) {
+                    //unassigned ones of CJK planes are W by default
+                    if (code >= 0x20000 && code <= 0x3fffd) w = width_wide;
+                    continue;
+                }
+                if (rec->category == ids[0]) {
+                    w = width_control;
+                }
+                else if ((rec->category == ids[1] || rec->category == ids[2] || rec->category == ids[3] ||
+                          rec->category == ids[4] || rec->category == ids[5]) &&
+                         code != 0xad) {
+                    w = width_zero;
+                }
+                else if (rec->east_asian_width == wide[0] || rec->east_asian_width == wide[1]) {
+                    w = width_wide;
+                }
+            }
+            for (auto& r : zero_width_jamo) {
+                std::fill(widths.begin() + r.first, widths.begin() + r.second + 1, (std::uint8_t)width_zero);
+            }
+            auto emoji = flat.ranges_of(range_emoji_presentation);
+            for (auto r = emoji.first; r != emoji.second; r++) {
+                for (auto code = r->first; code <= r->last; code++) {
+                    if (r->value && widths[code] == width_narrow) widths[code] = width_wide;
+                }
+            }
+            std::map<std::string, std::uint16_t> pages;
+            stage1.resize(codepoint_limit >> codetable_shift);
+            for (size_t i = 0; i < stage1.size(); i++) {
+                std::string page(page_bytes, 0);
+                for (size_t k = 0; k < codetable_page; k++) {
+                    page[k >> 2] |= (char)(widths[(i << codetable_shift) + k] << ((k & 3) * 2));
+                }
+                auto found = pages.find(page);
+                if (found == pages.end()) {
+                    auto id = (std::uint16_t)pages.size();
+                    stage2.insert(stage2.end(), page.begin(), page.end());
+                    found = pages.emplace(std::move(page), id).first;
                 }
+                stage1[i] = (*found).second;
             }
-            return ret;
+            built = true;
+            return true;
         }
 
-        double num() const {
-            double ret = 0;
-            if (!flag) return NAN;
-            if (flag & large_numbit) {
-                ret = (double)v3_L;
-            }
-            else {
-                ret = (double)v3_S._1;
-                if (flag & exist_two_bit) {
-                    ret = ret / v3_S._2;
+        //DisplayWidth of code
+        std::uint8_t get(char32_t code) const {
+            if (code >= codepoint_limit) return width_narrow;
+            auto byte = stage2[stage1[code >> codetable_shift] * page_bytes + ((code & (codetable_page - 1)) >> 2)];
+            return (byte >> ((code & 3) * 2)) & 3;
+        }
+
+        //columns of valid utf-8 or utf-32. control characters have no columns and are added to controls
+        template <class C>
+        size_t width(const C* in, size_t size, size_t& controls) const {
+            using Unit = std::conditional_t<sizeof(C) == 1, char, char32_t>;
+            auto str = (const Unit*)in;
+            size_t ret = 0;
+            for (size_t i = 0; i < size;) {
+                if CONSTEXPRIF (sizeof(C) == 1) {
+                    if ((unsigned char)str[i] < 0x80) {
+                        size_t ctrl = 0;
+                        auto n = ascii_width(Sized<const char>{str + i, size - i}, ctrl);
+                        ret += n - ctrl;
+                        controls += ctrl;
+                        i += n;
+                        continue;
+                    }
+                }
+                char32_t code;
+                i += utf_decode_at(str, i, size, code);
+                auto w = get(code);
+                if (w == width_control) {
+                    controls++;
+                }
+                else {
+                    ret += w;
                 }
-            }
-            if (flag & signbit) {
-                ret = -ret;
             }
             return ret;
         }
-    };
 
-    struct CaseMap {
-        char32_t upper = (char32_t)-1;
-        char32_t lower = (char32_t)-1;
-        char32_t title = (char32_t)-1;
-        unsigned char flag = 0;
+        template <class C>
+        size_t width(const C* in, size_t size) const {
+            size_t controls = 0;
+            return width(in, size, controls);
+        }
     };
 
-    struct CodeInfo {
-        char32_t codepoint;
-        std::string name;
-        std::string block;
-        std::string category;
-        unsigned int ccc = 0;  //Canonical_Combining_Class
-        std::string bidiclass;
-        std::string east_asian_width;
-        Decomposition decomposition;
-        Numeric numeric;
-        bool mirrored = false;
-        CaseMap casemap;
-        CodeInfo* range = nullptr;
+    //runs a build once even if threads ask for a derived table at the same time
+    struct BuildOnce {
+        std::unique_ptr<std::once_flag> flag = std::make_unique<std::once_flag>();
+
+        template <class F>
+        void operator()(F&& f) {
+            std::call_once(*flag, std::forward<F>(f));
+        }
     };
 
-    struct CodeRange {
-        CodeInfo* begin = nullptr;
-        CodeInfo* end = nullptr;
+    //one flag per table built on first use. replaced with the tables whenever flat is reloaded,
+    //which must not race with readers (loading and applying text files)
+    struct DerivedOnce {
+        BuildOnce nameindex;
+        BuildOnce propsets;
+        BuildOnce normtable;
+        BuildOnce casetable;
+        BuildOnce graphemetable;
+        BuildOnce widthtable;
+        BuildOnce wordtable;
+        BuildOnce sentencetable;
+        BuildOnce scripttable;
     };
 
     struct UnicodeData {
@@ -117,8 +3013,371 @@ namespace PROJECT_NAME {
         std::multimap<std::string, CodeInfo*> categorys;
         std::vector<CodeRange> ranges;
         std::multimap<std::u32string, CodeInfo*> composition;
+        std::vector<CaseMapping> casings;
+        std::vector<RangeProperty> range_properties;
+        CodeTable table;
+        FlatTable flat;
+        std::string image;
+        std::unique_ptr<FileMap> mapped;
+        PropertyDict props;
+        NameIndex nameindex;
+        PropertySets propsets;
+        NormalizeTable normtable;
+        CaseTable casetable;
+        GraphemeTable graphemetable;
+        WidthTable widthtable;
+        SegmentTable wordtable;
+        SegmentTable sentencetable;
+        ScriptTable scripttable;
+        DerivedOnce once;
+    };
+
+    inline bool build_codetable(UnicodeData& data) {
+        CodeTable& table = data.table;
+        table.clear();
+        if (data.codes.size() >= 0xffff) return false;
+        table.records.reserve(data.codes.size() + 1);
+        table.records.push_back(nullptr);
+        std::vector<std::uint16_t> flat(codepoint_limit, 0);
+        std::map<CodeInfo*, std::uint16_t> index;
+        for (auto& c : data.codes) {
+            index.emplace(&c.second, (std::uint16_t)table.records.size());
+            table.records.push_back(&c.second);
+        }
+        for (auto& r : data.ranges) {
+            auto idx = index[r.begin];
+            for (auto i = r.begin->codepoint; i <= r.end->codepoint && i < codepoint_limit; i++) {
+                flat[i] = idx;
+            }
+        }
+        for (auto i = 1; i < table.records.size(); i++) {
+            auto code = table.records[i]->codepoint;
+            if (code < codepoint_limit) {
+                flat[code] = (std::uint16_t)i;
+            }
+        }
+        std::map<std::vector<std::uint16_t>, std::uint16_t> pages;
+        table.stage1.resize(codepoint_limit >> codetable_shift);
+        for (size_t i = 0; i < table.stage1.size(); i++) {
+            auto begin = flat.begin() + (i << codetable_shift);
+            std::vector<std::uint16_t> page(begin, begin + codetable_page);
+            auto found = pages.find(page);
+            if (found == pages.end()) {
+                auto id = (std::uint16_t)pages.size();
+                table.stage2.insert(table.stage2.end(), page.begin(), page.end());
+                found = pages.emplace(std::move(page), id).first;
+            }
+            table.stage1[i] = (*found).second;
+        }
+        return true;
+    }
+
+    struct FlatBuilder {
+        std::string strings;
+        std::map<std::string, std::uint32_t> string_offsets;
+        std::vector<std::uint32_t> properties[property_count];
+        std::vector<FlatCodeInfo> records;
+        std::vector<char32_t> decomposition;
+        std::vector<FlatCaseMapping> case_mappings;
+        std::vector<FlatRangeProperty> range_properties;
+
+        std::uint32_t intern(const std::string& str) {
+            if (auto found = string_offsets.find(str); found != string_offsets.end()) {
+                return (*found).second;
+            }
+            auto ret = (std::uint32_t)strings.size();
+            strings.append(str.c_str(), str.size() + 1);
+            string_offsets.emplace(str, ret);
+            return ret;
+        }
+
+        bool add(const CodeInfo& info) {
+            FlatCodeInfo rec;
+            rec.codepoint = info.codepoint;
+            rec.name = intern(info.name);
+            rec.category = info.category;
+            rec.bidiclass = info.bidiclass;
+            rec.east_asian_width = info.east_asian_width;
+            rec.block = info.block;
+            rec.decomposition_command = info.decomposition.command;
+            if (info.decomposition.to.size() > 0xff) {
+                return false;
+            }
+            rec.ccc = (std::uint8_t)info.ccc;
+            if (info.decomposition.to.size()) {
+                rec.decomposition = (std::uint32_t)decomposition.size();
+                rec.decomposition_size = (std::uint8_t)info.decomposition.to.size();
+                decomposition.insert(decomposition.end(), info.decomposition.to.begin(), info.decomposition.to.end());
+                decomposition.push_back(0);
+            }
+            rec.digit = (std::int8_t)info.numeric.v1;
+            rec.decimal = (std::int8_t)info.numeric.v2;
+            rec.numeric_flag = info.numeric.flag;
+            ::memcpy(&rec.numeric, &info.numeric.v3_L, sizeof(rec.numeric));
+            rec.mirrored = info.mirrored;
+            rec.upper = info.casemap.upper;
+            rec.lower = info.casemap.lower;
+            rec.title = info.casemap.title;
+            rec.case_flag = info.casemap.flag;
+            if (info.range) {
+                rec.range = info.range->codepoint > info.codepoint ? flat_range_first : flat_range_last;
+            }
+            records.push_back(rec);
+            return true;
+        }
+
+        bool add(const CaseMapping& mapping) {
+            if (mapping.to.size() > 0xff || mapping.kind >= case_kind_count) {
+                return false;
+            }
+            FlatCaseMapping rec;
+            rec.codepoint = mapping.codepoint;
+            rec.kind = mapping.kind;
+            rec.size = (std::uint8_t)mapping.to.size();
+            rec.offset = (std::uint32_t)decomposition.size();
+            decomposition.insert(decomposition.end(), mapping.to.begin(), mapping.to.end());
+            decomposition.push_back(0);
+            case_mappings.push_back(rec);
+            return true;
+        }
+
+        bool add(const RangeProperty& range) {
+            if (range.first > range.last || range.last >= codepoint_limit || range.kind >= range_property_kind_count) {
+                return false;
+            }
+            FlatRangeProperty rec;
+            rec.first = range.first;
+            rec.last = range.last;
+            rec.kind = range.kind;
+            rec.value = range.value;
+            if (range_properties.size()) {
+                auto& prev = range_properties.back();
+                if (prev.kind == rec.kind && prev.last >= rec.first) return false;
+                //files list ranges per general category, so neighbors often share a value
+                if (prev.kind == rec.kind && prev.value == rec.value && prev.last + 1 == rec.first) {
+                    prev.last = rec.last;
+                    return true;
+                }
+            }
+            range_properties.push_back(rec);
+            return true;
+        }
     };
 
+    template <class Buf>
+    bool serialize_flat(Serializer<Buf>& w, UnicodeData& data) {
+        if (!data.table.records.size() || !data.props.is_valid()) return false;
+        FlatBuilder b;
+        b.intern("");
+        for (auto i = 0; i < property_count; i++) {
+            for (auto& name : data.props.names[i]) {
+                b.properties[i].push_back(b.intern(name));
+            }
+        }
+        b.records.push_back(FlatCodeInfo());
+        b.decomposition.push_back(0);
+        for (size_t i = 1; i < data.table.records.size(); i++) {
+            if (!b.add(*data.table.records[i])) {
+                return false;
+            }
+        }
+        auto casings = data.casings;
+        std::stable_sort(casings.begin(), casings.end(), [](auto& a, auto& b) {
+            return a.codepoint < b.codepoint || (a.codepoint == b.codepoint && a.kind < b.kind);
+        });
+        for (size_t i = 0; i < casings.size(); i++) {
+            //later one wins if same mapping is loaded twice
+            if (i + 1 < casings.size() && casings[i + 1].codepoint == casings[i].codepoint &&
+                casings[i + 1].kind == casings[i].kind) {
+                continue;
+            }
+            if (!b.add(casings[i])) {
+                return false;
+            }
+        }
+        auto ranges = data.range_properties;
+        std::stable_sort(ranges.begin(), ranges.end(), [](auto& a, auto& b) {
+            return a.kind < b.kind || (a.kind == b.kind && a.first < b.first);
+        });
+        for (auto& range : ranges) {
+            if (!b.add(range)) {
+                return false;
+            }
+        }
+        FlatTable t;
+        t.stage1 = data.table.stage1.data();
+        t.stage2 = data.table.stage2.data();
+        t.stage2_size = data.table.stage2.size();
+        t.records = b.records.data();
+        t.record_count = b.records.size();
+        t.decomposition = b.decomposition.data();
+        t.decomposition_size = b.decomposition.size();
+        t.strings = b.strings.data();
+        t.strings_size = b.strings.size();
+        for (auto i = 0; i < property_count; i++) {
+            t.properties[i] = b.properties[i].data();
+            t.property_size[i] = b.properties[i].size();
+        }
+        t.case_mappings = b.case_mappings.data();
+        t.case_mapping_count = b.case_mappings.size();
+        t.range_properties = b.range_properties.data();
+        t.range_property_count = b.range_properties.size();
+        return serialize_flat(w, t);
+    }
+
+    //write UDv5 image of any table view (built, mapped or compiled in)
+    template <class Buf>
+    bool serialize_flat(Serializer<Buf>& w, const FlatTable& t) {
+        if (!t.stage1 || !t.records) return false;
+        FlatHeader head;
+        head.record_size = sizeof(FlatCodeInfo);
+        head.record_count = (std::uint32_t)t.record_count;
+        auto align = [](size_t s) {
+            return (s + flat_alignment - 1) / flat_alignment * flat_alignment;
+        };
+        const void* ptrs[flat_section_count];
+        auto set_section = [&](int i, const void* p, size_t s, size_t& offset) {
+            ptrs[i] = p;
+            head.sections[i].offset = (std::uint32_t)offset;
+            head.sections[i].size = (std::uint32_t)s;
+            offset = align(offset + s);
+        };
+        size_t offset = align(sizeof(FlatHeader));
+        set_section(flat_stage1, t.stage1, (codepoint_limit >> codetable_shift) * sizeof(std::uint16_t), offset);
+        set_section(flat_stage2, t.stage2, t.stage2_size * sizeof(std::uint16_t), offset);
+        set_section(flat_records, t.records, t.record_count * sizeof(FlatCodeInfo), offset);
+        set_section(flat_decomposition, t.decomposition, t.decomposition_size * sizeof(char32_t), offset);
+        set_section(flat_strings, t.strings, t.strings_size, offset);
+        for (auto i = 0; i < flat_base_property_count; i++) {
+            set_section(flat_properties + i, t.properties[i], t.property_size[i] * sizeof(std::uint32_t), offset);
+        }
+        set_section(flat_case_mappings, t.case_mappings, t.case_mapping_count * sizeof(FlatCaseMapping), offset);
+        set_section(flat_range_properties, t.range_properties, t.range_property_count * sizeof(FlatRangeProperty), offset);
+        for (auto i = flat_base_property_count; i < property_count; i++) {
+            set_section(flat_property_section(i), t.properties[i], t.property_size[i] * sizeof(std::uint32_t), offset);
+        }
+        if (offset > (std::uint32_t)-1) return false;
+        size_t written = 0;
+        auto pad = [&](size_t to) {
+            for (; written < to; written++) {
+                w.template write_as<unsigned char>(0);
+            }
+        };
+        w.write(head);
+        written = sizeof(FlatHeader);
+        for (auto i = 0; i < flat_section_count; i++) {
+            pad(head.sections[i].offset);
+            w.write((const unsigned char*)ptrs[i], head.sections[i].size);
+            written += head.sections[i].size;
+        }
+        pad(offset);
+        return true;
+    }
+
+    //drop tables derived from flat so that the getters build them again
+    inline void reset_derived(UnicodeData& data) {
+        data.nameindex.clear();
+        data.propsets.clear();
+        data.normtable.clear();
+        data.casetable.clear();
+        data.graphemetable.clear();
+        data.widthtable.clear();
+        data.wordtable.clear();
+        data.sentencetable.clear();
+        data.scripttable.clear();
+        data.once = DerivedOnce();
+    }
+
+    //make in-memory UDv5 image from codes so that lookups always go through FlatTable
+    inline bool freeze_unicodedata(UnicodeData& data) {
+        reset_derived(data);
+        data.mapped.reset();
+        data.image.clear();
+        Serializer<std::string&> w(data.image);
+        if (!serialize_flat(w, data)) {
+            data.flat = FlatTable();
+            return false;
+        }
+        return data.flat.load(data.image.data(), data.image.size());
+    }
+
+    inline bool finish_unicodedata(UnicodeData& data) {
+        return build_codetable(data) && freeze_unicodedata(data);
+    }
+
+    inline bool map_unicodedata(std::unique_ptr<FileMap>&& map, UnicodeData& data) {
+        if (!map || !map->is_open()) return false;
+        if (!data.flat.load(map->c_str(), map->size())) return false;
+        reset_derived(data);
+        data.image.clear();
+        data.mapped = std::move(map);
+        return true;
+    }
+
+    //built on first use by one thread; cleared whenever flat is reloaded
+    inline const NameIndex& get_name_index(UnicodeData& data) {
+        data.once.nameindex([&] {
+            data.nameindex.build(data.flat);
+        });
+        return data.nameindex;
+    }
+
+    inline const PropertySets& get_property_sets(UnicodeData& data) {
+        data.once.propsets([&] {
+            data.propsets.build(data.flat);
+        });
+        return data.propsets;
+    }
+
+    inline const NormalizeTable& get_normalize_table(UnicodeData& data) {
+        data.once.normtable([&] {
+            data.normtable.build(data.flat);
+        });
+        return data.normtable;
+    }
+
+    inline const CaseTable& get_case_table(UnicodeData& data) {
+        data.once.casetable([&] {
+            data.casetable.build(data.flat);
+        });
+        return data.casetable;
+    }
+
+    inline const GraphemeTable& get_grapheme_table(UnicodeData& data) {
+        data.once.graphemetable([&] {
+            data.graphemetable.build(data.flat);
+        });
+        return data.graphemetable;
+    }
+
+    inline const WidthTable& get_width_table(UnicodeData& data) {
+        data.once.widthtable([&] {
+            data.widthtable.build(data.flat);
+        });
+        return data.widthtable;
+    }
+
+    inline const SegmentTable& get_word_table(UnicodeData& data) {
+        data.once.wordtable([&] {
+            data.wordtable.build(data.flat, range_word_break);
+        });
+        return data.wordtable;
+    }
+
+    inline const SegmentTable& get_sentence_table(UnicodeData& data) {
+        data.once.sentencetable([&] {
+            data.sentencetable.build(data.flat, range_sentence_break);
+        });
+        return data.sentencetable;
+    }
+
+    inline const ScriptTable& get_script_table(UnicodeData& data) {
+        data.once.scripttable([&] {
+            data.scripttable.build(data.flat);
+        });
+        return data.scripttable;
+    }
+
     inline void parse_case(std::vector<std::string>& d, CaseMap& ca) {
         if (d[12] != "") {
             unsigned int c = (unsigned int)-1;
@@ -140,12 +3399,12 @@ namespace PROJECT_NAME {
         }
     }
 
-    inline void parse_decomposition(std::string& s, Decomposition& res) {
+    inline void parse_decomposition(std::string& s, Decomposition& res, PropertyDict& dict) {
         if (s == "") return;
         auto c = split(s, " ");
         size_t pos = 0;
         if (c[0][0] == '<') {
-            res.command = c[0];
+            res.command = (std::uint8_t)dict.intern(property_decomposition_command, c[0]);
             pos = 1;
         }
         for (auto i = pos; i < c.size(); i++) {
@@ -196,47 +3455,47 @@ namespace PROJECT_NAME {
         parse_real(d[8], info.numeric);
     }
 
-    inline void guess_east_asian_wide(CodeInfo& info) {
-        if (info.decomposition.command == "<wide>") {
-            info.east_asian_width = "F";
+    inline void guess_east_asian_wide(CodeInfo& info, PropertyDict& dict) {
+        auto& command = dict.name(property_decomposition_command, info.decomposition.command);
+        const char* width = "U";
+        if (command == "<wide>") {
+            width = "F";
         }
-        else if (info.decomposition.command == "<narrow>") {
-            info.east_asian_width = "H";
+        else if (command == "<narrow>") {
+            width = "H";
         }
         else if (info.name.find("CJK") != ~0 || info.name.find("HIRAGANA") != ~0 ||
                  info.name.find("KATAKANA") != ~0) {
-            info.east_asian_width = "W";
+            width = "W";
         }
         else if (info.name.find("GREEK") != ~0) {
-            info.east_asian_width = "A";
-        }
-        else {
-            info.east_asian_width = "U";
+            width = "A";
         }
+        info.east_asian_width = (std::uint8_t)dict.intern(property_east_asian_width, width);
     }
 
-    inline bool parse_codepoint(std::vector<std::string>& d, CodeInfo& info) {
+    inline bool parse_codepoint(std::vector<std::string>& d, CodeInfo& info, PropertyDict& dict) {
         if (d.size() < 14) return false;
         unsigned int codepoint = (unsigned int)-1;
         Reader("0x" + d[0]) >> codepoint;
         info.codepoint = (char32_t)codepoint;
         info.name = d[1];
-        info.category = d[2];
+        info.category = (std::uint8_t)dict.intern(property_category, d[2]);
         Reader(d[3]) >> info.ccc;
-        info.bidiclass = d[4];
-        parse_decomposition(d[5], info.decomposition);
+        info.bidiclass = (std::uint8_t)dict.intern(property_bidiclass, d[4]);
+        parse_decomposition(d[5], info.decomposition, dict);
         parse_numeric(d, info);
         if (d[9] != "Y" && d[9] != "N") return false;
         info.mirrored = d[9] == "Y" ? true : false;
         parse_case(d, info.casemap);
-        guess_east_asian_wide(info);
+        guess_east_asian_wide(info, dict);
         return true;
     }
 
     inline void set_codepoint_info(CodeInfo& info, UnicodeData& ret, CodeInfo*& prev) {
         auto& point = ret.codes[info.codepoint];
         ret.names.emplace(info.name, &point);
-        ret.categorys.emplace(info.category, &point);
+        ret.categorys.emplace(ret.props.name(property_category, info.category), &point);
         if (prev) {
             if (info.codepoint != prev->codepoint + 1 && info.name.back() == '>' &&
                 prev->name.back() == '>' && !prev->range) {
@@ -256,12 +3515,12 @@ namespace PROJECT_NAME {
         CodeInfo* prev = nullptr;
         for (auto& d : data) {
             CodeInfo info;
-            if (!parse_codepoint(d, info)) {
+            if (!parse_codepoint(d, info, ret.props)) {
                 return false;
             }
             set_codepoint_info(info, ret, prev);
         }
-        return true;
+        return finish_unicodedata(ret);
     }
 
     template<class C>
@@ -322,14 +3581,15 @@ namespace PROJECT_NAME {
             unsigned int first = 0, last = 0;
             Reader("0x" + code[0]) >> first;
             Reader("0x" + code[1]) >> last;
+            auto block = data.props.intern(property_block, e[1]);
             for (auto i = first; i <= last; i++) {
                 if (auto found = data.codes.find(i); found != data.codes.end()) {
                     CodeInfo& info = (*found).second;
-                    info.block = e[1];
+                    info.block = block;
                 }
             }
         }
-        return true;
+        return freeze_unicodedata(data);
     }
 
     inline bool apply_east_asian_wide(std::vector<std::vector<std::string>>& vec, UnicodeData& data) {
@@ -337,12 +3597,13 @@ namespace PROJECT_NAME {
             if (e.size() != 2) return false;
             auto code = split(e[0], "..");
             if (code.size() == 0) return false;
+            auto width = (std::uint8_t)data.props.intern(property_east_asian_width, e[1]);
             if (code.size() == 1) {
                 unsigned int c = 0;
                 Reader("0x" + code[0]) >> c;
                 if (auto found = data.codes.find(c); found != data.codes.end()) {
                     CodeInfo& info = (*found).second;
-                    info.east_asian_width = e[1];
+                    info.east_asian_width = width;
                 }
             }
             else if (code.size() == 2) {
@@ -352,14 +3613,305 @@ namespace PROJECT_NAME {
                 for (auto i = first; i <= last; i++) {
                     if (auto found = data.codes.find(i); found != data.codes.end()) {
                         CodeInfo& info = (*found).second;
-                        info.east_asian_width = e[1];
+                        info.east_asian_width = width;
                     }
                 }
             }
         }
+        return freeze_unicodedata(data);
+    }
+
+    //';' separated fields of each line of UCD text without comment and spaces around them
+    template <class C>
+    std::vector<std::vector<std::string>> load_fields_text(C* name) {
+        auto each = load_common_text(name);
+        std::vector<std::vector<std::string>> ret;
+        for (auto& i : each) {
+            std::string_view line = i;
+            line = line.substr(0, line.find('#'));
+            std::vector<std::string> fields;
+            while (line.size()) {
+                auto end = line.find(';');
+                auto field = line.substr(0, end);
+                auto first = field.find_first_not_of(" \t"), last = field.find_last_not_of(" \t\r");
+                fields.push_back(first == ~0 ? std::string() : std::string(field.substr(first, last - first + 1)));
+                line = end == ~0 ? std::string_view() : line.substr(end + 1);
+            }
+            if (fields.size()) {
+                ret.push_back(std::move(fields));
+            }
+        }
+        return ret;
+    }
+
+    //code points separated by spaces like "0053 0073"
+    inline bool parse_code_sequence(const std::string& str, std::u32string& out) {
+        out.clear();
+        for (size_t pos = 0; pos < str.size();) {
+            auto end = str.find(' ', pos);
+            auto hex = str.substr(pos, end - pos);
+            if (hex.size()) {
+                unsigned int c = ~0;
+                Reader("0x" + hex) >> c;
+                if (c >= codepoint_limit) return false;
+                out.push_back(c);
+            }
+            pos = end == ~0 ? str.size() : end + 1;
+        }
+        return true;
+    }
+
+    template <class C>
+    std::vector<std::vector<std::string>> load_SpecialCasing_text(C* name) {
+        return load_fields_text(name);
+    }
+
+    template <class C>
+    std::vector<std::vector<std::string>> load_CaseFolding_text(C* name) {
+        return load_fields_text(name);
+    }
+
+    //<code>; <lower>; <title>; <upper>; (<condition>;)?
+    //conditional mappings are skipped. Final_Sigma is applied by CaseTable and others depend on language
+    inline bool apply_special_casing(std::vector<std::vector<std::string>>& vec, UnicodeData& data) {
+        for (auto& e : vec) {
+            if (e.size() < 4) return false;
+            if (e.size() > 4 && e[4].size()) continue;
+            std::u32string code;
+            if (!parse_code_sequence(e[0], code) || code.size() != 1) return false;
+            CaseKind kinds[] = {case_lower, case_title, case_upper};
+            for (auto i = 0; i < 3; i++) {
+                CaseMapping m;
+                m.codepoint = code[0];
+                m.kind = (std::uint8_t)kinds[i];
+                if (!parse_code_sequence(e[i + 1], m.to)) return false;
+                data.casings.push_back(std::move(m));
+            }
+        }
+        return freeze_unicodedata(data);
+    }
+
+    //<code>; <status>; <mapping>;
+    //C and F are full folding, C and S are simple folding and T (turkic) is skipped
+    inline bool apply_case_folding(std::vector<std::vector<std::string>>& vec, UnicodeData& data) {
+        for (auto& e : vec) {
+            if (e.size() < 3) return false;
+            if (e[1] == "T") continue;
+            CaseMapping m;
+            std::u32string code;
+            if (!parse_code_sequence(e[0], code) || code.size() != 1 || !parse_code_sequence(e[2], m.to)) return false;
+            m.codepoint = code[0];
+            if (e[1] == "C" || e[1] == "F") {
+                m.kind = case_fold_full;
+            }
+            else if (e[1] == "S") {
+                m.kind = case_fold_simple;
+            }
+            else {
+                return false;
+            }
+            data.casings.push_back(std::move(m));
+        }
+        return freeze_unicodedata(data);
+    }
+
+    //"0600..0605" or "00AD"
+    inline bool parse_code_range(const std::string& str, char32_t& first, char32_t& last) {
+        auto code = split(str, "..");
+        if (code.size() != 1 && code.size() != 2) return false;
+        unsigned int f = ~0, l = ~0;
+        Reader("0x" + code[0]) >> f;
+        if (code.size() == 2) {
+            Reader("0x" + code[1]) >> l;
+        }
+        else {
+            l = f;
+        }
+        if (f > l || l >= codepoint_limit) return false;
+        first = f;
+        last = l;
         return true;
     }
 
+    //<range> ; <value>. ranges of kind loaded before are replaced.
+    //value_of gives value of name, -1 to skip the line or -2 for an unknown name
+    template <class F>
+    bool add_range_property(std::vector<std::vector<std::string>>& vec, UnicodeData& data, RangePropertyKind kind, F&& value_of) {
+        std::erase_if(data.range_properties, [&](auto& r) {
+            return r.kind == kind;
+        });
+        for (auto& e : vec) {
+            if (e.size() < 2) return false;
+            auto value = value_of(e[1]);
+            if (value == -1) continue;
+            RangeProperty r;
+            if (value < 0 || !parse_code_range(e[0], r.first, r.last)) return false;
+            r.kind = (std::uint8_t)kind;
+            r.value = (std::uint16_t)value;
+            data.range_properties.push_back(r);
+        }
+        return true;
+    }
+
+    template <class C>
+    std::vector<std::vector<std::string>> load_GraphemeBreakProperty_text(C* name) {
+        return load_fields_text(name);
+    }
+
+    template <class C>
+    std::vector<std::vector<std::string>> load_emoji_data_text(C* name) {
+        return load_fields_text(name);
+    }
+
+    template <class C>
+    std::vector<std::vector<std::string>> load_WordBreakProperty_text(C* name) {
+        return load_fields_text(name);
+    }
+
+    template <class C>
+    std::vector<std::vector<std::string>> load_SentenceBreakProperty_text(C* name) {
+        return load_fields_text(name);
+    }
+
+    inline bool apply_grapheme_break(std::vector<std::vector<std::string>>& vec, UnicodeData& data) {
+        auto ok = add_range_property(vec, data, range_grapheme_break, [](const std::string& name) {
+            for (auto i = 0; i < gb_extended_pictographic; i++) {
+                if (name == grapheme_break_names[i]) return i;
+            }
+            return -2;
+        });
+        return ok && freeze_unicodedata(data);
+    }
+
+    inline bool apply_word_break(std::vector<std::vector<std::string>>& vec, UnicodeData& data) {
+        auto ok = add_range_property(vec, data, range_word_break, [](const std::string& name) {
+            for (auto i = 0; i < wb_extended_pictographic; i++) {
+                if (name == word_break_names[i]) return i;
+            }
+            return -2;
+        });
+        return ok && freeze_unicodedata(data);
+    }
+
+    inline bool apply_sentence_break(std::vector<std::vector<std::string>>& vec, UnicodeData& data) {
+        auto ok = add_range_property(vec, data, range_sentence_break, [](const std::string& name) {
+            for (auto i = 0; i < sentence_break_count; i++) {
+                if (name == sentence_break_names[i]) return i;
+            }
+            return -2;
+        });
+        return ok && freeze_unicodedata(data);
+    }
+
+    //ISO 15924 codes of ScriptExtensions.txt and long names of Scripts.txt (PropertyValueAliases.txt)
+    constexpr const char* script_aliases[][2] = {
+        {"Adlm", "Adlam"}, {"Aghb", "Caucasian_Albanian"}, {"Ahom", "Ahom"}, {"Arab", "Arabic"},
+        {"Armi", "Imperial_Aramaic"}, {"Armn", "Armenian"}, {"Avst", "Avestan"}, {"Bali", "Balinese"},
+        {"Bamu", "Bamum"}, {"Bass", "Bassa_Vah"}, {"Batk", "Batak"}, {"Beng", "Bengali"},
+        {"Bhks", "Bhaiksuki"}, {"Bopo", "Bopomofo"}, {"Brah", "Brahmi"}, {"Brai", "Braille"},
+        {"Bugi", "Buginese"}, {"Buhd", "Buhid"}, {"Cakm", "Chakma"}, {"Cans", "Canadian_Aboriginal"},
+        {"Cari", "Carian"}, {"Cham", "Cham"}, {"Cher", "Cherokee"}, {"Chrs", "Chorasmian"},
+        {"Copt", "Coptic"}, {"Cpmn", "Cypro_Minoan"}, {"Cprt", "Cypriot"}, {"Cyrl", "Cyrillic"},
+        {"Deva", "Devanagari"}, {"Diak", "Dives_Akuru"}, {"Dogr", "Dogra"}, {"Dsrt", "Deseret"},
+        {"Dupl", "Duployan"}, {"Egyp", "Egyptian_Hieroglyphs"}, {"Elba", "Elbasan"}, {"Elym", "Elymaic"},
+        {"Ethi", "Ethiopic"}, {"Gara", "Garay"}, {"Geor", "Georgian"}, {"Glag", "Glagolitic"},
+        {"Gong", "Gunjala_Gondi"}, {"Gonm", "Masaram_Gondi"}, {"Goth", "Gothic"}, {"Gran", "Grantha"},
+        {"Grek", "Greek"}, {"Gujr", "Gujarati"}, {"Gukh", "Gurung_Khema"}, {"Guru", "Gurmukhi"},
+        {"Hang", "Hangul"}, {"Hani", "Han"}, {"Hano", "Hanunoo"}, {"Hatr", "Hatran"},
+        {"Hebr", "Hebrew"}, {"Hira", "Hiragana"}, {"Hluw", "Anatolian_Hieroglyphs"}, {"Hmng", "Pahawh_Hmong"},
+        {"Hmnp", "Nyiakeng_Puachue_Hmong"}, {"Hrkt", "Katakana_Or_Hiragana"}, {"Hung", "Old_Hungarian"},
+        {"Ital", "Old_Italic"}, {"Java", "Javanese"}, {"Kali", "Kayah_Li"}, {"Kana", "Katakana"},
+        {"Kawi", "Kawi"}, {"Khar", "Kharoshthi"}, {"Khmr", "Khmer"}, {"Khoj", "Khojki"},
+        {"Kits", "Khitan_Small_Script"}, {"Knda", "Kannada"}, {"Krai", "Kirat_Rai"}, {"Kthi", "Kaithi"},
+        {"Lana", "Tai_Tham"}, {"Laoo", "Lao"}, {"Latn", "Latin"}, {"Lepc", "Lepcha"},
+        {"Limb", "Limbu"}, {"Lina", "Linear_A"}, {"Linb", "Linear_B"}, {"Lisu", "Lisu"},
+        {"Lyci", "Lycian"}, {"Lydi", "Lydian"}, {"Mahj", "Mahajani"}, {"Maka", "Makasar"},
+        {"Mand", "Mandaic"}, {"Mani", "Manichaean"}, {"Marc", "Marchen"}, {"Medf", "Medefaidrin"},
+        {"Mend", "Mende_Kikakui"}, {"Merc", "Meroitic_Cursive"}, {"Mero", "Meroitic_Hieroglyphs"},
+        {"Mlym", "Malayalam"}, {"Modi", "Modi"}, {"Mong", "Mongolian"}, {"Mroo", "Mro"},
+        {"Mtei", "Meetei_Mayek"}, {"Mult", "Multani"}, {"Mymr", "Myanmar"}, {"Nagm", "Nag_Mundari"},
+        {"Nand", "Nandinagari"}, {"Narb", "Old_North_Arabian"}, {"Nbat", "Nabataean"}, {"Newa", "Newa"},
+        {"Nkoo", "Nko"}, {"Nshu", "Nushu"}, {"Ogam", "Ogham"}, {"Olck", "Ol_Chiki"},
+        {"Onao", "Ol_Onal"}, {"Orkh", "Old_Turkic"}, {"Orya", "Oriya"}, {"Osge", "Osage"},
+        {"Osma", "Osmanya"}, {"Ougr", "Old_Uyghur"}, {"Palm", "Palmyrene"}, {"Pauc", "Pau_Cin_Hau"},
+        {"Perm", "Old_Permic"}, {"Phag", "Phags_Pa"}, {"Phli", "Inscriptional_Pahlavi"},
+        {"Phlp", "Psalter_Pahlavi"}, {"Phnx", "Phoenician"}, {"Plrd", "Miao"}, {"Prti", "Inscriptional_Parthian"},
+        {"Qaac", "Coptic"}, {"Qaai", "Inherited"}, {"Rjng", "Rejang"}, {"Rohg", "Hanifi_Rohingya"},
+        {"Runr", "Runic"}, {"Samr", "Samaritan"}, {"Sarb", "Old_South_Arabian"}, {"Saur", "Saurashtra"},
+        {"Sgnw", "SignWriting"}, {"Shaw", "Shavian"}, {"Shrd", "Sharada"}, {"Sidd", "Siddham"},
+        {"Sind", "Khudawadi"}, {"Sinh", "Sinhala"}, {"Sogd", "Sogdian"}, {"Sogo", "Old_Sogdian"},
+        {"Sora", "Sora_Sompeng"}, {"Soyo", "Soyombo"}, {"Sund", "Sundanese"}, {"Sunu", "Sunuwar"},
+        {"Sylo", "Syloti_Nagri"}, {"Syrc", "Syriac"}, {"Tagb", "Tagbanwa"}, {"Takr", "Takri"},
+        {"Tale", "Tai_Le"}, {"Talu", "New_Tai_Lue"}, {"Taml", "Tamil"}, {"Tang", "Tangut"},
+        {"Tavt", "Tai_Viet"}, {"Telu", "Telugu"}, {"Tfng", "Tifinagh"}, {"Tglg", "Tagalog"},
+        {"Thaa", "Thaana"}, {"Thai", "Thai"}, {"Tibt", "Tibetan"}, {"Tirh", "Tirhuta"},
+        {"Tnsa", "Tangsa"}, {"Todr", "Todhri"}, {"Toto", "Toto"}, {"Tutg", "Tulu_Tigalari"},
+        {"Ugar", "Ugaritic"}, {"Vaii", "Vai"}, {"Vith", "Vithkuqi"}, {"Wara", "Warang_Citi"},
+        {"Wcho", "Wancho"}, {"Xpeo", "Old_Persian"}, {"Xsux", "Cuneiform"}, {"Yezi", "Yezidi"},
+        {"Yiii", "Yi"}, {"Zanb", "Zanabazar_Square"}, {"Zinh", "Inherited"}, {"Zyyy", "Common"},
+        {"Zzzz", "Unknown"},
+    };
+
+    //long name of script code, or code itself if it is unknown (a long name or a newer script)
+    inline std::string script_long_name(std::string_view code) {
+        for (auto& alias : script_aliases) {
+            if (code == alias[0]) return alias[1];
+        }
+        return std::string(code);
+    }
+
+    template <class C>
+    std::vector<std::vector<std::string>> load_Scripts_text(C* name) {
+        return load_fields_text(name);
+    }
+
+    template <class C>
+    std::vector<std::vector<std::string>> load_ScriptExtensions_text(C* name) {
+        return load_fields_text(name);
+    }
+
+    //scripts are interned as property_script. code points not listed are Unknown
+    inline bool apply_scripts(std::vector<std::vector<std::string>>& vec, UnicodeData& data) {
+        data.props.intern(property_script, "Unknown");
+        auto ok = add_range_property(vec, data, range_script, [&](const std::string& name) {
+            if (!name.size()) return -2;
+            auto id = data.props.intern(property_script, name);
+            return id < PropertyDict::limit(property_script) ? (int)id : -2;
+        });
+        return ok && freeze_unicodedata(data);
+    }
+
+    //sets of script codes are interned as property_script_extensions of long names joined by space
+    inline bool apply_script_extensions(std::vector<std::vector<std::string>>& vec, UnicodeData& data) {
+        auto ok = add_range_property(vec, data, range_script_extensions, [&](const std::string& codes) {
+            std::string names;
+            std::string_view rest = codes;
+            while (rest.size()) {
+                auto end = rest.find(' ');
+                auto code = rest.substr(0, end);
+                if (code.size()) {
+                    names += (names.size() ? " " : "") + script_long_name(code);
+                }
+                rest = end == ~0 ? std::string_view() : rest.substr(end + 1);
+            }
+            if (!names.size()) return -2;
+            auto id = data.props.intern(property_script_extensions, names);
+            return id < PropertyDict::limit(property_script_extensions) ? (int)id : -2;
+        });
+        return ok && freeze_unicodedata(data);
+    }
+
+    //Extended_Pictographic (grapheme clusters and words) and Emoji_Presentation (display width) are used
+    inline bool apply_emoji_data(std::vector<std::vector<std::string>>& vec, UnicodeData& data) {
+        auto ok = add_range_property(vec, data, range_extended_pictographic, [](const std::string& name) {
+            return name == "Extended_Pictographic" ? 1 : -1;
+        });
+        ok = ok && add_range_property(vec, data, range_emoji_presentation, [](const std::string& name) {
+            return name == "Emoji_Presentation" ? 1 : -1;
+        });
+        return ok && freeze_unicodedata(data);
+    }
+
     template <class C>
     std::vector<std::vector<std::string>> load_unicodedata_text(C* name) {
         Reader<FileReader> r(name);
@@ -380,20 +3932,22 @@ namespace PROJECT_NAME {
     constexpr int enable_version = 4;
 
     template <class Buf>
-    bool serialize_codeinfo(Serializer<Buf> w, CodeInfo& info,std::string& block, int version = enable_version) {
+    bool serialize_codeinfo(Serializer<Buf>& w, CodeInfo& info, const PropertyDict& dict, std::uint16_t& block, int version = enable_version) {
         if (version > enable_version) {
             return false;
         }
+        auto write_property = [&](PropertyKind kind, std::uint16_t id) {
+            auto& str = dict.name(kind, id);
+            w.template write_as<unsigned char>(str.size());
+            w.write_byte(str);
+        };
         w.write_hton(info.codepoint);
         w.template write_as<unsigned char>(info.name.size());
         w.write_byte(info.name);
-        w.template write_as<unsigned char>(info.category.size());
-        w.write_byte(info.category);
+        write_property(property_category, info.category);
         w.template write_as<unsigned char>(info.ccc);
-        w.template write_as<unsigned char>(info.bidiclass.size());
-        w.write_byte(info.bidiclass);
-        w.template write_as<unsigned char>(info.decomposition.command.size());
-        w.write_byte(info.decomposition.command);
+        write_property(property_bidiclass, info.bidiclass);
+        write_property(property_decomposition_command, info.decomposition.command);
         size_t size = info.decomposition.to.size();
         w.template write_as<unsigned char>(size * sizeof(char32_t));
         w.write_hton(info.decomposition.to.data(), size);
@@ -458,13 +4012,11 @@ namespace PROJECT_NAME {
             }
         }
         if (version >= 2) {
-            w.template write_as<unsigned char>(info.east_asian_width.size());
-            w.write_byte(info.east_asian_width);
+            write_property(property_east_asian_width, info.east_asian_width);
         }
         if(version>=4){
             if(block!=info.block){
-                w.template write_as<unsigned char>(info.block.size());
-                w.write_byte(info.block);
+                write_property(property_block, info.block);
                 block=info.block;
             }
         }
@@ -472,21 +4024,25 @@ namespace PROJECT_NAME {
     }
 
     template <class Buf>
-    bool deserialize_codeinfo(Deserializer<Buf>& r, CodeInfo& info,std::string& block ,int version = enable_version) {
+    bool deserialize_codeinfo(Deserializer<Buf>& r, CodeInfo& info, PropertyDict& dict, std::uint16_t& block, int version = enable_version) {
         if (version > enable_version) {
             return false;
         }
-        if (!r.read_reverse(info.codepoint)) return false;
         size_t size = 0;
+        auto read_property = [&](PropertyKind kind, auto& id) {
+            std::string str;
+            if (!r.template read_as<unsigned char>(size)) return false;
+            if (!r.read_byte(str, size)) return false;
+            id = (std::remove_reference_t<decltype(id)>)dict.intern(kind, str);
+            return true;
+        };
+        if (!r.read_reverse(info.codepoint)) return false;
         if (!r.template read_as<unsigned char>(size)) return false;
         if (!r.read_byte(info.name, size)) return false;
-        if (!r.template read_as<unsigned char>(size)) return false;
-        if (!r.read_byte(info.category, size)) return false;
+        if (!read_property(property_category, info.category)) return false;
         if (!r.template read_as<unsigned char>(info.ccc)) return false;
-        if (!r.template read_as<unsigned char>(size)) return false;
-        if (!r.read_byte(info.bidiclass, size)) return false;
-        if (!r.template read_as<unsigned char>(size)) return false;
-        if (!r.read_byte(info.decomposition.command, size)) return false;
+        if (!read_property(property_bidiclass, info.bidiclass)) return false;
+        if (!read_property(property_decomposition_command, info.decomposition.command)) return false;
         if (!r.template read_as<unsigned char>(size)) return false;
         if (!r.read_byte_ntoh(info.decomposition.to, size / sizeof(char32_t))) return false;
         auto read_numeric3 = [&] {
@@ -558,17 +4114,15 @@ namespace PROJECT_NAME {
             }
         }
         if (version >= 2) {
-            if (!r.template read_as<unsigned char>(size)) return false;
-            if (!r.read_byte(info.east_asian_width, size)) return false;
+            if (!read_property(property_east_asian_width, info.east_asian_width)) return false;
         }
         else {
-            guess_east_asian_wide(info);
+            guess_east_asian_wide(info, dict);
         }
         if(version>=4){
             if(info.numeric.flag&has_blockname){
                 info.numeric.flag&=~has_blockname;
-                if (!r.template read_as<unsigned char>(size)) return false;
-                if (!r.read_byte(info.block, size)) return false;
+                if (!read_property(property_block, info.block)) return false;
                 block=info.block;
             }
             else{
@@ -592,9 +4146,9 @@ namespace PROJECT_NAME {
         else if(version==4){
             ret.write_byte("UDv4",4);
         }
-        std::string block="";
+        std::uint16_t block = 0;
         for (auto& d : data.codes) {
-            serialize_codeinfo(ret, d.second,block, version);
+            serialize_codeinfo(ret, d.second, data.props, block, version);
         }
     }
 
@@ -614,15 +4168,15 @@ namespace PROJECT_NAME {
             version = 4;
         }
         CodeInfo* prev = nullptr;
-        std::string block;
+        std::uint16_t block = 0;
         while (!r.eof()) {
             CodeInfo info;
-            if (!deserialize_codeinfo(r, info, block,version)) {
+            if (!deserialize_codeinfo(r, info, ret.props, block, version)) {
                 return false;
             }
             set_codepoint_info(info, ret, prev);
         }
-        return true;
+        return finish_unicodedata(ret);
     }
 
 }  // namespace PROJECT_NAME
\ No newline at end of file
@@ -0,0 +1,1572 @@
+/*
+    commonlib - common utility library
+    Copyright (c) 2021 on-keyday (https://github.com/on-keyday)
+    Released under the MIT license
+    https://opensource.org/licenses/mit-license.php
+*/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "reader.h"
+#include "struct_utility.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COMMONLIB2_HAS_X86_SIMD
+#include <immintrin.h>
+#ifdef COMMONLIB2_IS_MSVC
+#include <intrin.h>
+#define COMMONLIB2_TARGET(x)
+#else
+#define COMMONLIB2_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace PROJECT_NAME {
+
+    //kernel used by bulk transcoders. selected once at run time by utf_kernel()
+    enum class UTFKernel {
+        scalar,
+        sse42,
+        avx2,
+    };
+
+    //read: input units consumed (position of first error if err!=0)
+    //written: output units produced
+    //err: same code as ctx of utf8toutf32 (index in sequence+1 of bad unit, 12 for bad value)
+    struct UTFResult {
+        size_t read = 0;
+        size_t written = 0;
+        int err = 0;
+    };
+
+    namespace utf_detail {
+        //strict RFC 3629 decoding of one sequence. returns err code
+        inline int utf8_decode_one(const unsigned char* p, size_t rem, char32_t& c, int& len) {
+            auto b = p[0];
+            if (b < 0x80) {
+                c = b;
+                len = 1;
+                return 0;
+            }
+            if ((b & 0xe0) == 0xc0) {
+                if (b < 0xc2) return 1;
+                len = 2;
+                c = b & 0x1f;
+            }
+            else if ((b & 0xf0) == 0xe0) {
+                len = 3;
+                c = b & 0x0f;
+            }
+            else if ((b & 0xf8) == 0xf0 && b <= 0xf4) {
+                len = 4;
+                c = b & 0x07;
+            }
+            else {
+                return 1;
+            }
+            for (auto i = 1; i < len; i++) {
+                if ((size_t)i >= rem || (p[i] & 0xc0) != 0x80) return i + 1;
+                c = (c << 6) | (p[i] & 0x3f);
+            }
+            if ((len == 3 && (c < 0x800 || (c >= 0xd800 && c <= 0xdfff))) ||
+                (len == 4 && (c < 0x10000 || c > 0x10ffff))) {
+                return 12;
+            }
+            return 0;
+        }
+
+        inline char16_t swap16(char16_t c) {
+            return char16_t((c >> 8) | (c << 8));
+        }
+
+        inline char32_t swap32(char32_t c) {
+            return (c >> 24) | ((c >> 8) & 0xff00) | ((c << 8) & 0xff0000) | (c << 24);
+        }
+
+        //strict utf-16 decoding of one sequence. err 1: unpaired low surrogate, 2: high surrogate without low
+        inline int utf16_decode_one(const char16_t* p, size_t rem, bool swap, char32_t& c, int& len) {
+            char32_t first = swap ? swap16(p[0]) : p[0];
+            c = first;
+            len = 1;
+            if (first < 0xd800 || first > 0xdfff) return 0;
+            if (first >= 0xdc00) return 1;
+            if (rem < 2) return 2;
+            char32_t second = swap ? swap16(p[1]) : p[1];
+            if (second < 0xdc00 || second > 0xdfff) return 2;
+            c = 0x10000 + ((first - 0xd800) << 10) + (second - 0xdc00);
+            len = 2;
+            return 0;
+        }
+
+        inline int decode_one(const unsigned char* p, size_t rem, bool, char32_t& c, int& len) {
+            return utf8_decode_one(p, rem, c, len);
+        }
+
+        inline int decode_one(const char16_t* p, size_t rem, bool swap, char32_t& c, int& len) {
+            return utf16_decode_one(p, rem, swap, c, len);
+        }
+
+        inline int decode_one(const char32_t* p, size_t, bool, char32_t& c, int& len) {
+            c = p[0];
+            len = 1;
+            return c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff) ? 12 : 0;
+        }
+
+        //encoders expect a valid scalar value. returns units written
+        inline int encode_one(char32_t c, char* out, bool) {
+            if (c < 0x80) {
+                out[0] = (char)c;
+                return 1;
+            }
+            if (c < 0x800) {
+                out[0] = (char)(0xc0 | (c >> 6));
+                out[1] = (char)(0x80 | (c & 0x3f));
+                return 2;
+            }
+            if (c < 0x10000) {
+                out[0] = (char)(0xe0 | (c >> 12));
+                out[1] = (char)(0x80 | ((c >> 6) & 0x3f));
+                out[2] = (char)(0x80 | (c & 0x3f));
+                return 3;
+            }
+            out[0] = (char)(0xf0 | (c >> 18));
+            out[1] = (char)(0x80 | ((c >> 12) & 0x3f));
+            out[2] = (char)(0x80 | ((c >> 6) & 0x3f));
+            out[3] = (char)(0x80 | (c & 0x3f));
+            return 4;
+        }
+
+        inline int encode_one(char32_t c, char16_t* out, bool swap) {
+            if (c < 0x10000) {
+                out[0] = swap ? swap16((char16_t)c) : (char16_t)c;
+                return 1;
+            }
+            c -= 0x10000;
+            auto first = char16_t(0xd800 + (c >> 10)), second = char16_t(0xdc00 + (c & 0x3ff));
+            out[0] = swap ? swap16(first) : first;
+            out[1] = swap ? swap16(second) : second;
+            return 2;
+        }
+
+        inline int encode_one(char32_t c, char32_t* out, bool) {
+            out[0] = c;
+            return 1;
+        }
+
+        //transcode [pos,end) one code point at a time. out may be null to count output units
+        template <class Src, class Dst>
+        inline UTFResult transcode_scalar(const Src* in, size_t size, Dst* out, bool swap_in = false, bool swap_out = false,
+                                          size_t pos = 0, size_t end = ~size_t(0), size_t written = 0) {
+            UTFResult ret;
+            if (end > size) end = size;
+            Dst tmp[4];
+            while (pos < end) {
+                char32_t c = 0;
+                int len = 0;
+                if (auto err = decode_one(in + pos, size - pos, swap_in, c, len)) {
+                    ret.err = err;
+                    break;
+                }
+                written += encode_one(c, out ? out + written : tmp, swap_out);
+                pos += len;
+            }
+            ret.read = pos;
+            ret.written = written;
+            return ret;
+        }
+
+        inline UTFResult utf8_to_utf32_scalar(const unsigned char* in, size_t size, char32_t* out, size_t pos = 0,
+                                              size_t end = ~size_t(0), size_t written = 0) {
+            return transcode_scalar(in, size, out, false, false, pos, end, written);
+        }
+
+        //encode n utf-16 units whose surrogates are already known to pair up
+        template <class Dst>
+        inline size_t utf16_block_unchecked(const char16_t* in, size_t n, Dst* out, bool swap) {
+            size_t written = 0;
+            for (size_t i = 0; i < n; i++) {
+                char32_t c = swap ? swap16(in[i]) : in[i];
+                if (c >= 0xd800 && c <= 0xdbff) {
+                    char32_t second = swap ? swap16(in[i + 1]) : in[i + 1];
+                    c = 0x10000 + ((c - 0xd800) << 10) + (second - 0xdc00);
+                    i++;
+                }
+                written += encode_one(c, out + written, false);
+            }
+            return written;
+        }
+
+        //position of the sequence which contains pos (pos is after validated input)
+        inline size_t utf8_sequence_begin(const unsigned char* in, size_t pos) {
+            for (auto i = 0; i < 3 && pos > 0 && (in[pos] & 0xc0) == 0x80; i++) {
+                pos--;
+            }
+            return pos;
+        }
+
+#ifdef COMMONLIB2_HAS_X86_SIMD
+        //error flags of lookup based validation (Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte")
+        constexpr std::uint8_t too_short = 1 << 0;
+        constexpr std::uint8_t too_long = 1 << 1;
+        constexpr std::uint8_t overlong_3 = 1 << 2;
+        constexpr std::uint8_t too_large = 1 << 3;
+        constexpr std::uint8_t surrogate = 1 << 4;
+        constexpr std::uint8_t overlong_2 = 1 << 5;
+        constexpr std::uint8_t too_large_1000 = 1 << 6;
+        constexpr std::uint8_t overlong_4 = 1 << 6;
+        constexpr std::uint8_t two_conts = 1 << 7;
+        constexpr std::uint8_t carry = too_short | too_long | two_conts;
+
+        constexpr std::uint8_t byte_1_high[16] = {
+            too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+            two_conts, two_conts, two_conts, two_conts,
+            too_short | overlong_2,
+            too_short,
+            too_short | overlong_3 | surrogate,
+            too_short | too_large | too_large_1000 | overlong_4};
+
+        constexpr std::uint8_t byte_1_low[16] = {
+            carry | overlong_3 | overlong_2 | overlong_4,
+            carry | overlong_2,
+            carry,
+            carry,
+            carry | too_large,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000 | surrogate,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000};
+
+        constexpr std::uint8_t byte_2_high[16] = {
+            too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+            too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+            too_long | overlong_2 | two_conts | overlong_3 | too_large,
+            too_long | overlong_2 | two_conts | surrogate | too_large,
+            too_long | overlong_2 | two_conts | surrogate | too_large,
+            too_short, too_short, too_short, too_short};
+
+        //bytes which may not end a buffer: lead bytes of unfinished sequences
+        constexpr std::uint8_t incomplete_max[32] = {
+            0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+            0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+            0xf0 - 1, 0xe0 - 1, 0xc0 - 1};
+
+        struct SSEValidator {
+            static constexpr size_t width = 16;
+            __m128i error;
+            __m128i prev_input;
+            __m128i prev_incomplete;
+
+            COMMONLIB2_TARGET("sse4.2")
+            SSEValidator() {
+                error = prev_input = prev_incomplete = _mm_setzero_si128();
+            }
+
+            COMMONLIB2_TARGET("sse4.2")
+            void check(const unsigned char* p) {
+                check_vec(_mm_loadu_si128((const __m128i*)p));
+            }
+
+            COMMONLIB2_TARGET("sse4.2")
+            static __m128i lookup(const std::uint8_t* table, const __m128i& idx) {
+                return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)table), idx);
+            }
+
+            COMMONLIB2_TARGET("sse4.2")
+            void check_vec(const __m128i& input) {
+                if (_mm_movemask_epi8(input) == 0) {
+                    error = _mm_or_si128(error, prev_incomplete);
+                    prev_input = input;
+                    prev_incomplete = _mm_setzero_si128();
+                    return;
+                }
+                auto low = _mm_set1_epi8(0x0f);
+                auto prev1 = _mm_alignr_epi8(input, prev_input, 15);
+                auto b1h = lookup(byte_1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), low));
+                auto b1l = lookup(byte_1_low, _mm_and_si128(prev1, low));
+                auto b2h = lookup(byte_2_high, _mm_and_si128(_mm_srli_epi16(input, 4), low));
+                auto special = _mm_and_si128(_mm_and_si128(b1h, b1l), b2h);
+                auto prev2 = _mm_alignr_epi8(input, prev_input, 14);
+                auto prev3 = _mm_alignr_epi8(input, prev_input, 13);
+                auto third = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xe0 - 0x80)));
+                auto fourth = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xf0 - 0x80)));
+                auto must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+                error = _mm_or_si128(error, _mm_xor_si128(must23, special));
+                prev_incomplete = _mm_subs_epu8(input, _mm_loadu_si128((const __m128i*)(incomplete_max + 16)));
+                prev_input = input;
+            }
+
+            COMMONLIB2_TARGET("sse4.2")
+            bool has_error() const {
+                return !_mm_testz_si128(error, error);
+            }
+
+            COMMONLIB2_TARGET("sse4.2")
+            bool finish() {
+                error = _mm_or_si128(error, prev_incomplete);
+                return !has_error();
+            }
+        };
+
+        struct AVXValidator {
+            static constexpr size_t width = 32;
+            __m256i error;
+            __m256i prev_input;
+            __m256i prev_incomplete;
+
+            COMMONLIB2_TARGET("avx2")
+            AVXValidator() {
+                error = prev_input = prev_incomplete = _mm256_setzero_si256();
+            }
+
+            COMMONLIB2_TARGET("avx2")
+            void check(const unsigned char* p) {
+                check_vec(_mm256_loadu_si256((const __m256i*)p));
+            }
+
+            COMMONLIB2_TARGET("avx2")
+            static __m256i lookup(const std::uint8_t* table, const __m256i& idx) {
+                auto t = _mm_loadu_si128((const __m128i*)table);
+                return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(t), idx);
+            }
+
+            COMMONLIB2_TARGET("avx2")
+            __m256i prev(const __m256i& input, int n) const {
+                auto shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+                switch (n) {
+                    case 1:
+                        return _mm256_alignr_epi8(input, shifted, 15);
+                    case 2:
+                        return _mm256_alignr_epi8(input, shifted, 14);
+                    default:
+                        return _mm256_alignr_epi8(input, shifted, 13);
+                }
+            }
+
+            COMMONLIB2_TARGET("avx2")
+            void check_vec(const __m256i& input) {
+                if (_mm256_movemask_epi8(input) == 0) {
+                    error = _mm256_or_si256(error, prev_incomplete);
+                    prev_input = input;
+                    prev_incomplete = _mm256_setzero_si256();
+                    return;
+                }
+                auto low = _mm256_set1_epi8(0x0f);
+                auto prev1 = prev(input, 1);
+                auto b1h = lookup(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low));
+                auto b1l = lookup(byte_1_low, _mm256_and_si256(prev1, low));
+                auto b2h = lookup(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), low));
+                auto special = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+                auto third = _mm256_subs_epu8(prev(input, 2), _mm256_set1_epi8((char)(0xe0 - 0x80)));
+                auto fourth = _mm256_subs_epu8(prev(input, 3), _mm256_set1_epi8((char)(0xf0 - 0x80)));
+                auto must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+                error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+                prev_incomplete = _mm256_subs_epu8(input, _mm256_loadu_si256((const __m256i*)incomplete_max));
+                prev_input = input;
+            }
+
+            COMMONLIB2_TARGET("avx2")
+            bool has_error() const {
+                return !_mm256_testz_si256(error, error);
+            }
+
+            COMMONLIB2_TARGET("avx2")
+            bool finish() {
+                error = _mm256_or_si256(error, prev_incomplete);
+                return !has_error();
+            }
+        };
+
+        //validate by blocks; on error locate it with scalar decoder from the last good block
+        template <class Validator>
+        inline UTFResult utf8_validate_simd(Validator& v, const unsigned char* in, size_t size) {
+            constexpr size_t width = Validator::width;
+            auto locate = [&](size_t pos) {
+                auto begin = pos >= width ? utf8_sequence_begin(in, pos - width) : 0;
+                auto ret = utf8_to_utf32_scalar(in, size, nullptr, begin, size, 0);
+                ret.written = 0;
+                return ret;
+            };
+            size_t pos = 0;
+            for (; pos + width <= size; pos += width) {
+                v.check(in + pos);
+                if (v.has_error()) {
+                    return locate(pos);
+                }
+            }
+            unsigned char tail[width] = {0};
+            ::memcpy(tail, in + pos, size - pos);
+            v.check(tail);
+            if (!v.finish()) {
+                return locate(pos);
+            }
+            UTFResult ret;
+            ret.read = size;
+            return ret;
+        }
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline UTFResult utf8_validate_sse42(const unsigned char* in, size_t size) {
+            SSEValidator v;
+            return utf8_validate_simd(v, in, size);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline UTFResult utf8_validate_avx2(const unsigned char* in, size_t size) {
+            AVXValidator v;
+            return utf8_validate_simd(v, in, size);
+        }
+
+        //ascii blocks are widened in registers; other blocks go through scalar decoder
+        COMMONLIB2_TARGET("sse4.2")
+        inline UTFResult utf8_to_utf32_sse42(const unsigned char* in, size_t size, char32_t* out) {
+            size_t pos = 0, written = 0;
+            while (pos + 16 <= size) {
+                auto v = _mm_loadu_si128((const __m128i*)(in + pos));
+                if (_mm_movemask_epi8(v) == 0) {
+                    auto dst = (__m128i*)(out + written);
+                    _mm_storeu_si128(dst, _mm_cvtepu8_epi32(v));
+                    _mm_storeu_si128(dst + 1, _mm_cvtepu8_epi32(_mm_srli_si128(v, 4)));
+                    _mm_storeu_si128(dst + 2, _mm_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+                    _mm_storeu_si128(dst + 3, _mm_cvtepu8_epi32(_mm_srli_si128(v, 12)));
+                    pos += 16;
+                    written += 16;
+                    continue;
+                }
+                auto ret = utf8_to_utf32_scalar(in, size, out, pos, pos + 16, written);
+                if (ret.err) return ret;
+                pos = ret.read;
+                written = ret.written;
+            }
+            return utf8_to_utf32_scalar(in, size, out, pos, size, written);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline UTFResult utf8_to_utf32_avx2(const unsigned char* in, size_t size, char32_t* out) {
+            size_t pos = 0, written = 0;
+            while (pos + 32 <= size) {
+                auto v = _mm256_loadu_si256((const __m256i*)(in + pos));
+                if (_mm256_movemask_epi8(v) == 0) {
+                    auto lo = _mm256_castsi256_si128(v);
+                    auto hi = _mm256_extracti128_si256(v, 1);
+                    auto dst = (__m256i*)(out + written);
+                    _mm256_storeu_si256(dst, _mm256_cvtepu8_epi32(lo));
+                    _mm256_storeu_si256(dst + 1, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+                    _mm256_storeu_si256(dst + 2, _mm256_cvtepu8_epi32(hi));
+                    _mm256_storeu_si256(dst + 3, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+                    pos += 32;
+                    written += 32;
+                    continue;
+                }
+                auto ret = utf8_to_utf32_scalar(in, size, out, pos, pos + 32, written);
+                if (ret.err) return ret;
+                pos = ret.read;
+                written = ret.written;
+            }
+            return utf8_to_utf32_scalar(in, size, out, pos, size, written);
+        }
+
+        //shuffle which packs utf-8 bytes of 4 code points (one per 32-bit lane) by their lengths
+        //index: bit n set if lane n needs 2 bytes or more, bit n+4 set if it needs 3
+        struct UTF8PackTable {
+            std::uint8_t shuffle[256][16] = {};
+            std::uint8_t length[256] = {};
+
+            constexpr UTF8PackTable() {
+                for (auto m = 0; m < 256; m++) {
+                    auto k = 0;
+                    for (auto lane = 0; lane < 4; lane++) {
+                        auto len = 1 + ((m >> lane) & 1) + ((m >> (lane + 4)) & 1);
+                        for (auto b = 0; b < len; b++) {
+                            shuffle[m][k++] = std::uint8_t(lane * 4 + b);
+                        }
+                    }
+                    length[m] = std::uint8_t(k);
+                    for (; k < 16; k++) {
+                        shuffle[m][k] = 0x80;
+                    }
+                }
+            }
+        };
+
+        constexpr UTF8PackTable utf8_pack_table{};
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline __m128i swap16_vec(const __m128i& v) {
+            return _mm_shuffle_epi8(v, _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+        }
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline __m128i load_utf16(const char16_t* p, bool swap) {
+            auto v = _mm_loadu_si128((const __m128i*)p);
+            return swap ? swap16_vec(v) : v;
+        }
+
+        //8 units to surrogate bits: high surrogates in bits 0-7, low surrogates in bits 8-15
+        COMMONLIB2_TARGET("sse4.2")
+        inline int surrogate_mask(const __m128i& v) {
+            auto top = _mm_and_si128(v, _mm_set1_epi16((short)0xfc00));
+            auto hi = _mm_cmpeq_epi16(top, _mm_set1_epi16((short)0xd800));
+            auto lo = _mm_cmpeq_epi16(top, _mm_set1_epi16((short)0xdc00));
+            return _mm_movemask_epi8(_mm_packs_epi16(hi, lo));
+        }
+
+        //units of a block which can be taken when every low surrogate follows a high one.
+        //a high surrogate at the end is left for next block. 0 means the block is invalid
+        inline size_t paired_units(int mask) {
+            auto hi = mask & 0xff, lo = (mask >> 8) & 0xff;
+            if (lo != ((hi << 1) & 0xff)) return 0;
+            return hi & 0x80 ? 7 : 8;
+        }
+
+        //lanes hold code points below U+10000 excluding surrogates. writes 16 bytes, returns bytes used
+        COMMONLIB2_TARGET("sse4.2")
+        inline size_t utf8_pack4(const __m128i& u, char* out) {
+            auto m2 = _mm_cmpgt_epi32(u, _mm_set1_epi32(0x7f));
+            auto m3 = _mm_cmpgt_epi32(u, _mm_set1_epi32(0x7ff));
+            auto cont = _mm_set1_epi32(0x3f), contbit = _mm_set1_epi32(0x80);
+            auto last = _mm_or_si128(_mm_and_si128(u, cont), contbit);
+            auto mid = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(u, 6), cont), contbit);
+            auto two = _mm_or_si128(_mm_or_si128(_mm_srli_epi32(u, 6), _mm_set1_epi32(0xc0)), _mm_slli_epi32(last, 8));
+            auto three = _mm_or_si128(_mm_or_si128(_mm_srli_epi32(u, 12), _mm_set1_epi32(0xe0)),
+                                      _mm_or_si128(_mm_slli_epi32(mid, 8), _mm_slli_epi32(last, 16)));
+            auto w = _mm_blendv_epi8(_mm_blendv_epi8(u, two, m2), three, m3);
+            auto idx = _mm_movemask_ps(_mm_castsi128_ps(m2)) | (_mm_movemask_ps(_mm_castsi128_ps(m3)) << 4);
+            auto shuf = _mm_loadu_si128((const __m128i*)utf8_pack_table.shuffle[idx]);
+            _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(w, shuf));
+            return utf8_pack_table.length[idx];
+        }
+
+        //true if 32-bit lanes are all below U+10000 and not surrogates
+        COMMONLIB2_TARGET("sse4.2")
+        inline bool is_bmp_scalar4(const __m128i& v) {
+            auto sur = _mm_cmpeq_epi32(_mm_and_si128(v, _mm_set1_epi32((int)0xfffff800)), _mm_set1_epi32(0xd800));
+            return _mm_testz_si128(v, _mm_set1_epi32((int)0xffff0000)) && _mm_testz_si128(sur, sur);
+        }
+
+        //fallback for a block the vector path does not take. also locates errors
+        template <class Src, class Dst>
+        inline bool scalar_block(const Src* in, size_t size, Dst* out, bool swap_in, bool swap_out, size_t block,
+                                 size_t& pos, size_t& written, UTFResult& ret) {
+            ret = transcode_scalar(in, size, out, swap_in, swap_out, pos, pos + block, written);
+            pos = ret.read;
+            written = ret.written;
+            return ret.err == 0;
+        }
+
+        //block steps take 8 input units (16 for utf-8) at pos and return false on invalid input.
+        //callers keep 16 input units behind pos so that 16 byte stores stay inside out
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline bool utf16_to_utf8_step(const char16_t* in, size_t size, char* out, size_t& pos, size_t& written,
+                                       bool swap, UTFResult& ret) {
+            auto v = load_utf16(in + pos, swap);
+            if (_mm_testz_si128(v, _mm_set1_epi16((short)0xff80))) {
+                _mm_storel_epi64((__m128i*)(out + written), _mm_packus_epi16(v, v));
+                pos += 8;
+                written += 8;
+                return true;
+            }
+            auto mask = surrogate_mask(v);
+            if (mask == 0) {
+                written += utf8_pack4(_mm_cvtepu16_epi32(v), out + written);
+                written += utf8_pack4(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8)), out + written);
+                pos += 8;
+                return true;
+            }
+            auto n = paired_units(mask);
+            if (n == 0) {
+                return scalar_block(in, size, out, swap, false, 8, pos, written, ret);
+            }
+            written += utf16_block_unchecked(in + pos, n, out + written, swap);
+            pos += n;
+            return true;
+        }
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline bool utf16_to_utf32_step(const char16_t* in, size_t size, char32_t* out, size_t& pos, size_t& written,
+                                        bool swap, UTFResult& ret) {
+            auto v = load_utf16(in + pos, swap);
+            auto mask = surrogate_mask(v);
+            if (mask == 0) {
+                _mm_storeu_si128((__m128i*)(out + written), _mm_cvtepu16_epi32(v));
+                _mm_storeu_si128((__m128i*)(out + written + 4), _mm_cvtepu16_epi32(_mm_srli_si128(v, 8)));
+                pos += 8;
+                written += 8;
+                return true;
+            }
+            auto n = paired_units(mask);
+            if (n == 0) {
+                return scalar_block(in, size, out, swap, false, 8, pos, written, ret);
+            }
+            written += utf16_block_unchecked(in + pos, n, out + written, swap);
+            pos += n;
+            return true;
+        }
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline bool utf32_to_utf8_step(const char32_t* in, size_t size, char* out, size_t& pos, size_t& written,
+                                       bool, UTFResult& ret) {
+            auto a = _mm_loadu_si128((const __m128i*)(in + pos));
+            auto b = _mm_loadu_si128((const __m128i*)(in + pos + 4));
+            if (_mm_testz_si128(_mm_or_si128(a, b), _mm_set1_epi32((int)0xffffff80))) {
+                auto w = _mm_packus_epi32(a, b);
+                _mm_storel_epi64((__m128i*)(out + written), _mm_packus_epi16(w, w));
+                pos += 8;
+                written += 8;
+                return true;
+            }
+            if (!is_bmp_scalar4(a) || !is_bmp_scalar4(b)) {
+                return scalar_block(in, size, out, false, false, 8, pos, written, ret);
+            }
+            written += utf8_pack4(a, out + written);
+            written += utf8_pack4(b, out + written);
+            pos += 8;
+            return true;
+        }
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline bool utf32_to_utf16_step(const char32_t* in, size_t size, char16_t* out, size_t& pos, size_t& written,
+                                        bool swap, UTFResult& ret) {
+            auto a = _mm_loadu_si128((const __m128i*)(in + pos));
+            auto b = _mm_loadu_si128((const __m128i*)(in + pos + 4));
+            if (!is_bmp_scalar4(a) || !is_bmp_scalar4(b)) {
+                return scalar_block(in, size, out, false, swap, 8, pos, written, ret);
+            }
+            auto w = _mm_packus_epi32(a, b);
+            _mm_storeu_si128((__m128i*)(out + written), swap ? swap16_vec(w) : w);
+            pos += 8;
+            written += 8;
+            return true;
+        }
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline bool utf8_to_utf16_step(const unsigned char* in, size_t size, char16_t* out, size_t& pos, size_t& written,
+                                       bool swap, UTFResult& ret) {
+            auto v = _mm_loadu_si128((const __m128i*)(in + pos));
+            if (_mm_movemask_epi8(v) != 0) {
+                return scalar_block(in, size, out, false, swap, 16, pos, written, ret);
+            }
+            auto lo = _mm_cvtepu8_epi16(v), hi = _mm_cvtepu8_epi16(_mm_srli_si128(v, 8));
+            _mm_storeu_si128((__m128i*)(out + written), swap ? swap16_vec(lo) : lo);
+            _mm_storeu_si128((__m128i*)(out + written + 8), swap ? swap16_vec(hi) : hi);
+            pos += 16;
+            written += 16;
+            return true;
+        }
+
+#define COMMONLIB2_UTF_SSE_KERNEL(NAME, SRC, DST, SWAP_IN, SWAP_OUT)                                      \
+    COMMONLIB2_TARGET("sse4.2")                                                                          \
+    inline UTFResult NAME##_sse42(const SRC* in, size_t size, DST* out, bool swap) {                     \
+        UTFResult ret;                                                                                   \
+        size_t pos = 0, written = 0;                                                                     \
+        while (pos + 16 <= size) {                                                                       \
+            if (!NAME##_step(in, size, out, pos, written, swap, ret)) return ret;                       \
+        }                                                                                                \
+        return transcode_scalar(in, size, out, SWAP_IN, SWAP_OUT, pos, size, written);                   \
+    }
+
+        COMMONLIB2_UTF_SSE_KERNEL(utf16_to_utf8, char16_t, char, swap, false)
+        COMMONLIB2_UTF_SSE_KERNEL(utf16_to_utf32, char16_t, char32_t, swap, false)
+        COMMONLIB2_UTF_SSE_KERNEL(utf32_to_utf8, char32_t, char, false, false)
+        COMMONLIB2_UTF_SSE_KERNEL(utf32_to_utf16, char32_t, char16_t, false, swap)
+        COMMONLIB2_UTF_SSE_KERNEL(utf8_to_utf16, unsigned char, char16_t, false, swap)
+#undef COMMONLIB2_UTF_SSE_KERNEL
+
+        //avx2 kernels take 16 units (32 for utf-8) at once while they need no conversion but widening
+        //or narrowing, and fall back to the sse steps (inlined here) for other blocks
+
+        COMMONLIB2_TARGET("avx2")
+        inline __m256i load_utf16_avx2(const char16_t* p, bool swap) {
+            auto v = _mm256_loadu_si256((const __m256i*)p);
+            if (!swap) return v;
+            auto mask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            return _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(mask));
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline UTFResult utf16_to_utf8_avx2(const char16_t* in, size_t size, char* out, bool swap) {
+            UTFResult ret;
+            size_t pos = 0, written = 0;
+            while (pos + 16 <= size) {
+                auto v = load_utf16_avx2(in + pos, swap);
+                if (_mm256_testz_si256(v, _mm256_set1_epi16((short)0xff80))) {
+                    auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+                    _mm_storeu_si128((__m128i*)(out + written), _mm256_castsi256_si128(packed));
+                    pos += 16;
+                    written += 16;
+                    continue;
+                }
+                if (!utf16_to_utf8_step(in, size, out, pos, written, swap, ret)) return ret;
+            }
+            return transcode_scalar(in, size, out, swap, false, pos, size, written);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline UTFResult utf16_to_utf32_avx2(const char16_t* in, size_t size, char32_t* out, bool swap) {
+            UTFResult ret;
+            size_t pos = 0, written = 0;
+            while (pos + 16 <= size) {
+                auto v = load_utf16_avx2(in + pos, swap);
+                auto sur = _mm256_cmpeq_epi16(_mm256_and_si256(v, _mm256_set1_epi16((short)0xf800)), _mm256_set1_epi16((short)0xd800));
+                if (_mm256_testz_si256(sur, sur)) {
+                    _mm256_storeu_si256((__m256i*)(out + written), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)));
+                    _mm256_storeu_si256((__m256i*)(out + written + 8), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)));
+                    pos += 16;
+                    written += 16;
+                    continue;
+                }
+                if (!utf16_to_utf32_step(in, size, out, pos, written, swap, ret)) return ret;
+            }
+            return transcode_scalar(in, size, out, swap, false, pos, size, written);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline UTFResult utf32_to_utf8_avx2(const char32_t* in, size_t size, char* out, bool) {
+            UTFResult ret;
+            size_t pos = 0, written = 0;
+            while (pos + 16 <= size) {
+                auto a = _mm256_loadu_si256((const __m256i*)(in + pos));
+                auto b = _mm256_loadu_si256((const __m256i*)(in + pos + 8));
+                if (_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_set1_epi32((int)0xffffff80))) {
+                    auto w = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xd8);
+                    auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(w, w), 0x08);
+                    _mm_storeu_si128((__m128i*)(out + written), _mm256_castsi256_si128(packed));
+                    pos += 16;
+                    written += 16;
+                    continue;
+                }
+                if (!utf32_to_utf8_step(in, size, out, pos, written, false, ret)) return ret;
+            }
+            return transcode_scalar(in, size, out, false, false, pos, size, written);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline UTFResult utf32_to_utf16_avx2(const char32_t* in, size_t size, char16_t* out, bool swap) {
+            UTFResult ret;
+            size_t pos = 0, written = 0;
+            auto swapmask = _mm256_broadcastsi128_si256(_mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+            while (pos + 16 <= size) {
+                auto a = _mm256_loadu_si256((const __m256i*)(in + pos));
+                auto b = _mm256_loadu_si256((const __m256i*)(in + pos + 8));
+                auto both = _mm256_or_si256(a, b);
+                auto sa = _mm256_cmpeq_epi32(_mm256_and_si256(a, _mm256_set1_epi32((int)0xfffff800)), _mm256_set1_epi32(0xd800));
+                auto sb = _mm256_cmpeq_epi32(_mm256_and_si256(b, _mm256_set1_epi32((int)0xfffff800)), _mm256_set1_epi32(0xd800));
+                auto sur = _mm256_or_si256(sa, sb);
+                if (_mm256_testz_si256(both, _mm256_set1_epi32((int)0xffff0000)) && _mm256_testz_si256(sur, sur)) {
+                    auto w = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xd8);
+                    _mm256_storeu_si256((__m256i*)(out + written), swap ? _mm256_shuffle_epi8(w, swapmask) : w);
+                    pos += 16;
+                    written += 16;
+                    continue;
+                }
+                if (!utf32_to_utf16_step(in, size, out, pos, written, swap, ret)) return ret;
+            }
+            return transcode_scalar(in, size, out, false, swap, pos, size, written);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline UTFResult utf8_to_utf16_avx2(const unsigned char* in, size_t size, char16_t* out, bool swap) {
+            UTFResult ret;
+            size_t pos = 0, written = 0;
+            auto swapmask = _mm256_broadcastsi128_si256(_mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+            while (pos + 32 <= size) {
+                auto v = _mm256_loadu_si256((const __m256i*)(in + pos));
+                if (_mm256_movemask_epi8(v) == 0) {
+                    auto lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v));
+                    auto hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1));
+                    _mm256_storeu_si256((__m256i*)(out + written), swap ? _mm256_shuffle_epi8(lo, swapmask) : lo);
+                    _mm256_storeu_si256((__m256i*)(out + written + 16), swap ? _mm256_shuffle_epi8(hi, swapmask) : hi);
+                    pos += 32;
+                    written += 32;
+                    continue;
+                }
+                if (!utf8_to_utf16_step(in, size, out, pos, written, swap, ret)) return ret;
+            }
+            return transcode_scalar(in, size, out, false, swap, pos, size, written);
+        }
+
+        inline UTFKernel detect_kernel() {
+#ifdef COMMONLIB2_IS_MSVC
+            int info[4] = {0};
+            __cpuid(info, 0);
+            auto max = info[0];
+            __cpuid(info, 1);
+            bool sse42 = (info[2] & (1 << 20)) != 0;
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx2 = false;
+            if (max >= 7 && osxsave && (_xgetbv(0) & 6) == 6) {
+                __cpuidex(info, 7, 0);
+                avx2 = (info[1] & (1 << 5)) != 0;
+            }
+#else
+            __builtin_cpu_init();
+            bool sse42 = __builtin_cpu_supports("sse4.2");
+            bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+            return avx2 ? UTFKernel::avx2 : sse42 ? UTFKernel::sse42 : UTFKernel::scalar;
+        }
+#else
+        inline UTFKernel detect_kernel() {
+            return UTFKernel::scalar;
+        }
+#endif
+    }  // namespace utf_detail
+
+    inline UTFKernel utf_kernel() {
+        static UTFKernel kernel = utf_detail::detect_kernel();
+        return kernel;
+    }
+
+    inline const char* utf_kernel_name(UTFKernel kernel) {
+        switch (kernel) {
+            case UTFKernel::avx2:
+                return "avx2";
+            case UTFKernel::sse42:
+                return "sse4.2";
+            default:
+                return "scalar";
+        }
+    }
+
+    //check in is valid utf-8 without writing
+    inline UTFResult utf8_validate(Sized<const char> in, UTFKernel kernel = utf_kernel()) {
+        auto p = (const unsigned char*)in.ptr;
+#ifdef COMMONLIB2_HAS_X86_SIMD
+        if (kernel == UTFKernel::avx2) {
+            return utf_detail::utf8_validate_avx2(p, in.size());
+        }
+        if (kernel == UTFKernel::sse42) {
+            return utf_detail::utf8_validate_sse42(p, in.size());
+        }
+#endif
+        auto ret = utf_detail::utf8_to_utf32_scalar(p, in.size(), nullptr);
+        ret.written = 0;
+        return ret;
+    }
+
+    //output units which are always enough to transcode size units of from_size bytes into to_size bytes
+    constexpr size_t utf_output_bound(size_t size, size_t from_size, size_t to_size) {
+        return from_size == 2 && to_size == 1   ? size * 3
+               : from_size == 4 && to_size == 1 ? size * 4
+               : from_size == 4 && to_size == 2 ? size * 2
+                                                : size;
+    }
+
+    //swap flag of bulk transcoders for utf-16 data in given byte order (UTF-16BE if big_endian)
+    inline bool utf16_swap(bool big_endian) {
+        const char16_t one = 1;
+        return big_endian == (*(const unsigned char*)&one == 1);
+    }
+
+    //bulk transcoders below need out.size() >= utf_output_bound(in.size(),...) or return err=-1.
+    //on error, out holds units converted before read. swap selects byte swapped utf-16 (see utf16_swap)
+
+    inline UTFResult utf8_to_utf32(Sized<const char> in, Sized<char32_t> out, UTFKernel kernel = utf_kernel()) {
+        if (out.size() < in.size()) {
+            UTFResult ret;
+            ret.err = -1;
+            return ret;
+        }
+        auto p = (const unsigned char*)in.ptr;
+#ifdef COMMONLIB2_HAS_X86_SIMD
+        if (kernel == UTFKernel::avx2) {
+            return utf_detail::utf8_to_utf32_avx2(p, in.size(), out.ptr);
+        }
+        if (kernel == UTFKernel::sse42) {
+            return utf_detail::utf8_to_utf32_sse42(p, in.size(), out.ptr);
+        }
+#endif
+        return utf_detail::utf8_to_utf32_scalar(p, in.size(), out.ptr);
+    }
+
+#ifdef COMMONLIB2_HAS_X86_SIMD
+#define COMMONLIB2_UTF_DISPATCH(NAME, IN, OUT, SWAP)                             \
+    if (kernel == UTFKernel::avx2) return utf_detail::NAME##_avx2(IN, in.size(), OUT, SWAP); \
+    if (kernel == UTFKernel::sse42) return utf_detail::NAME##_sse42(IN, in.size(), OUT, SWAP);
+#else
+#define COMMONLIB2_UTF_DISPATCH(NAME, IN, OUT, SWAP)
+#endif
+
+#define COMMONLIB2_UTF_BULK(NAME, FROM, TO, IN, SWAP_IN, SWAP_OUT)                                                   \
+    inline UTFResult NAME(Sized<const FROM> in, Sized<TO> out, bool swap = false, UTFKernel kernel = utf_kernel()) { \
+        if (out.size() < utf_output_bound(in.size(), sizeof(FROM), sizeof(TO))) {                                  \
+            UTFResult ret;                                                                                          \
+            ret.err = -1;                                                                                           \
+            return ret;                                                                                             \
+        }                                                                                                           \
+        COMMONLIB2_UTF_DISPATCH(NAME, IN, out.ptr, swap)                                                            \
+        return utf_detail::transcode_scalar(IN, in.size(), out.ptr, SWAP_IN, SWAP_OUT);                             \
+    }
+
+    COMMONLIB2_UTF_BULK(utf8_to_utf16, char, char16_t, (const unsigned char*)in.ptr, false, swap)
+    COMMONLIB2_UTF_BULK(utf16_to_utf8, char16_t, char, in.ptr, swap, false)
+    COMMONLIB2_UTF_BULK(utf16_to_utf32, char16_t, char32_t, in.ptr, swap, false)
+    COMMONLIB2_UTF_BULK(utf32_to_utf16, char32_t, char16_t, in.ptr, false, swap)
+    COMMONLIB2_UTF_BULK(utf32_to_utf8, char32_t, char, in.ptr, false, false)
+#undef COMMONLIB2_UTF_BULK
+#undef COMMONLIB2_UTF_DISPATCH
+
+    namespace utf_detail {
+        //counters for utf_length. lengths are summed per unit so invalid input gets a deterministic count
+        inline size_t utf8_length_scalar(const unsigned char* in, size_t size, size_t to_size) {
+            size_t count = 0;
+            for (size_t i = 0; i < size; i++) {
+                auto c = in[i];
+                count += to_size == 1 || (c & 0xc0) != 0x80;
+                count += to_size == 2 && c >= 0xf0;
+            }
+            return count;
+        }
+
+        inline size_t utf16_length_scalar(const char16_t* in, size_t size, size_t to_size, bool swap) {
+            size_t count = 0;
+            for (size_t i = 0; i < size; i++) {
+                auto c = swap ? swap16(in[i]) : in[i];
+                auto sur = c >= 0xd800 && c <= 0xdfff;
+                if (to_size == 1) {
+                    count += 1 + (c >= 0x80) + (c >= 0x800 && !sur);
+                }
+                else {
+                    count += to_size == 2 || c < 0xdc00 || c > 0xdfff;
+                }
+            }
+            return count;
+        }
+
+        inline size_t utf32_length_scalar(const char32_t* in, size_t size, size_t to_size, bool swap) {
+            size_t count = 0;
+            for (size_t i = 0; i < size; i++) {
+                auto c = swap ? swap32(in[i]) : in[i];
+                count += to_size == 1   ? 1 + (c >= 0x80) + (c >= 0x800) + (c >= 0x10000)
+                         : to_size == 2 ? 1 + (c >= 0x10000)
+                                        : 1;
+            }
+            return count;
+        }
+
+#ifdef COMMONLIB2_HAS_X86_SIMD
+        //compare masks (-1 per lane) are subtracted into lane counters which are summed before they overflow
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline size_t sum_u64x2(const __m128i& v) {
+            alignas(16) std::uint64_t lanes[2];
+            _mm_store_si128((__m128i*)lanes, v);
+            return (size_t)(lanes[0] + lanes[1]);
+        }
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline size_t sum_u32x4(const __m128i& v) {
+            alignas(16) std::uint32_t lanes[4];
+            _mm_store_si128((__m128i*)lanes, v);
+            return (size_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline size_t utf8_length_sse42(const unsigned char* in, size_t size, size_t to_size) {
+            if (to_size == 1) return size;
+            const auto lead = _mm_set1_epi8(-65), four = _mm_set1_epi8((char)0xf0), zero = _mm_setzero_si128();
+            size_t pos = 0, count = 0;
+            while (pos + 16 <= size) {
+                auto acc = zero;
+                //8-bit lanes grow at most 2 per step
+                for (auto n = 0; n < 127 && pos + 16 <= size; n++, pos += 16) {
+                    auto v = _mm_loadu_si128((const __m128i*)(in + pos));
+                    acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(v, lead));
+                    if (to_size == 2) {
+                        acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_max_epu8(v, four), v));
+                    }
+                }
+                count += sum_u64x2(_mm_sad_epu8(acc, zero));
+            }
+            return count + utf8_length_scalar(in + pos, size - pos, to_size);
+        }
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline size_t utf16_length_sse42(const char16_t* in, size_t size, size_t to_size, bool swap) {
+            if (to_size == 2) return size;
+            const auto order = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            const auto zero = _mm_setzero_si128(), ones = _mm_set1_epi16(1);
+            size_t pos = 0, minus = 0;
+            while (pos + 8 <= size) {
+                auto acc = zero;
+                //16-bit lanes grow at most 2 per step and are summed as signed
+                for (auto n = 0; n < 8192 && pos + 8 <= size; n++, pos += 8) {
+                    auto v = _mm_loadu_si128((const __m128i*)(in + pos));
+                    if (swap) v = _mm_shuffle_epi8(v, order);
+                    if (to_size == 1) {
+                        auto top = _mm_and_si128(v, _mm_set1_epi16((short)0xf800));
+                        auto lt80 = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xff80)), zero);
+                        auto lt800_or_sur = _mm_or_si128(_mm_cmpeq_epi16(top, zero),
+                                                         _mm_cmpeq_epi16(top, _mm_set1_epi16((short)0xd800)));
+                        acc = _mm_sub_epi16(_mm_sub_epi16(acc, lt80), lt800_or_sur);
+                    }
+                    else {
+                        auto low = _mm_and_si128(v, _mm_set1_epi16((short)0xfc00));
+                        acc = _mm_sub_epi16(acc, _mm_cmpeq_epi16(low, _mm_set1_epi16((short)0xdc00)));
+                    }
+                }
+                minus += sum_u32x4(_mm_madd_epi16(acc, ones));
+            }
+            return (to_size == 1 ? pos * 3 : pos) - minus + utf16_length_scalar(in + pos, size - pos, to_size, swap);
+        }
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline size_t utf32_length_sse42(const char32_t* in, size_t size, size_t to_size, bool swap) {
+            if (to_size == 4) return size;
+            const auto order = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            const auto below80 = _mm_set1_epi32(0x7f), below800 = _mm_set1_epi32(0x7ff), bmp = _mm_set1_epi32(0xffff);
+            auto acc = _mm_setzero_si128();
+            size_t pos = 0;
+            //32-bit lanes grow at most 3 per step
+            for (; pos + 4 <= size; pos += 4) {
+                auto v = _mm_loadu_si128((const __m128i*)(in + pos));
+                if (swap) v = _mm_shuffle_epi8(v, order);
+                acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(_mm_min_epu32(v, bmp), v));
+                if (to_size == 1) {
+                    acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(_mm_min_epu32(v, below80), v));
+                    acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(_mm_min_epu32(v, below800), v));
+                }
+            }
+            auto minus = sum_u32x4(acc);
+            return (to_size == 1 ? pos * 4 : pos * 2) - minus + utf32_length_scalar(in + pos, size - pos, to_size, swap);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline size_t sum_u64x4(const __m256i& v) {
+            alignas(32) std::uint64_t lanes[4];
+            _mm256_store_si256((__m256i*)lanes, v);
+            return (size_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline size_t sum_u32x8(const __m256i& v) {
+            alignas(32) std::uint32_t lanes[8];
+            _mm256_store_si256((__m256i*)lanes, v);
+            size_t sum = 0;
+            for (auto lane : lanes) {
+                sum += lane;
+            }
+            return sum;
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline size_t utf8_length_avx2(const unsigned char* in, size_t size, size_t to_size) {
+            if (to_size == 1) return size;
+            const auto lead = _mm256_set1_epi8(-65), four = _mm256_set1_epi8((char)0xf0), zero = _mm256_setzero_si256();
+            size_t pos = 0, count = 0;
+            while (pos + 32 <= size) {
+                auto acc = zero;
+                for (auto n = 0; n < 127 && pos + 32 <= size; n++, pos += 32) {
+                    auto v = _mm256_loadu_si256((const __m256i*)(in + pos));
+                    acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(v, lead));
+                    if (to_size == 2) {
+                        acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(_mm256_max_epu8(v, four), v));
+                    }
+                }
+                count += sum_u64x4(_mm256_sad_epu8(acc, zero));
+            }
+            return count + utf8_length_scalar(in + pos, size - pos, to_size);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline size_t utf16_length_avx2(const char16_t* in, size_t size, size_t to_size, bool swap) {
+            if (to_size == 2) return size;
+            const auto order = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                                1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            const auto zero = _mm256_setzero_si256(), ones = _mm256_set1_epi16(1);
+            size_t pos = 0, minus = 0;
+            while (pos + 16 <= size) {
+                auto acc = zero;
+                for (auto n = 0; n < 8192 && pos + 16 <= size; n++, pos += 16) {
+                    auto v = _mm256_loadu_si256((const __m256i*)(in + pos));
+                    if (swap) v = _mm256_shuffle_epi8(v, order);
+                    if (to_size == 1) {
+                        auto top = _mm256_and_si256(v, _mm256_set1_epi16((short)0xf800));
+                        auto lt80 = _mm256_cmpeq_epi16(_mm256_and_si256(v, _mm256_set1_epi16((short)0xff80)), zero);
+                        auto lt800_or_sur = _mm256_or_si256(_mm256_cmpeq_epi16(top, zero),
+                                                            _mm256_cmpeq_epi16(top, _mm256_set1_epi16((short)0xd800)));
+                        acc = _mm256_sub_epi16(_mm256_sub_epi16(acc, lt80), lt800_or_sur);
+                    }
+                    else {
+                        auto low = _mm256_and_si256(v, _mm256_set1_epi16((short)0xfc00));
+                        acc = _mm256_sub_epi16(acc, _mm256_cmpeq_epi16(low, _mm256_set1_epi16((short)0xdc00)));
+                    }
+                }
+                minus += sum_u32x8(_mm256_madd_epi16(acc, ones));
+            }
+            return (to_size == 1 ? pos * 3 : pos) - minus + utf16_length_scalar(in + pos, size - pos, to_size, swap);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline size_t utf32_length_avx2(const char32_t* in, size_t size, size_t to_size, bool swap) {
+            if (to_size == 4) return size;
+            const auto order = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            const auto below80 = _mm256_set1_epi32(0x7f), below800 = _mm256_set1_epi32(0x7ff);
+            const auto bmp = _mm256_set1_epi32(0xffff);
+            auto acc = _mm256_setzero_si256();
+            size_t pos = 0;
+            for (; pos + 8 <= size; pos += 8) {
+                auto v = _mm256_loadu_si256((const __m256i*)(in + pos));
+                if (swap) v = _mm256_shuffle_epi8(v, order);
+                acc = _mm256_sub_epi32(acc, _mm256_cmpeq_epi32(_mm256_min_epu32(v, bmp), v));
+                if (to_size == 1) {
+                    acc = _mm256_sub_epi32(acc, _mm256_cmpeq_epi32(_mm256_min_epu32(v, below80), v));
+                    acc = _mm256_sub_epi32(acc, _mm256_cmpeq_epi32(_mm256_min_epu32(v, below800), v));
+                }
+            }
+            auto minus = sum_u32x8(acc);
+            return (to_size == 1 ? pos * 4 : pos * 2) - minus + utf32_length_scalar(in + pos, size - pos, to_size, swap);
+        }
+#endif
+    }  // namespace utf_detail
+
+#ifdef COMMONLIB2_HAS_X86_SIMD
+#define COMMONLIB2_UTF_KERNEL_DISPATCH(NAME, ...)                                   \
+    if (kernel == UTFKernel::avx2) return utf_detail::NAME##_avx2(__VA_ARGS__);  \
+    if (kernel == UTFKernel::sse42) return utf_detail::NAME##_sse42(__VA_ARGS__);
+#else
+#define COMMONLIB2_UTF_KERNEL_DISPATCH(NAME, ...)
+#endif
+
+    //output units of to_size bytes which transcoding valid input produces, counted without decoding.
+    //count of invalid input is not specified; transcoders report its errors
+    inline size_t utf_length(Sized<const char> in, size_t to_size, UTFKernel kernel = utf_kernel()) {
+        auto p = (const unsigned char*)in.ptr;
+        COMMONLIB2_UTF_KERNEL_DISPATCH(utf8_length, p, in.size(), to_size)
+        return utf_detail::utf8_length_scalar(p, in.size(), to_size);
+    }
+
+    inline size_t utf_length(Sized<const char16_t> in, size_t to_size, bool swap = false, UTFKernel kernel = utf_kernel()) {
+        COMMONLIB2_UTF_KERNEL_DISPATCH(utf16_length, in.ptr, in.size(), to_size, swap)
+        return utf_detail::utf16_length_scalar(in.ptr, in.size(), to_size, swap);
+    }
+
+    inline size_t utf_length(Sized<const char32_t> in, size_t to_size, bool swap = false, UTFKernel kernel = utf_kernel()) {
+        COMMONLIB2_UTF_KERNEL_DISPATCH(utf32_length, in.ptr, in.size(), to_size, swap)
+        return utf_detail::utf32_length_scalar(in.ptr, in.size(), to_size, swap);
+    }
+
+    namespace utf_detail {
+        inline size_t ascii_case_scalar(const unsigned char* in, size_t size, unsigned char* out, bool upper) {
+            unsigned char first = upper ? 'a' : 'A';
+            size_t pos = 0;
+            for (; pos < size && in[pos] < 0x80; pos++) {
+                auto c = in[pos];
+                out[pos] = (unsigned char)(c - first) < 26 ? c ^ 0x20 : c;
+            }
+            return pos;
+        }
+
+        inline size_t ascii_case_scalar(const char32_t* in, size_t size, char32_t* out, bool upper) {
+            char32_t first = upper ? 'a' : 'A';
+            size_t pos = 0;
+            for (; pos < size && in[pos] < 0x80; pos++) {
+                auto c = in[pos];
+                out[pos] = c - first < 26 ? c ^ 0x20 : c;
+            }
+            return pos;
+        }
+
+#ifdef COMMONLIB2_HAS_X86_SIMD
+        //letters are moved to -128..-103 so that one signed compare finds them
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline size_t ascii_case_sse42(const unsigned char* in, size_t size, unsigned char* out, bool upper) {
+            const auto shift = _mm_set1_epi8((char)(0x80 - (upper ? 'a' : 'A')));
+            const auto limit = _mm_set1_epi8(-128 + 26), bit = _mm_set1_epi8(0x20);
+            size_t pos = 0;
+            for (; pos + 16 <= size; pos += 16) {
+                auto v = _mm_loadu_si128((const __m128i*)(in + pos));
+                if (_mm_movemask_epi8(v)) break;
+                auto letter = _mm_cmpgt_epi8(limit, _mm_add_epi8(v, shift));
+                _mm_storeu_si128((__m128i*)(out + pos), _mm_xor_si128(v, _mm_and_si128(letter, bit)));
+            }
+            return pos + ascii_case_scalar(in + pos, size - pos, out + pos, upper);
+        }
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline size_t ascii_case_sse42(const char32_t* in, size_t size, char32_t* out, bool upper) {
+            const auto shift = _mm_set1_epi32((int)(0x80000000u - (upper ? 'a' : 'A')));
+            const auto limit = _mm_set1_epi32((int)(0x80000000u + 26)), ascii = _mm_set1_epi32(0x7f), bit = _mm_set1_epi32(0x20);
+            size_t pos = 0;
+            for (; pos + 4 <= size; pos += 4) {
+                auto v = _mm_loadu_si128((const __m128i*)(in + pos));
+                if (_mm_movemask_epi8(_mm_cmpgt_epi32(v, ascii))) break;
+                auto letter = _mm_cmpgt_epi32(limit, _mm_add_epi32(v, shift));
+                _mm_storeu_si128((__m128i*)(out + pos), _mm_xor_si128(v, _mm_and_si128(letter, bit)));
+            }
+            return pos + ascii_case_scalar(in + pos, size - pos, out + pos, upper);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline size_t ascii_case_avx2(const unsigned char* in, size_t size, unsigned char* out, bool upper) {
+            const auto shift = _mm256_set1_epi8((char)(0x80 - (upper ? 'a' : 'A')));
+            const auto limit = _mm256_set1_epi8(-128 + 26), bit = _mm256_set1_epi8(0x20);
+            size_t pos = 0;
+            for (; pos + 32 <= size; pos += 32) {
+                auto v = _mm256_loadu_si256((const __m256i*)(in + pos));
+                if (_mm256_movemask_epi8(v)) break;
+                auto letter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, shift));
+                _mm256_storeu_si256((__m256i*)(out + pos), _mm256_xor_si256(v, _mm256_and_si256(letter, bit)));
+            }
+            return pos + ascii_case_sse42(in + pos, size - pos, out + pos, upper);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline size_t ascii_case_avx2(const char32_t* in, size_t size, char32_t* out, bool upper) {
+            const auto shift = _mm256_set1_epi32((int)(0x80000000u - (upper ? 'a' : 'A')));
+            const auto limit = _mm256_set1_epi32((int)(0x80000000u + 26)), ascii = _mm256_set1_epi32(0x7f);
+            const auto bit = _mm256_set1_epi32(0x20);
+            size_t pos = 0;
+            for (; pos + 8 <= size; pos += 8) {
+                auto v = _mm256_loadu_si256((const __m256i*)(in + pos));
+                if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(v, ascii))) break;
+                auto letter = _mm256_cmpgt_epi32(limit, _mm256_add_epi32(v, shift));
+                _mm256_storeu_si256((__m256i*)(out + pos), _mm256_xor_si256(v, _mm256_and_si256(letter, bit)));
+            }
+            return pos + ascii_case_sse42(in + pos, size - pos, out + pos, upper);
+        }
+#endif
+    }  // namespace utf_detail
+
+    //map ascii letters of the leading ascii run of in to upper (or lower) case into out.
+    //returns length of the run; nothing after it is written
+    inline size_t ascii_case(Sized<const char> in, char* out, bool upper, UTFKernel kernel = utf_kernel()) {
+        auto p = (const unsigned char*)in.ptr;
+        auto o = (unsigned char*)out;
+        COMMONLIB2_UTF_KERNEL_DISPATCH(ascii_case, p, in.size(), o, upper)
+        return utf_detail::ascii_case_scalar(p, in.size(), o, upper);
+    }
+
+    inline size_t ascii_case(Sized<const char32_t> in, char32_t* out, bool upper, UTFKernel kernel = utf_kernel()) {
+        COMMONLIB2_UTF_KERNEL_DISPATCH(ascii_case, in.ptr, in.size(), out, upper)
+        return utf_detail::ascii_case_scalar(in.ptr, in.size(), out, upper);
+    }
+
+    namespace utf_detail {
+        inline size_t ascii_width_scalar(const unsigned char* in, size_t size, size_t& controls) {
+            size_t pos = 0;
+            for (; pos < size && in[pos] < 0x80; pos++) {
+                controls += in[pos] < 0x20 || in[pos] == 0x7f;
+            }
+            return pos;
+        }
+
+#ifdef COMMONLIB2_HAS_X86_SIMD
+        //control bytes are counted by subtracting compare masks; 8 bit lanes are flushed before overflow
+
+        COMMONLIB2_TARGET("sse4.2")
+        inline size_t ascii_width_sse42(const unsigned char* in, size_t size, size_t& controls) {
+            const auto space = _mm_set1_epi8(0x20), del = _mm_set1_epi8(0x7f), zero = _mm_setzero_si128();
+            size_t pos = 0;
+            auto ascii = true;
+            while (ascii && pos + 16 <= size) {
+                auto acc = zero;
+                for (auto n = 0; n < 255 && pos + 16 <= size; n++, pos += 16) {
+                    auto v = _mm_loadu_si128((const __m128i*)(in + pos));
+                    if (_mm_movemask_epi8(v)) {
+                        ascii = false;
+                        break;
+                    }
+                    acc = _mm_sub_epi8(acc, _mm_or_si128(_mm_cmpgt_epi8(space, v), _mm_cmpeq_epi8(v, del)));
+                }
+                controls += sum_u64x2(_mm_sad_epu8(acc, zero));
+            }
+            return pos + ascii_width_scalar(in + pos, size - pos, controls);
+        }
+
+        COMMONLIB2_TARGET("avx2")
+        inline size_t ascii_width_avx2(const unsigned char* in, size_t size, size_t& controls) {
+            const auto space = _mm256_set1_epi8(0x20), del = _mm256_set1_epi8(0x7f), zero = _mm256_setzero_si256();
+            size_t pos = 0;
+            auto ascii = true;
+            while (ascii && pos + 32 <= size) {
+                auto acc = zero;
+                for (auto n = 0; n < 255 && pos + 32 <= size; n++, pos += 32) {
+                    auto v = _mm256_loadu_si256((const __m256i*)(in + pos));
+                    if (_mm256_movemask_epi8(v)) {
+                        ascii = false;
+                        break;
+                    }
+                    acc = _mm256_sub_epi8(acc, _mm256_or_si256(_mm256_cmpgt_epi8(space, v), _mm256_cmpeq_epi8(v, del)));
+                }
+                controls += sum_u64x4(_mm256_sad_epu8(acc, zero));
+            }
+            return pos + ascii_width_sse42(in + pos, size - pos, controls);
+        }
+#endif
+    }  // namespace utf_detail
+
+    //length of the leading ascii run of in. control characters (C0 and DEL) in it are added to controls
+    inline size_t ascii_width(Sized<const char> in, size_t& controls, UTFKernel kernel = utf_kernel()) {
+        auto p = (const unsigned char*)in.ptr;
+        COMMONLIB2_UTF_KERNEL_DISPATCH(ascii_width, p, in.size(), controls)
+        return utf_detail::ascii_width_scalar(p, in.size(), controls);
+    }
+#undef COMMONLIB2_UTF_KERNEL_DISPATCH
+
+    //transcode by unit sizes of From and To (wchar_t, char8_t and so on). same unit size is copied as is
+    template <class From, class To>
+    UTFResult utf_transcode(const From* in, size_t size, To* out, size_t capacity, UTFKernel kernel = utf_kernel()) {
+        static_assert(sizeof(From) == 1 || sizeof(From) == 2 || sizeof(From) == 4, "unit must be 1, 2 or 4 bytes");
+        static_assert(sizeof(To) == 1 || sizeof(To) == 2 || sizeof(To) == 4, "unit must be 1, 2 or 4 bytes");
+        using F = std::conditional_t<sizeof(From) == 1, char, std::conditional_t<sizeof(From) == 2, char16_t, char32_t>>;
+        using T = std::conditional_t<sizeof(To) == 1, char, std::conditional_t<sizeof(To) == 2, char16_t, char32_t>>;
+        Sized<const F> src((const F*)in, size);
+        Sized<T> dst((T*)out, capacity);
+        UTFResult ret;
+        if CONSTEXPRIF (sizeof(From) == sizeof(To)) {
+            if (capacity < size) {
+                ret.err = -1;
+                return ret;
+            }
+            ::memcpy(out, in, size * sizeof(From));
+            ret.read = ret.written = size;
+        }
+        else if CONSTEXPRIF (sizeof(From) == 1 && sizeof(To) == 2) {
+            ret = utf8_to_utf16(src, dst, false, kernel);
+        }
+        else if CONSTEXPRIF (sizeof(From) == 1) {
+            ret = utf8_to_utf32(src, dst, kernel);
+        }
+        else if CONSTEXPRIF (sizeof(From) == 2 && sizeof(To) == 1) {
+            ret = utf16_to_utf8(src, dst, false, kernel);
+        }
+        else if CONSTEXPRIF (sizeof(From) == 2) {
+            ret = utf16_to_utf32(src, dst, false, kernel);
+        }
+        else if CONSTEXPRIF (sizeof(To) == 1) {
+            ret = utf32_to_utf8(src, dst, false, kernel);
+        }
+        else {
+            ret = utf32_to_utf16(src, dst, false, kernel);
+        }
+        return ret;
+    }
+
+    namespace utf_detail {
+        //move end back to the head of the sequence which contains in[end]
+        inline size_t sequence_head(const char* in, size_t pos, size_t end, bool) {
+            for (auto i = 0; i < 3 && end > pos && ((unsigned char)in[end] & 0xc0) == 0x80; i++) {
+                end--;
+            }
+            return end;
+        }
+
+        inline size_t sequence_head(const char16_t* in, size_t pos, size_t end, bool swap) {
+            auto c = swap ? swap16(in[end]) : in[end];
+            return end > pos && c >= 0xdc00 && c <= 0xdfff ? end - 1 : end;
+        }
+
+        inline size_t sequence_head(const char32_t*, size_t, size_t end, bool) {
+            return end;
+        }
+
+        //units replaced by one U+FFFD at an invalid sequence (maximal subpart of Unicode 3.9 / WHATWG)
+        inline size_t maximal_subpart(const char* in, size_t rem) {
+            auto p = (const unsigned char*)in;
+            size_t len = 0;
+            unsigned char lo = 0x80, hi = 0xbf;
+            if (p[0] >= 0xc2 && p[0] <= 0xdf) {
+                len = 2;
+            }
+            else if (p[0] >= 0xe0 && p[0] <= 0xef) {
+                len = 3;
+                lo = p[0] == 0xe0 ? 0xa0 : 0x80;
+                hi = p[0] == 0xed ? 0x9f : 0xbf;
+            }
+            else if (p[0] >= 0xf0 && p[0] <= 0xf4) {
+                len = 4;
+                lo = p[0] == 0xf0 ? 0x90 : 0x80;
+                hi = p[0] == 0xf4 ? 0x8f : 0xbf;
+            }
+            else {
+                return 1;
+            }
+            size_t i = 1;
+            for (; i < len && i < rem && p[i] >= lo && p[i] <= hi; i++) {
+                lo = 0x80;
+                hi = 0xbf;
+            }
+            return i;
+        }
+
+        inline size_t maximal_subpart(const char16_t*, size_t) {
+            return 1;
+        }
+
+        inline size_t maximal_subpart(const char32_t*, size_t) {
+            return 1;
+        }
+
+        //bulk transcode with byte swapped utf-16 on either side. same unit size is validated then copied
+        template <class F, class T>
+        UTFResult transcode_step(const F* in, size_t size, T* out, size_t capacity, bool swap_in, bool swap_out,
+                                 UTFKernel kernel) {
+            Sized<const F> src(in, size);
+            Sized<T> dst(out, capacity);
+            UTFResult ret;
+            if CONSTEXPRIF (sizeof(F) == sizeof(T)) {
+                if (capacity < size) {
+                    ret.err = -1;
+                    return ret;
+                }
+                if CONSTEXPRIF (sizeof(F) == 1) {
+                    ret = utf8_validate(src, kernel);
+                }
+                else {
+                    ret = transcode_scalar(in, size, (T*)nullptr, swap_in);
+                }
+                if (sizeof(F) == 2 && swap_in != swap_out) {
+                    for (size_t i = 0; i < ret.read; i++) {
+                        out[i] = swap16(in[i]);
+                    }
+                }
+                else {
+                    ::memcpy(out, in, ret.read * sizeof(F));
+                }
+                ret.written = ret.read;
+            }
+            else if CONSTEXPRIF (sizeof(F) == 1 && sizeof(T) == 2) {
+                ret = utf8_to_utf16(src, dst, swap_out, kernel);
+            }
+            else if CONSTEXPRIF (sizeof(F) == 1) {
+                ret = utf8_to_utf32(src, dst, kernel);
+            }
+            else if CONSTEXPRIF (sizeof(F) == 2 && sizeof(T) == 1) {
+                ret = utf16_to_utf8(src, dst, swap_in, kernel);
+            }
+            else if CONSTEXPRIF (sizeof(F) == 2) {
+                ret = utf16_to_utf32(src, dst, swap_in, kernel);
+            }
+            else if CONSTEXPRIF (sizeof(T) == 1) {
+                ret = utf32_to_utf8(src, dst, false, kernel);
+            }
+            else {
+                ret = utf32_to_utf16(src, dst, swap_out, kernel);
+            }
+            return ret;
+        }
+
+        template <class T>
+        using unit_t = std::conditional_t<sizeof(T) == 1, char, std::conditional_t<sizeof(T) == 2, char16_t, char32_t>>;
+    }  // namespace utf_detail
+
+    //same as utf_transcode but out may be any size and same unit size is validated.
+    //bulk kernels run while the rest of out keeps the bound, then code points are written one by one
+    //until one does not fit (err=-1, read is its position). swap selects byte swapped utf-16 (see utf16_swap)
+    template <class From, class To>
+    UTFResult utf_transcode_exact(const From* in, size_t size, To* out, size_t capacity, bool swap_in = false,
+                                  bool swap_out = false, UTFKernel kernel = utf_kernel()) {
+        using F = utf_detail::unit_t<From>;
+        using T = utf_detail::unit_t<To>;
+        constexpr size_t ratio = utf_output_bound(1, sizeof(From), sizeof(To));
+        auto src = (const F*)in;
+        auto dst = (T*)out;
+        UTFResult ret;
+        while (ret.read < size) {
+            auto n = (capacity - ret.written) / ratio;
+            if (n > size - ret.read) n = size - ret.read;
+            if (n < 64) break;
+            auto end = ret.read + n;
+            if (end < size) end = utf_detail::sequence_head(src, ret.read, end, swap_in);
+            auto res = utf_detail::transcode_step(src + ret.read, end - ret.read, dst + ret.written,
+                                                  capacity - ret.written, swap_in, swap_out, kernel);
+            ret.written += res.written;
+            if (res.err) {
+                ret.read += res.read;
+                ret.err = res.err;
+                return ret;
+            }
+            ret.read = end;
+        }
+        using S = std::conditional_t<sizeof(From) == 1, unsigned char, F>;
+        while (ret.read < size) {
+            char32_t c = 0;
+            int len = 0;
+            if (auto err = utf_detail::decode_one((const S*)src + ret.read, size - ret.read, swap_in, c, len)) {
+                ret.err = err;
+                break;
+            }
+            T tmp[4];
+            auto units = (size_t)utf_detail::encode_one(c, tmp, swap_out);
+            if (capacity - ret.written < units) {
+                ret.err = -1;
+                break;
+            }
+            ::memcpy(dst + ret.written, tmp, units * sizeof(T));
+            ret.written += units;
+            ret.read += len;
+        }
+        return ret;
+    }
+
+    //invalid sequences met by utf_transcode_replace. offsets are input units plus base
+    struct UTFErrorReport {
+        static constexpr size_t max_offsets = 16;
+        size_t count = 0;
+        size_t base = 0;
+        size_t offsets[max_offsets] = {0};
+
+        void add(size_t pos) {
+            if (count < max_offsets) {
+                offsets[count] = base + pos;
+            }
+            count++;
+        }
+    };
+
+    //output units which are always enough for utf_transcode_replace
+    constexpr size_t utf_replace_bound(size_t size, size_t from_size, size_t to_size) {
+        return from_size == 1 && to_size == 1 ? size * 3 : utf_output_bound(size, from_size, to_size);
+    }
+
+    //lossy transcode: each maximal subpart of an invalid sequence becomes U+FFFD and is recorded in report.
+    //valid runs go through the bulk kernels. err is -1 only if out is too short (see utf_transcode_exact)
+    template <class From, class To>
+    UTFResult utf_transcode_replace(const From* in, size_t size, To* out, size_t capacity, UTFErrorReport& report,
+                                    bool swap_in = false, bool swap_out = false, UTFKernel kernel = utf_kernel()) {
+        using F = utf_detail::unit_t<From>;
+        using T = utf_detail::unit_t<To>;
+        auto src = (const F*)in;
+        auto dst = (T*)out;
+        UTFResult ret;
+        while (ret.read < size) {
+            auto res = utf_transcode_exact(src + ret.read, size - ret.read, dst + ret.written, capacity - ret.written,
+                                           swap_in, swap_out, kernel);
+            ret.read += res.read;
+            ret.written += res.written;
+            if (res.err == 0) {
+                break;
+            }
+            if (res.err == -1) {
+                ret.err = -1;
+                break;
+            }
+            T tmp[4];
+            auto units = (size_t)utf_detail::encode_one(0xfffd, tmp, swap_out);
+            if (capacity - ret.written < units) {
+                ret.err = -1;
+                break;
+            }
+            ::memcpy(dst + ret.written, tmp, units * sizeof(T));
+            ret.written += units;
+            report.add(ret.read);
+            ret.read += utf_detail::maximal_subpart(src + ret.read, size - ret.read);
+        }
+        return ret;
+    }
+}  // namespace PROJECT_NAME
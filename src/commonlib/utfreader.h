@@ -7,9 +7,63 @@
 
 #pragma once
 #include <memory>
+#include <vector>
 
+#include "utf_bulk.h"
 #include "utf_helper.h"
 namespace PROJECT_NAME {
+    template <class T, class = void>
+    struct is_contiguous_buf : std::is_pointer<T> {};
+
+    template <class T>
+    struct is_contiguous_buf<T, std::void_t<decltype(std::declval<T&>().data()), decltype(std::declval<T&>().size())>>
+        : std::true_type {};
+
+    template <class T, class = void>
+    struct is_resizable_buf : std::false_type {};
+
+    template <class T>
+    struct is_resizable_buf<T, std::void_t<decltype(std::declval<T&>().resize(0)), decltype(*std::declval<T&>().data() = 0)>>
+        : std::true_type {};
+
+    template <class C>
+    C* contiguous_data(C* p) {
+        return p;
+    }
+
+    template <class T>
+    auto contiguous_data(T& t) -> decltype(t.data()) {
+        return t.data();
+    }
+
+    //count units in to_size bytes of whole contiguous buffer of r by utf_bulk.h.
+    //returns false if buffer is not contiguous or not strictly valid (unit-wise decoders decide then)
+    template <class Buf>
+    std::enable_if_t<is_contiguous_buf<remove_cv_ref<Buf>>::value, bool>
+    bulk_count(Reader<Buf>& r, size_t to_size, size_t& count) {
+        r.seek(0);
+        auto src = contiguous_data(r.ref());
+        auto size = r.readable();
+        constexpr auto unit = sizeof(*src);
+        if CONSTEXPRIF (unit == 1) {
+            Sized<const char> in((const char*)src, size);
+            if (utf8_validate(in).err) return false;
+            count = utf_length(in, to_size);
+        }
+        else {
+            using C = std::conditional_t<unit == 2, char16_t, char32_t>;
+            if (utf_detail::transcode_scalar((const C*)src, size, (char32_t*)nullptr).err) return false;
+            count = utf_length(Sized<const C>((const C*)src, size), to_size);
+        }
+        return true;
+    }
+
+    template <class Buf>
+    std::enable_if_t<!is_contiguous_buf<remove_cv_ref<Buf>>::value, bool>
+    bulk_count(Reader<Buf>&, size_t, size_t&) {
+        return false;
+    }
+
 
     template <class Buf>
     struct ToUTF32_impl {
@@ -29,18 +83,58 @@ namespace PROJECT_NAME {
             return c;
         }
 
+        //optional checkpoint index: checkpoint[k] is the byte offset of code point k*interval.
+        //filled incrementally whenever decoding walks past the indexed frontier
+        size_t interval = 0;
+        mutable std::vector<size_t> checkpoint;
+        mutable size_t indexed = 0;
+        mutable size_t frontier = 0;
+
+        void set_index(size_t k) {
+            interval = k;
+            checkpoint.clear();
+            indexed = 0;
+            frontier = 0;
+        }
+
+        template <class Func>
+        char32_t step(Func func, size_t cur) const {
+            auto extend = interval && cur == indexed;
+            if (extend && cur % interval == 0) {
+                checkpoint.push_back(r.readpos());
+            }
+            auto c = get_achar(func);
+            if (extend && !err) {
+                indexed++;
+                frontier = r.readpos();
+            }
+            return c;
+        }
+
         template <class Func>
         size_t count(Func func) const {
-            r.seek(0);
             size_t c = 0;
+            if (!interval && bulk_count(r, 4, c)) {
+                r.seek(0);
+                prev = 0;
+                return c;
+            }
+            if (interval) {
+                r.seek(frontier);
+                c = indexed;
+            }
+            else {
+                r.seek(0);
+            }
             while (!r.ceof()) {
-                get_achar(func);
+                step(func, c);
                 if (err) {
                     return 0;
                 }
                 c++;
             }
-            //r.seek(pos);
+            r.seek(0);
+            prev = 0;
             return c;
         }
 
@@ -56,16 +150,50 @@ namespace PROJECT_NAME {
             return true;
         }
 
+        //reader is positioned at the head of code point prev (or prev-1 is chache)
+        template <class Func>
+        char32_t get_indexed(Func func, size_t pos) const {
+            auto cur = prev;
+            if (pos < indexed) {
+                auto base = pos / interval * interval;
+                if (cur > pos || cur < base) {
+                    r.seek(checkpoint[pos / interval]);
+                    cur = base;
+                }
+            }
+            else if (cur < indexed) {
+                r.seek(frontier);
+                cur = indexed;
+            }
+            for (; cur < pos && !r.ceof(); cur++) {
+                step(func, cur);
+                if (err) return char32_t();
+            }
+            if (r.ceof()) {
+                //pos is past the end. rewind so that the reader is at the head of prev again
+                r.seek(0);
+                prev = 0;
+                return char32_t();
+            }
+            chache = step(func, pos);
+            if (err) return char32_t();
+            prev = pos + 1;
+            return chache;
+        }
+
         template <class Func1, class Func2>
         char32_t get_position(Func1 func1, Func2 func2, size_t pos) const {
             if (prev - 1 == pos) {
                 return chache;
             }
+            if (interval) {
+                return get_indexed(func2, pos);
+            }
             if (pos < prev) {
                 seekminus(func1, static_cast<long long>(pos - prev - 1));
             }
             else {
-                for (auto i = prev; i < pos - prev; i++) {
+                for (auto i = prev; i < pos; i++) {
                     get_achar(func2);
                     if (err) return char32_t();
                 }
@@ -76,12 +204,11 @@ namespace PROJECT_NAME {
             return chache;
         }
 
-        size_t reset() {
+        template <class Func>
+        size_t reset(Func func) {
             err = false;
-            r.seek(0);
-            auto ret = count();
-            r.seek(0);
-            return ret;
+            set_index(interval);
+            return count(func);
         }
 
         Buf& ref() {
@@ -104,6 +231,10 @@ namespace PROJECT_NAME {
             err = in.err;
             chache = in.chache;
             prev = in.prev;
+            interval = in.interval;
+            checkpoint = in.checkpoint;
+            indexed = in.indexed;
+            frontier = in.frontier;
         }
 
         void move(ToUTF32_impl&& in) noexcept {
@@ -114,6 +245,11 @@ namespace PROJECT_NAME {
             in.chache = 0;
             prev = in.prev;
             in.prev = 0;
+            interval = in.interval;
+            checkpoint = std::move(in.checkpoint);
+            indexed = in.indexed;
+            frontier = in.frontier;
+            in.set_index(0);
         }
     };
 
@@ -182,6 +318,13 @@ namespace PROJECT_NAME {
         template <class Func>
         size_t count(Func func) {
             size_t c = 0;
+            if (bulk_count(r, sizeof(to_type), c)) {
+                r.seek(0);
+                ofs = 0;
+                minbuf.reset();
+                increment(func);
+                return err ? 0 : c;
+            }
             while (!r.ceof()) {
                 if (!increment(func)) break;
                 c += minbuf.size();
@@ -270,72 +413,97 @@ namespace PROJECT_NAME {
         }
     };
 
-#define DEFINE_UTF_TEMPLATE_TO32(NAME, SIZE, DECR, INCR)                       \
-    template <class Buf>                                                       \
-    struct NAME<Buf, SIZE> {                                                   \
-       private:                                                                \
-        ToUTF32_impl<Buf> impl;                                                \
-        size_t _size = 0;                                                      \
-                                                                               \
-       public:                                                                 \
-        NAME() {                                                               \
-            _size = impl.count(INCR);                                          \
-        }                                                                      \
-                                                                               \
-        NAME(Buf&& in) : impl(std::forward<Buf>(in)) {                         \
-            _size = impl.count(INCR);                                          \
-        }                                                                      \
-                                                                               \
-        NAME(const Buf& in) : impl(in) {                                       \
-            _size = impl.count(INCR);                                          \
-        }                                                                      \
-                                                                               \
-        NAME(const ToUTF32& in) {                                              \
-            _size = in._size;                                                  \
-            impl.copy(in.impl);                                                \
-        }                                                                      \
-                                                                               \
-        NAME(ToUTF32&& in)                                                     \
-        noexcept {                                                             \
-            _size = in._size;                                                  \
-            impl.move(std::forward<ToUTF32_impl<Buf>>(in.impl));               \
-            in._size = 0;                                                      \
-        }                                                                      \
-                                                                               \
-        char32_t operator[](size_t s) const {                                  \
-            if (impl.err) return char32_t();                                   \
-            return _size <= s ? char32_t() : impl.get_position(DECR, INCR, s); \
-        }                                                                      \
-                                                                               \
-        size_t size() const {                                                  \
-            return _size;                                                      \
-        }                                                                      \
-                                                                               \
-        Buf* operator->() const {                                              \
-            return std::addressof(impl.ref());                                 \
-        }                                                                      \
-                                                                               \
-        bool reset(size_t pos = 0) {                                           \
-            _size = impl.reset(pos);                                           \
-            return impl.err;                                                   \
-        }                                                                      \
-                                                                               \
-        Reader<Buf>& base_reader() {                                           \
-            return impl.base_reader();                                         \
-        }                                                                      \
-                                                                               \
-        NAME& operator=(const NAME& in) {                                      \
-            _size = in._size;                                                  \
-            impl.copy(in.impl);                                                \
-            return *this;                                                      \
-        }                                                                      \
-                                                                               \
-        NAME& operator=(NAME&& in) noexcept {                                  \
-            _size = in._size;                                                  \
-            in._size = 0;                                                      \
-            impl.move(std::forward<ToUTF32_impl>(in.impl));                    \
-            return *this;                                                      \
-        }                                                                      \
+#define DEFINE_UTF_TEMPLATE_TO32(NAME, SIZE, DECR, INCR)                        \
+    template <class Buf>                                                        \
+    struct NAME<Buf, SIZE> {                                                    \
+       private:                                                                 \
+        ToUTF32_impl<Buf> impl;                                                 \
+        mutable size_t _size = 0;                                               \
+        static constexpr size_t unknown = ~size_t(0);                           \
+                                                                                \
+       public:                                                                  \
+        NAME() {                                                                \
+            _size = impl.count(INCR);                                           \
+        }                                                                       \
+                                                                                \
+        NAME(Buf&& in) : impl(std::forward<Buf>(in)) {                          \
+            _size = impl.count(INCR);                                           \
+        }                                                                       \
+                                                                                \
+        NAME(const Buf& in) : impl(in) {                                        \
+            _size = impl.count(INCR);                                           \
+        }                                                                       \
+                                                                                \
+        /*index every interval code points. size is counted on first use*/      \
+        NAME(Buf&& in, size_t interval) : impl(std::forward<Buf>(in)) {         \
+            impl.set_index(interval);                                           \
+            _size = interval ? unknown : impl.count(INCR);                      \
+        }                                                                       \
+                                                                                \
+        NAME(const Buf& in, size_t interval) : impl(in) {                       \
+            impl.set_index(interval);                                           \
+            _size = interval ? unknown : impl.count(INCR);                      \
+        }                                                                       \
+                                                                                \
+        NAME(const ToUTF32& in) {                                               \
+            _size = in._size;                                                   \
+            impl.copy(in.impl);                                                 \
+        }                                                                       \
+                                                                                \
+        NAME(ToUTF32&& in)                                                      \
+        noexcept {                                                              \
+            _size = in._size;                                                   \
+            impl.move(std::forward<ToUTF32_impl<Buf>>(in.impl));                \
+            in._size = 0;                                                       \
+        }                                                                       \
+                                                                                \
+        char32_t operator[](size_t s) const {                                   \
+            if (impl.err) return char32_t();                                    \
+            return _size <= s ? char32_t() : impl.get_position(DECR, INCR, s);  \
+        }                                                                       \
+                                                                                \
+        size_t size() const {                                                   \
+            if (_size == unknown) {                                             \
+                _size = impl.count(INCR);                                       \
+            }                                                                   \
+            return _size;                                                       \
+        }                                                                       \
+                                                                                \
+        bool index_every(size_t interval) {                                     \
+            impl.set_index(interval);                                           \
+            _size = impl.count(INCR);                                           \
+            return !impl.err;                                                   \
+        }                                                                       \
+                                                                                \
+        size_t indexed() const {                                                \
+            return impl.indexed;                                                \
+        }                                                                       \
+                                                                                \
+        Buf* operator->() const {                                               \
+            return std::addressof(impl.ref());                                  \
+        }                                                                       \
+                                                                                \
+        bool reset() {                                                          \
+            _size = impl.reset(INCR);                                           \
+            return impl.err;                                                    \
+        }                                                                       \
+                                                                                \
+        Reader<Buf>& base_reader() {                                            \
+            return impl.base_reader();                                          \
+        }                                                                       \
+                                                                                \
+        NAME& operator=(const NAME& in) {                                       \
+            _size = in._size;                                                   \
+            impl.copy(in.impl);                                                 \
+            return *this;                                                       \
+        }                                                                       \
+                                                                                \
+        NAME& operator=(NAME&& in) noexcept {                                   \
+            _size = in._size;                                                   \
+            in._size = 0;                                                       \
+            impl.move(std::forward<ToUTF32_impl>(in.impl));                     \
+            return *this;                                                       \
+        }                                                                       \
     }
 
 #define DEFINE_UTF_TEMPLATE(NAME, SIZE, INCR, DECR, MINBUF)                     \
@@ -1,52 +1,560 @@
+#include <channel.h>
 #include <fileio.h>
+#include <utf_bulk.h>
+
+#include <atomic>
+#include <thread>
 
 #include "common.h"
 using namespace commonlib2;
 
-bool read_as_utf8bom(Reader<FileReader>& r) {
-    Reader<ToUTF32<FileReader>> u8(std::move(r.ref()));
-    if (u8.ref().size() == 0) {
-        Clog << "warning:expected UTF-8 BOM but not decodable\n";
-        r.ref() = std::move(u8.ref().base_reader().ref());
-        return false;
+enum class UTFForm {
+    utf8,
+    utf16le,
+    utf16be,
+    utf32le,
+    utf32be,
+};
+
+struct FormInfo {
+    const char* name;
+    size_t unit;
+    bool big_endian;
+    const char* bom;
+    size_t bomsize;
+};
+
+constexpr FormInfo form_info[] = {
+    {"utf8", 1, false, "\xEF\xBB\xBF", 3},
+    {"utf16le", 2, false, "\xFF\xFE", 2},
+    {"utf16be", 2, true, "\xFE\xFF", 2},
+    {"utf32le", 4, false, "\xFF\xFE\x00\x00", 4},
+    {"utf32be", 4, true, "\x00\x00\xFE\xFF", 4},
+};
+
+const FormInfo& info(UTFForm form) {
+    return form_info[(int)form];
+}
+
+bool parse_form(const std::string& name, UTFForm& form) {
+    for (size_t i = 0; i < sizeof(form_info) / sizeof(form_info[0]); i++) {
+        if (name == form_info[i].name) {
+            form = (UTFForm)i;
+            return true;
+        }
     }
-    u8.increment();
+    Clog << "error:unknown encoding " << name << "\n";
+    return false;
 }
 
-template <class T>
-bool read_as_utfwithbom(Reader<FileReader>& r, bool be, const char* utf) {
-    Reader<Order<FileReader, T>> u(std::move(r.ref()));
-    if (u.ref().size() == 0) {
-        Clog << "warning:expected"
-             << utf
-             << "BOM(" << (be ? "BE" : "LE")
-             << ") but not decodable\n";
-        r.ref() = std::move(u.ref().ref());
-        return false;
+//utf32le is checked before utf16le because its BOM starts with utf16le's
+bool detect_bom(const char* p, size_t size, UTFForm& form) {
+    for (auto f : {UTFForm::utf32le, UTFForm::utf32be, UTFForm::utf8, UTFForm::utf16le, UTFForm::utf16be}) {
+        auto& fi = info(f);
+        if (size >= fi.bomsize && ::memcmp(p, fi.bom, fi.bomsize) == 0) {
+            form = f;
+            return true;
+        }
     }
-    if CONSTEXPRIF (is_big_endian()) {
-        if (be) u.ref().set_reverse(true);
+    return false;
+}
+
+//length of p which ends on a code point boundary. the rest is carried to next chunk
+size_t complete_prefix(const char* p, size_t size, UTFForm form) {
+    auto& fi = info(form);
+    size -= size % fi.unit;
+    if (fi.unit == 1) {
+        for (size_t back = 1; back <= 4 && back <= size; back++) {
+            auto c = (unsigned char)p[size - back];
+            if ((c & 0xc0) == 0x80) continue;
+            size_t len = (c & 0xe0) == 0xc0 ? 2 : (c & 0xf0) == 0xe0 ? 3 : (c & 0xf8) == 0xf0 ? 4 : 1;
+            return len > back ? size - back : size;
+        }
     }
-    else {
-        if (!be) u.ref().set_reverse(true);
+    else if (fi.unit == 2 && size >= 2) {
+        //do not split surrogate pair
+        auto high = (unsigned char)p[size - (fi.big_endian ? 2 : 1)];
+        if ((high & 0xfc) == 0xd8) {
+            return size - 2;
+        }
     }
-    if CONSTEXPRIF (sizeof(T)) {
-        u.increment();
+    return size;
+}
+
+void swap_utf32(char32_t* dst, const char32_t* src, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        dst[i] = utf_detail::swap32(src[i]);
     }
-    else {
+}
+
+struct ChunkEncoder {
+    UTFForm from, to;
+    std::vector<char> out;
+    std::vector<char32_t> wide;
+    //replace invalid sequences with U+FFFD instead of stopping if set
+    UTFErrorReport* report = nullptr;
+
+    ChunkEncoder(UTFForm from, UTFForm to, size_t maxsize)
+        : from(from), to(to) {
+        //4 bytes per input unit covers every pair including utf-16 through utf-32
+        auto units = maxsize / info(from).unit + 1;
+        out.resize(units * 4);
+        wide.resize(units);
+    }
+
+    //transcode code points in p (size is a multiple of unit). result is [outp,outp+outsize) which may point into p
+    UTFResult run(const char* p, size_t size, const char*& outp, size_t& outsize) {
+        auto& fi = info(from);
+        auto& ti = info(to);
+        auto swap_in = utf16_swap(fi.big_endian), swap_out = utf16_swap(ti.big_endian);
+        auto units = size / fi.unit;
+        auto src32 = (const char32_t*)p;
+        if (fi.unit == 4 && swap_in) {
+            swap_utf32(wide.data(), src32, units);
+            src32 = wide.data();
+        }
+        Sized<const char> in8(p, units);
+        Sized<const char16_t> in16((const char16_t*)p, units);
+        Sized<const char32_t> in32(src32, units);
+        Sized<char> out8(out.data(), out.size());
+        Sized<char16_t> out16((char16_t*)out.data(), out.size() / 2);
+        Sized<char32_t> out32((char32_t*)out.data(), out.size() / 4);
+        UTFResult res;
+        outp = out.data();
+        if (report) {
+            res = replace(p, src32, units, fi.unit == 2 && swap_in, ti.unit == 2 && swap_out);
+        }
+        else if (fi.unit == 1) {
+            if (ti.unit == 1) {
+                res = utf8_validate(in8);
+                res.written = res.read;
+                outp = p;
+            }
+            else if (ti.unit == 2) {
+                res = utf8_to_utf16(in8, out16, swap_out);
+            }
+            else {
+                res = utf8_to_utf32(in8, out32);
+            }
+        }
+        else if (fi.unit == 2) {
+            if (ti.unit == 1) {
+                res = utf16_to_utf8(in16, out8, swap_in);
+            }
+            else if (ti.unit == 2) {
+                res = utf16_to_utf32(in16, Sized<char32_t>(wide.data(), wide.size()), swap_in);
+                if (swap_in == swap_out) {
+                    res.written = res.read;
+                    outp = p;
+                }
+                else {
+                    res.written = utf32_to_utf16(Sized<const char32_t>(wide.data(), res.written), out16, swap_out).written;
+                }
+            }
+            else {
+                res = utf16_to_utf32(in16, out32, swap_in);
+            }
+        }
+        else {
+            if (ti.unit == 1) {
+                res = utf32_to_utf8(in32, out8);
+            }
+            else if (ti.unit == 2) {
+                res = utf32_to_utf16(in32, out16, swap_out);
+            }
+            else {
+                for (; res.read < units; res.read++) {
+                    auto c = src32[res.read];
+                    if (c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) {
+                        res.err = 12;
+                        break;
+                    }
+                }
+                res.written = res.read;
+                if (swap_in == swap_out) {
+                    outp = p;
+                }
+                else if (swap_out) {
+                    swap_utf32((char32_t*)out.data(), src32, res.written);
+                }
+                else {
+                    ::memcpy(out.data(), src32, res.written * 4);
+                }
+                outsize = res.written * ti.unit;
+                return res;
+            }
+        }
+        if (ti.unit == 4 && swap_out) {
+            swap_utf32((char32_t*)out.data(), (const char32_t*)out.data(), res.written);
+        }
+        outsize = res.written * ti.unit;
+        return res;
+    }
+
+    template <class From>
+    UTFResult replace(const From* in, size_t units, bool swap_in, bool swap_out) {
+        auto& ti = info(to);
+        if (ti.unit == 1) {
+            return utf_transcode_replace(in, units, out.data(), out.size(), *report, swap_in, swap_out);
+        }
+        if (ti.unit == 2) {
+            return utf_transcode_replace(in, units, (char16_t*)out.data(), out.size() / 2, *report, swap_in, swap_out);
+        }
+        return utf_transcode_replace(in, units, (char32_t*)out.data(), out.size() / 4, *report, swap_in, swap_out);
+    }
+
+    UTFResult replace(const char* p, const char32_t* src32, size_t units, bool swap_in, bool swap_out) {
+        auto unit = info(from).unit;
+        return unit == 1   ? replace(p, units, swap_in, swap_out)
+               : unit == 2 ? replace((const char16_t*)p, units, swap_in, swap_out)
+                           : replace(src32, units, swap_in, swap_out);
+    }
+
+    //U+FFFD in output form for a code unit cut by end of input
+    size_t replacement(char* buf) {
+        auto& ti = info(to);
+        char32_t c = 0xfffd;
+        if (ti.unit == 1) {
+            return utf_detail::encode_one(c, buf, false);
+        }
+        if (ti.unit == 2) {
+            char16_t tmp;
+            utf_detail::encode_one(c, &tmp, utf16_swap(ti.big_endian));
+            ::memcpy(buf, &tmp, 2);
+            return 2;
+        }
+        if (utf16_swap(ti.big_endian)) {
+            c = utf_detail::swap32(c);
+        }
+        ::memcpy(buf, &c, 4);
+        return 4;
+    }
+};
+
+FILE* open_file(const std::string& name, bool write) {
+    FILE* fp = nullptr;
+#ifdef _WIN32
+    std::wstring path;
+    Reader(name) >> path;
+    _wfopen_s(&fp, path.c_str(), write ? L"wb" : L"rb");
+#else
+    fp = ::fopen(name.c_str(), write ? "wb" : "rb");
+#endif
+    return fp;
+}
+
+struct Chunk {
+    size_t index = 0;
+    size_t size = 0;
+};
+
+//read ahead on another thread into two fixed buffers while the caller transcodes and writes the other
+int encode_stream(FILE* in, FILE* out, UTFForm from, UTFForm to, bool given, bool bom, UTFErrorReport* report,
+                  const std::string& outname) {
+    constexpr size_t chunk_size = 1 << 20, head = 16;
+    std::vector<char> bufs[2];
+    for (auto& buf : bufs) {
+        buf.resize(head + chunk_size);
+    }
+    SendChan<size_t> free_w;
+    RecvChan<size_t> free_r;
+    SendChan<Chunk> fill_w;
+    RecvChan<Chunk> fill_r;
+    std::tie(free_w, free_r) = make_chan<size_t>();
+    std::tie(fill_w, fill_r) = make_chan<Chunk>();
+    free_r.set_block(true);
+    fill_r.set_block(true);
+    free_w << 0;
+    free_w << 1;
+    std::thread reader([&] {
+        size_t index = 0;
+        while (free_r >> index) {
+            Chunk chunk;
+            chunk.index = index;
+            chunk.size = ::fread(bufs[index].data() + head, 1, chunk_size, in);
+            auto eof = chunk.size == 0;
+            fill_w << std::move(chunk);
+            if (eof) break;
+        }
+    });
+    std::unique_ptr<ChunkEncoder> enc;
+    char carrybuf[head];
+    size_t carry = 0, offset = 0;
+    int ret = 0;
+    auto fail = [&](auto&&... msg) {
+        (Clog << ... << msg);
+        ret = -1;
+    };
+    while (ret == 0) {
+        Chunk chunk;
+        fill_r >> chunk;
+        auto eof = chunk.size == 0;
+        if (eof && ::ferror(in)) {
+            fail("error:failed to read input\n");
+            break;
+        }
+        auto p = bufs[chunk.index].data() + head - carry;
+        ::memcpy(p, carrybuf, carry);
+        auto size = carry + chunk.size;
+        if (!enc) {
+            UTFForm detected = UTFForm::utf8;
+            if (detect_bom(p, size, detected) && (!given || detected == from)) {
+                from = detected;
+                p += info(from).bomsize;
+                size -= info(from).bomsize;
+                offset += info(from).bomsize;
+            }
+            enc = std::make_unique<ChunkEncoder>(from, to, chunk_size + head);
+            enc->report = report;
+            if (bom && ::fwrite(info(to).bom, 1, info(to).bomsize, out) != info(to).bomsize) {
+                fail("error:failed to write ", outname, "\n");
+                break;
+            }
+        }
+        auto unit = info(from).unit, cut = eof ? size % unit : 0;
+        if (cut && !report) {
+            fail("error:input ends in the middle of ", info(from).name, " code unit\n");
+            break;
+        }
+        auto complete = eof ? size - cut : complete_prefix(p, size, from);
+        carry = size - complete;
+        ::memcpy(carrybuf, p + complete, carry);
+        if ((size_t)p % unit) {
+            //only after a short read. realign to unit for transcoders
+            ::memmove(bufs[chunk.index].data(), p, complete);
+            p = bufs[chunk.index].data();
+        }
+        const char* outp = nullptr;
+        size_t outsize = 0;
+        if (report) {
+            report->base = offset / unit;
+        }
+        auto res = enc->run(p, complete, outp, outsize);
+        if (outsize && ::fwrite(outp, 1, outsize, out) != outsize) {
+            fail("error:failed to write ", outname, "\n");
+            break;
+        }
+        if (cut) {
+            char rep[4];
+            auto repsize = enc->replacement(rep);
+            report->add(complete / unit);
+            if (::fwrite(rep, 1, repsize, out) != repsize) {
+                fail("error:failed to write ", outname, "\n");
+                break;
+            }
+        }
+        if (res.err) {
+            fail("error:invalid ", info(from).name, " sequence at offset ", offset + res.read * unit, "\n");
+            break;
+        }
+        offset += complete;
+        if (eof) break;
+        free_w << std::move(chunk.index);
+    }
+    free_w.close();
+    reader.join();
+    if (report) {
+        print_replace_report(*report, info(from).unit);
+    }
+    return ret;
+}
+
+//first position at or after pos where decoding can restart: not a utf-8 continuation byte nor a low surrogate
+size_t sync_point(const char* p, size_t size, size_t pos, UTFForm form) {
+    auto& fi = info(form);
+    pos -= pos % fi.unit;
+    if (fi.unit == 1) {
+        for (auto i = 0; i < 3 && pos < size && ((unsigned char)p[pos] & 0xc0) == 0x80; i++) {
+            pos++;
+        }
+    }
+    else if (fi.unit == 2 && pos + 2 <= size) {
+        auto high = (unsigned char)p[pos + (fi.big_endian ? 0 : 1)];
+        if ((high & 0xfc) == 0xdc) {
+            pos += 2;
+        }
+    }
+    return pos < size ? pos : size;
+}
+
+bool write_at(FILE* fp, const char* p, size_t size, size_t offset) {
+#ifdef _WIN32
+    auto h = (HANDLE)_get_osfhandle(_fileno(fp));
+    while (size) {
+        OVERLAPPED ov{};
+        ov.Offset = (DWORD)offset;
+        ov.OffsetHigh = (DWORD)((std::uint64_t)offset >> 32);
+        DWORD len = 0, req = (DWORD)(size < (1 << 30) ? size : (1 << 30));
+        if (!WriteFile(h, p, req, &len, &ov) || len == 0) return false;
+#else
+    while (size) {
+        auto len = ::pwrite(fileno(fp), p, size, (off_t)offset);
+        if (len <= 0) return false;
+#endif
+        p += len;
+        size -= len;
+        offset += len;
+    }
+    return true;
+}
+
+bool resize_file(FILE* fp, size_t size) {
+#ifdef _WIN32
+    return _chsize_s(_fileno(fp), (long long)size) == 0;
+#else
+    return ::ftruncate(fileno(fp), (off_t)size) == 0;
+#endif
+}
+
+//run job(index, state) for index in [0,count) on threads. each thread owns a state made by make()
+template <class Make, class Job>
+void run_jobs(size_t threads, size_t count, Make&& make, Job&& job) {
+    std::atomic_size_t next = 0;
+    auto worker = [&] {
+        auto state = make();
+        for (size_t i = next++; i < count; i = next++) {
+            job(i, state);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads && i < count; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : pool) {
+        t.join();
     }
 }
 
-int file_encoder(int argc, char** argv) {
-    int i = 2;
-    bool ok = false;
-    std::string expects;
-    std::string input, output;
+struct ParallelJob {
+    size_t begin = 0, end = 0;
+    size_t offset = 0, count = 0;
+    bool failed = false, ioerr = false;
+    size_t errpos = 0, written = 0;
+};
+
+//split mapped input at sync points, count output per chunk, prefix sum into offsets, then write chunks in place.
+//output and error report are the same as encode_stream
+int encode_parallel(const FileMap& map, FILE* out, UTFForm from, UTFForm to, bool given, bool bom,
+                    size_t threads, const std::string& outname) {
+    constexpr size_t min_chunk = 1 << 20, block = 1 << 20;
+    auto p = map.c_str();
+    size_t size = map.size(), head = 0;
+    UTFForm detected = UTFForm::utf8;
+    if (detect_bom(p, size, detected) && (!given || detected == from)) {
+        from = detected;
+        head = info(from).bomsize;
+    }
+    auto& fi = info(from);
+    auto& ti = info(to);
+    auto swap_in = utf16_swap(fi.big_endian);
+    auto data = p + head;
+    auto datasize = size - head, tail = datasize % fi.unit;
+    datasize -= tail;
+    auto count = datasize / min_chunk + 1;
+    if (count > threads * 4) {
+        count = threads * 4;
+    }
+    std::vector<ParallelJob> jobs(count);
+    for (size_t i = 0; i < count; i++) {
+        jobs[i].begin = i ? jobs[i - 1].end : 0;
+        jobs[i].end = i + 1 == count ? datasize : sync_point(data, datasize, datasize / count * (i + 1), from);
+        if (jobs[i].end < jobs[i].begin) {
+            jobs[i].end = jobs[i].begin;
+        }
+    }
+    auto nostate = [] { return 0; };
+    run_jobs(threads, count, nostate, [&](size_t i, int) {
+        auto& job = jobs[i];
+        auto units = (job.end - job.begin) / fi.unit;
+        auto begin = data + job.begin;
+        if (fi.unit == 1) {
+            job.count = utf_length(Sized<const char>(begin, units), ti.unit);
+        }
+        else if (fi.unit == 2) {
+            job.count = utf_length(Sized<const char16_t>((const char16_t*)begin, units), ti.unit, swap_in);
+        }
+        else {
+            job.count = utf_length(Sized<const char32_t>((const char32_t*)begin, units), ti.unit, swap_in);
+        }
+        job.count *= ti.unit;
+    });
+    size_t total = bom ? ti.bomsize : 0;
+    for (auto& job : jobs) {
+        job.offset = total;
+        total += job.count;
+    }
+    if (!resize_file(out, total) || (bom && !write_at(out, ti.bom, ti.bomsize, 0))) {
+        Clog << "error:failed to write " << outname << "\n";
+        return -1;
+    }
+    std::atomic_size_t first_failed = count;
+    auto make_encoder = [&] { return std::make_unique<ChunkEncoder>(from, to, block + 4); };
+    run_jobs(threads, count, make_encoder, [&](size_t i, std::unique_ptr<ChunkEncoder>& enc) {
+        auto& job = jobs[i];
+        if (i > first_failed) return;
+        for (auto pos = job.begin; pos < job.end;) {
+            auto end = pos + block < job.end ? sync_point(data, job.end, pos + block, from) : job.end;
+            const char* outp = nullptr;
+            size_t outsize = 0;
+            auto res = enc->run(data + pos, end - pos, outp, outsize);
+            if (outsize && !write_at(out, outp, outsize, job.offset + job.written)) {
+                job.ioerr = true;
+            }
+            job.written += outsize;
+            if (res.err || job.ioerr) {
+                job.failed = true;
+                job.errpos = pos + res.read * fi.unit;
+                for (auto cur = first_failed.load(); i < cur && !first_failed.compare_exchange_weak(cur, i);) {
+                }
+                return;
+            }
+            pos = end;
+        }
+    });
+    for (auto& job : jobs) {
+        if (!job.failed) continue;
+        if (job.ioerr) {
+            Clog << "error:failed to write " << outname << "\n";
+            return -1;
+        }
+        resize_file(out, job.offset + job.written);
+        Clog << "error:invalid " << fi.name << " sequence at offset " << head + job.errpos << "\n";
+        return -1;
+    }
+    if (tail) {
+        Clog << "error:input ends in the middle of " << fi.name << " code unit\n";
+        return -1;
+    }
+    return 0;
+}
+
+int file_encoder(int argc, char** argv, int i) {
+    bool given = false, bom = false, lossy = false;
+    size_t threads = 1;
+    UTFForm from = UTFForm::utf8, to = UTFForm::utf8;
+    std::string input, output, tmp;
     for (; i < argc; i++) {
         if (argv[i][0] == '-') {
             for (auto&& c : std::string_view(argv[i]).substr(1)) {
-                if (!expects.size() && c == 'e') {
-                    if (!get_morearg(expects, i, argc, argv)) {
+                if (c == 'e' || c == 't') {
+                    if (!get_morearg(tmp, i, argc, argv)) {
+                        return -1;
+                    }
+                    if (!parse_form(tmp, c == 'e' ? from : to)) {
+                        return -1;
+                    }
+                    given = given || c == 'e';
+                    tmp.clear();
+                }
+                else if (c == 'b') {
+                    bom = true;
+                }
+                else if (c == 'l') {
+                    lossy = true;
+                }
+                else if (c == 'j') {
+                    if (!get_threads(threads, i, argc, argv)) {
                         return -1;
                     }
                 }
@@ -66,23 +574,146 @@ int file_encoder(int argc, char** argv) {
         }
         break;
     }
+    if (!input.size() || !output.size()) {
+        Clog << "error:need <input> and <output>\n";
+        return -1;
+    }
+    if (lossy && threads > 1) {
+        //replacements change output size so chunk offsets can not be counted ahead
+        Clog << "warning:-j is ignored with -l\n";
+        threads = 1;
+    }
+    std::unique_ptr<FileMap> map;
+    FILE* in = nullptr;
+    if (threads > 1) {
 #ifdef _WIN32
-    std::wstring tmp;
+        std::wstring path;
+        Reader(input) >> path;
+        map = std::make_unique<FileMap>(path.c_str());
 #else
-    std::string tmp;
+        map = std::make_unique<FileMap>(input.c_str());
 #endif
-    Reader(input) >> tmp;
-    Reader<FileReader> r(tmp.c_str());
-    if (!r.ref().is_open()) {
+    }
+    else {
+        in = open_file(input, false);
+    }
+    if (map ? !map->is_open() : !in) {
         Clog << "error:file " << input << " couldn't open\n";
         return -1;
     }
-    if (r.ahead("\xEF\xBB\xBF")) {
-        if (read_as_utf8bom(r)) {
-            return 0;
+    auto out = open_file(output, true);
+    if (!out) {
+        if (in) ::fclose(in);
+        Clog << "error:file " << output << " couldn't open\n";
+        return -1;
+    }
+    UTFErrorReport report;
+    auto ret = map ? encode_parallel(*map, out, from, to, given, bom, threads, output)
+                   : encode_stream(in, out, from, to, given, bom, lossy ? &report : nullptr, output);
+    if (in) ::fclose(in);
+    if (::fclose(out) != 0 && ret == 0) {
+        Clog << "error:failed to write " << output << "\n";
+        ret = -1;
+    }
+    return ret;
+}
+
+//count units of input in each form by blocks. input is not validated (see encode)
+int file_length(int argc, char** argv, int i) {
+    bool given = false;
+    UTFForm from = UTFForm::utf8;
+    std::string input, tmp;
+    for (; i < argc; i++) {
+        if (argv[i][0] == '-' && argv[i][1]) {
+            for (auto&& c : std::string_view(argv[i]).substr(1)) {
+                if (c == 'e') {
+                    if (!get_morearg(tmp, i, argc, argv)) {
+                        return -1;
+                    }
+                    if (!parse_form(tmp, from)) {
+                        return -1;
+                    }
+                    given = true;
+                    tmp.clear();
+                }
+                else {
+                    Clog << "warning: ignored '" << c << "'\n";
+                }
+            }
+            continue;
+        }
+        else if (!input.size()) {
+            input = argv[i];
+            continue;
+        }
+        break;
+    }
+    if (!input.size()) {
+        Clog << "error:need <input>\n";
+        return -1;
+    }
+    FILE* in = stdin;
+    if (input != "-") {
+        in = open_file(input, false);
+        if (!in) {
+            Clog << "error:file " << input << " couldn't open\n";
+            return -1;
+        }
+    }
+#ifdef _WIN32
+    else {
+        _setmode(_fileno(stdin), _O_BINARY);
+    }
+#endif
+    constexpr size_t block = 1 << 20;
+    std::vector<char32_t> buf(block / 4 + 1);
+    auto p = (char*)buf.data();
+    size_t carry = 0, count[3] = {0};
+    bool first = true;
+    while (true) {
+        auto size = carry + ::fread(p + carry, 1, block, in);
+        if (size == carry) break;
+        auto data = p;
+        if (first) {
+            UTFForm detected = UTFForm::utf8;
+            if (detect_bom(data, size, detected) && (!given || detected == from)) {
+                from = detected;
+                data += info(from).bomsize;
+                size -= info(from).bomsize;
+            }
+            first = false;
+        }
+        auto& fi = info(from);
+        auto swap = utf16_swap(fi.big_endian);
+        //counts are sums over units so blocks only have to keep units whole
+        auto units = size / fi.unit;
+        for (auto k = 0; k < 3; k++) {
+            size_t to = size_t(1) << k;
+            if (fi.unit == 1) {
+                count[k] += utf_length(Sized<const char>(data, units), to);
+            }
+            else if (fi.unit == 2) {
+                count[k] += utf_length(Sized<const char16_t>((const char16_t*)data, units), to, swap);
+            }
+            else {
+                count[k] += utf_length(Sized<const char32_t>((const char32_t*)data, units), to, swap);
+            }
         }
+        carry = size - units * fi.unit;
+        ::memmove(p, data + units * fi.unit, carry);
     }
-    else if (r.ahead(Sized("\x00\x00\xfe\xff"))) {
+    auto err = ::ferror(in);
+    if (in != stdin) {
+        ::fclose(in);
     }
+    if (err) {
+        Clog << "error:failed to read input\n";
+        return -1;
+    }
+    if (carry) {
+        Clog << "error:input ends in the middle of " << info(from).name << " code unit\n";
+        return -1;
+    }
+    Cout << "utf8: " << count[0] << "\nutf16: " << count[1] << "\nutf32: " << count[2] << "\n";
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,124 @@
+#include <unicodedata.h>
+
+#include <cstdio>
+
+#include "common.h"
+
+using namespace commonlib2;
+
+struct GraphemeReport {
+    bool count = false;
+    bool separate = false;
+    std::string separator;
+};
+
+//report clusters of utf-8 from fp by blocks. state of the cluster machine is carried over blocks
+int graphemes_stream(const GraphemeTable &table, const GraphemeReport &report, FILE *fp) {
+    size_t total = 0, count = 0;
+    std::uint8_t state = grapheme_start;
+    if (!report.count && !report.separate) {
+        Cout << 0 << "\n";
+    }
+    auto ret = read_utf8_blocks(fp, [&](const char *in, size_t len, size_t offset, bool) {
+        if (!offset && len) {
+            count = 1;
+        }
+        size_t written = 0;
+        table.boundaries(state, in, len, [&](size_t at) {
+            count++;
+            if (report.separate) {
+                Cout.write(in + written, at - written);
+                Cout << report.separator;
+                written = at;
+            }
+            else if (!report.count) {
+                Cout << offset + at << "\n";
+            }
+        });
+        if (report.separate) {
+            Cout.write(in + written, len - written);
+        }
+        total = offset + len;
+        return len;
+    });
+    if (ret < 0) {
+        return ret;
+    }
+    if (report.count) {
+        Cout << count << "\n";
+    }
+    else if (!report.separate && total) {
+        Cout << total << "\n";
+    }
+    return 0;
+}
+
+void graphemes_word(const GraphemeTable &table, const GraphemeReport &report, const char *word, size_t size) {
+    if (report.count) {
+        Cout << table.count(word, size) << "\n";
+        return;
+    }
+    size_t begin = 0;
+    if (!report.separate) {
+        Cout << 0;
+    }
+    while (begin < size) {
+        auto end = table.next_boundary(word, size, begin);
+        if (report.separate) {
+            Cout.write(word + begin, end - begin);
+            if (end < size) {
+                Cout << report.separator;
+            }
+        }
+        else {
+            Cout << " " << end;
+        }
+        begin = end;
+    }
+    Cout << "\n";
+}
+
+int graphemes_text(int argc, char **argv, int i) {
+    TextOptions opt;
+    GraphemeReport report;
+    auto extra = [&](char c, int &i) {
+        if (!report.count && c == 'c') {
+            report.count = true;
+        }
+        else if (!report.separate && c == 's') {
+            if (!get_morearg(report.separator, i, argc, argv)) {
+                return -1;
+            }
+            report.separate = true;
+        }
+        else {
+            return 0;
+        }
+        return 1;
+    };
+    if (!parse_text_options(i, argc, argv, opt, extra)) {
+        return -1;
+    }
+    if (!opt.input.size() && i >= argc) {
+        Clog << "error: need more argument\n";
+        return -1;
+    }
+    if (report.count && report.separate) {
+        Clog << "warning: -s is ignored with -c\n";
+        report.separate = false;
+    }
+    const GraphemeTable *table = nullptr;
+    TextCommand cmd;
+    cmd.failure = "failed to build grapheme table";
+    cmd.load = [&](UnicodeData &data) {
+        table = &get_grapheme_table(data);
+        return table->built;
+    };
+    cmd.stream = [&](FILE *fp) {
+        return graphemes_stream(*table, report, fp);
+    };
+    cmd.word = [&](const char *str, size_t size) {
+        graphemes_word(*table, report, str, size);
+    };
+    return run_text_command(opt, i, argc, argv, cmd);
+}
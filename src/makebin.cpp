@@ -3,8 +3,32 @@
 #include "common.h"
 
 using namespace commonlib2;
+
+//load UCD text file by load and apply it to data by apply
+template <class Load, class Apply>
+bool apply_textfile(HUNICODEDATA data, const std::string &file, const char *what, Load &&load, Apply &&apply) {
+#ifdef _WIN32
+    std::wstring tmp;
+    Reader(file) >> tmp;
+    auto vec = load(tmp.c_str());
+#else
+    auto vec = load(file.c_str());
+#endif
+    if (!vec.size()) {
+        Clog << "error:failed to load " << what << " from " << file << "\n";
+        return false;
+    }
+    if (!apply(vec, *(UnicodeData *)data)) {
+        Clog << "error:failed to apply " << what << " from " << file << "\n";
+        return false;
+    }
+    return true;
+}
+
 int binarymake(int argc, char **argv, int i) {
-    std::string asianfile, txtfile, binfile, blockfile;
+    std::string asianfile, txtfile, binfile, blockfile, specialfile, foldingfile, graphemefile, emojifile, wordfile,
+        sentencefile, scriptfile, extensionfile;
+    int version = flat_version;
     for (; i < argc; i++) {
         std::string arg = argv[i];
         if (!asianfile.size() && arg == "-a") {
@@ -23,6 +47,83 @@ int binarymake(int argc, char **argv, int i) {
             }
             blockfile = argv[i];
         }
+        else if (!specialfile.size() && arg == "-s") {
+            i++;
+            if (i >= argc) {
+                Clog << "error:need file path\n";
+                return -1;
+            }
+            specialfile = argv[i];
+        }
+        else if (!foldingfile.size() && arg == "-f") {
+            i++;
+            if (i >= argc) {
+                Clog << "error:need file path\n";
+                return -1;
+            }
+            foldingfile = argv[i];
+        }
+        else if (!graphemefile.size() && arg == "-g") {
+            i++;
+            if (i >= argc) {
+                Clog << "error:need file path\n";
+                return -1;
+            }
+            graphemefile = argv[i];
+        }
+        else if (!emojifile.size() && arg == "-e") {
+            i++;
+            if (i >= argc) {
+                Clog << "error:need file path\n";
+                return -1;
+            }
+            emojifile = argv[i];
+        }
+        else if (!wordfile.size() && arg == "-w") {
+            i++;
+            if (i >= argc) {
+                Clog << "error:need file path\n";
+                return -1;
+            }
+            wordfile = argv[i];
+        }
+        else if (!sentencefile.size() && arg == "-n") {
+            i++;
+            if (i >= argc) {
+                Clog << "error:need file path\n";
+                return -1;
+            }
+            sentencefile = argv[i];
+        }
+        else if (!scriptfile.size() && arg == "-r") {
+            i++;
+            if (i >= argc) {
+                Clog << "error:need file path\n";
+                return -1;
+            }
+            scriptfile = argv[i];
+        }
+        else if (!extensionfile.size() && arg == "-x") {
+            i++;
+            if (i >= argc) {
+                Clog << "error:need file path\n";
+                return -1;
+            }
+            extensionfile = argv[i];
+        }
+        else if (arg == "-v") {
+            i++;
+            if (i >= argc) {
+                Clog << "error:need version number\n";
+                return -1;
+            }
+            version = -1;
+            Reader(argv[i]) >> version;
+            if (version < 1 || version > flat_version) {
+                Clog << "error:unsupported version " << argv[i] << "\n";
+                return -1;
+            }
+        }
         else if (!txtfile.size()) {
             txtfile = std::move(arg);
         }
@@ -49,52 +150,65 @@ int binarymake(int argc, char **argv, int i) {
         Clog << "error:failed to load unicodedata from " << txtfile << "\n";
         return -1;
     }
-    if (asianfile.size()) {
-#ifdef _WIN32
-        tmp = L"";
-        Reader(asianfile) >> tmp;
-        auto vec = load_EastAsianWide_text(tmp.c_str());
-#else
-        auto vec = load_EastAsianWide_text(asianfile.c_str());
-#endif
-        if (!vec.size()) {
-            Clog << "error:failed to load east asian wide from " << asianfile
-                 << "\n";
-            return -1;
-        }
-        if (!apply_east_asian_wide(vec, *(UnicodeData *)data)) {
-            Clog << "error:failed to apply east asian wide from " << asianfile
-                 << "\n";
-            return -1;
-        }
+    if (asianfile.size() &&
+        !apply_textfile(data, asianfile, "east asian wide", [](auto name) { return load_EastAsianWide_text(name); },
+                        apply_east_asian_wide)) {
+        return -1;
     }
-
-    if (blockfile.size()) {
-#ifdef _WIN32
-        tmp = L"";
-        Reader(blockfile) >> tmp;
-        auto vec = load_Blocks_text(tmp.c_str());
-#else
-        auto vec = load_Blocks_text(asianfile.c_str());
-#endif
-        if (!vec.size()) {
-            Clog << "error:failed to load block from " << blockfile
-                 << "\n";
-            return -1;
-        }
-        if (!apply_blockname(vec, *(UnicodeData *)data)) {
-            Clog << "error:failed to apply block from " << blockfile
-                 << "\n";
-            return -1;
-        }
+    if (blockfile.size() &&
+        !apply_textfile(data, blockfile, "block", [](auto name) { return load_Blocks_text(name); }, apply_blockname)) {
+        return -1;
+    }
+    if (specialfile.size() &&
+        !apply_textfile(data, specialfile, "special casing", [](auto name) { return load_SpecialCasing_text(name); },
+                        apply_special_casing)) {
+        return -1;
+    }
+    if (foldingfile.size() &&
+        !apply_textfile(data, foldingfile, "case folding", [](auto name) { return load_CaseFolding_text(name); },
+                        apply_case_folding)) {
+        return -1;
+    }
+    if (graphemefile.size() &&
+        !apply_textfile(data, graphemefile, "grapheme break property",
+                        [](auto name) { return load_GraphemeBreakProperty_text(name); }, apply_grapheme_break)) {
+        return -1;
+    }
+    if (emojifile.size() &&
+        !apply_textfile(data, emojifile, "emoji data", [](auto name) { return load_emoji_data_text(name); }, apply_emoji_data)) {
+        return -1;
+    }
+    if (wordfile.size() &&
+        !apply_textfile(data, wordfile, "word break property", [](auto name) { return load_WordBreakProperty_text(name); },
+                        apply_word_break)) {
+        return -1;
+    }
+    if (sentencefile.size() &&
+        !apply_textfile(data, sentencefile, "sentence break property",
+                        [](auto name) { return load_SentenceBreakProperty_text(name); }, apply_sentence_break)) {
+        return -1;
+    }
+    if (scriptfile.size() &&
+        !apply_textfile(data, scriptfile, "script", [](auto name) { return load_Scripts_text(name); }, apply_scripts)) {
+        return -1;
+    }
+    if (extensionfile.size() &&
+        !apply_textfile(data, extensionfile, "script extensions",
+                        [](auto name) { return load_ScriptExtensions_text(name); }, apply_script_extensions)) {
+        return -1;
+    }
+    if ((specialfile.size() || foldingfile.size() || graphemefile.size() || emojifile.size() || wordfile.size() ||
+         sentencefile.size() || scriptfile.size() || extensionfile.size()) &&
+        version < flat_version) {
+        Clog << "warning:case mappings, break properties and scripts are saved only in version " << flat_version << "\n";
     }
 
 #if _WIN32
-    tmp = L"";
+    std::wstring tmp;
     Reader(binfile) >> tmp;
-    if (!save_unicodedata_as_binaryW(data, tmp.c_str())) {
+    if (!save_unicodedata_as_binary_versionW(data, tmp.c_str(), version)) {
 #else
-    if (!save_unicodedata_as_binary(data, binfile.c_str())) {
+    if (!save_unicodedata_as_binary_version(data, binfile.c_str(), version)) {
 #endif
         Clog << "error:failed to write unicodedata to " << binfile << "\n";
     }
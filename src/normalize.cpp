@@ -0,0 +1,98 @@
+#include <unicodedata.h>
+
+#include <cstdio>
+
+#include "common.h"
+
+using namespace commonlib2;
+
+bool get_normalize_form(const std::string &name, NormalizeForm &form) {
+    const char *names[] = {"nfc", "nfd", "nfkc", "nfkd"};
+    for (auto i = 0; i < normalize_form_count; i++) {
+        if (name == names[i]) {
+            form = (NormalizeForm)i;
+            return true;
+        }
+    }
+    Clog << "error:unknown form:" << name << " (nfc|nfd|nfkc|nfkd)\n";
+    return false;
+}
+
+const char *quick_check_name(NormalizeCheck check) {
+    return check == normalize_yes ? "yes" : check == normalize_no ? "no" : "maybe";
+}
+
+//normalize utf-8 from fp by blocks. each block is cut at the last boundary and the rest is carried
+int normalize_stream(const NormalizeTable &table, NormalizeForm form, FILE *fp, bool quick) {
+    std::string out;
+    auto check = normalize_yes;
+    auto ret = read_utf8_blocks(fp, [&](const char *in, size_t len, size_t, bool eof) {
+        auto cut = eof ? len : table.last_boundary(form, in, len);
+        if (!cut && len >= utf8_stream_block) {
+            //no starter in a whole block. composition is lost only at this cut
+            cut = len;
+        }
+        if (quick) {
+            auto c = table.quick_check(form, in, cut);
+            if (c == normalize_no || check == normalize_yes) {
+                check = c;
+            }
+        }
+        else {
+            out.clear();
+            table.normalize(form, in, cut, out);
+            Cout.write(out.data(), out.size());
+        }
+        return cut;
+    });
+    if (ret < 0) {
+        return ret;
+    }
+    if (quick) {
+        Cout << quick_check_name(check) << "\n";
+    }
+    return 0;
+}
+
+int normalize_text(int argc, char **argv, int i) {
+    TextOptions opt;
+    bool quick = false;
+    auto extra = [&](char c, int &) {
+        if (quick || c != 'q') return 0;
+        quick = true;
+        return 1;
+    };
+    if (!parse_text_options(i, argc, argv, opt, extra)) {
+        return -1;
+    }
+    if (i >= argc) {
+        Clog << "error: need more argument\n";
+        return -1;
+    }
+    NormalizeForm form;
+    if (!get_normalize_form(argv[i], form)) {
+        return -1;
+    }
+    i++;
+    const NormalizeTable *table = nullptr;
+    std::string out;
+    TextCommand cmd;
+    cmd.failure = "failed to build normalization table";
+    cmd.load = [&](UnicodeData &data) {
+        table = &get_normalize_table(data);
+        return table->built;
+    };
+    cmd.stream = [&](FILE *fp) {
+        return normalize_stream(*table, form, fp, quick);
+    };
+    cmd.word = [&](const char *str, size_t size) {
+        if (quick) {
+            Cout << quick_check_name(table->quick_check(form, str, size)) << "\n";
+            return;
+        }
+        out.clear();
+        table->normalize(form, str, size, out);
+        Cout << out << "\n";
+    };
+    return run_text_command(opt, i, argc, argv, cmd);
+}
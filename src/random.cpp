@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <array>
 #include <random>
 
@@ -84,6 +85,7 @@ int random_gen(int argc, char** argv, int i) {
     bool device = false;
     bool index = false;
     bool noadjacent = false;
+    size_t threads = 1;
     bool ok = false;
     for (; i < argc; i++) {
         if (argv[i][0] == '-') {
@@ -136,6 +138,11 @@ int random_gen(int argc, char** argv, int i) {
                 else if (s == 'l') {
                     noadjacent = true;
                 }
+                else if (s == 'j') {
+                    if (!get_threads(threads, i, argc, argv)) {
+                        return -1;
+                    }
+                }
                 else {
                     broken = true;
                     break;
@@ -152,7 +159,7 @@ int random_gen(int argc, char** argv, int i) {
     }
     Cout.stop_out(true);
     Cout.reset_buf();
-    if (search(argc, argv, i, true) == -1) {
+    if (search(argc, argv, i, true, threads) == -1) {
         return -1;
     }
     std::string result = Cout.buf_str();
@@ -7,9 +7,9 @@
 
 using namespace commonlib2;
 
-auto &Cin = cin_wrapper();
-auto &Cout = stdout_wrapper();
-auto &Clog = stderr_wrapper();
+commonlib2::CinWrapper &Cin = cin_wrapper();
+commonlib2::StdOutWrapper &Cout = stdout_wrapper();
+commonlib2::StdOutWrapper &Clog = stderr_wrapper();
 
 int init_io_detail(bool sync = false, const char **err = nullptr) {
     if (!IOWrapper::Initialized()) {
@@ -107,6 +107,30 @@ int STDCALL command_argv(int argc, char **argv, int i) {
     else if (cmd == "random") {
         return random_gen(argc, argv, i);
     }
+    else if (cmd == "encode") {
+        return file_encoder(argc, argv, i);
+    }
+    else if (cmd == "length") {
+        return file_length(argc, argv, i);
+    }
+    else if (cmd == "normalize") {
+        return normalize_text(argc, argv, i);
+    }
+    else if (cmd == "case") {
+        return case_text(argc, argv, i);
+    }
+    else if (cmd == "graphemes") {
+        return graphemes_text(argc, argv, i);
+    }
+    else if (cmd == "width") {
+        return width_text(argc, argv, i);
+    }
+    else if (cmd == "segment") {
+        return segment_text(argc, argv, i);
+    }
+    else if (cmd == "scripts") {
+        return scripts_text(argc, argv, i);
+    }
     else if (cmd == "echo") {
         for (; i < argc; i++) {
             Cout << argv[i];
@@ -132,6 +156,7 @@ int STDCALL command_argv(int argc, char **argv, int i) {
         -r :only raw(UTF-8) charactor with line and title
         -n :raw(UTF-8) charactor with noline and notitle (use with -r)
         -o <file>:stdout to <file>
+        -j <threads>:scan code points of range with <threads> threads (0:hardware concurrency)
         name <names>:
             look up code info which name property has string <names> 
         strict <names>:
@@ -170,6 +195,16 @@ int STDCALL command_argv(int argc, char **argv, int i) {
         <bin>:path to unicodedata.bin (any name)
         -a <file>:refer EastAsianWide.txt
         -b <fike>:refer Blocks.txt
+        -s <file>:refer SpecialCasing.txt (version 5 only)
+        -f <file>:refer CaseFolding.txt (version 5 only)
+        -g <file>:refer GraphemeBreakProperty.txt (version 5 only)
+        -e <file>:refer emoji-data.txt (version 5 only)
+        -w <file>:refer WordBreakProperty.txt (version 5 only)
+        -n <file>:refer SentenceBreakProperty.txt (version 5 only)
+        -r <file>:refer Scripts.txt (version 5 only)
+        -x <file>:refer ScriptExtensions.txt (version 5 only)
+        -v <version>:binary format version 1-5 (default:5)
+            version 5 is used in place without deserialization
     utf8,utf16,utf32:
         convert UTF-8,UTF-16,UTF-32 for each other
         -o <file>:stdout to <file>
@@ -177,6 +212,8 @@ int STDCALL command_argv(int argc, char **argv, int i) {
         -n :no space (ex: e8 97 a4 -> e897a4)
         -r :show raw(UTF-8) character
         -d :show as decimal
+        -l :replace invalid sequences with U+FFFD and report them instead of stopping
+        -i <file>:read words of 'word' from UTF-8 <file> by streaming ('-' is stdin)
         word <words>:
            convert <words> to referred UTF
         code [<option>] <codes>:
@@ -192,7 +229,69 @@ int STDCALL command_argv(int argc, char **argv, int i) {
         -i :show random with index
         -s <time|random|<number>>:set seed for pseudo-random number 
         -l :make sure the same characters are not adjacent
+        -j <threads>:scan code points of range on <threads> threads like 'search' command
         this command wraps 'search' command and option -uqrn is unusable.
+    encode [<option>] <input> <output>:
+        transcode file <input> to file <output> by streaming (memory use is constant)
+        -e <form>:encoding of <input> (default:detected by BOM or utf8)
+        -t <form>:encoding of <output> (default:utf8)
+        -b :write BOM to <output>
+        -l :replace invalid sequences with U+FFFD and report them instead of stopping
+        -j <threads>:map <input> and transcode chunks on <threads> threads (0:hardware concurrency)
+        <form>:=utf8|utf16le|utf16be|utf32le|utf32be
+    length [<option>] <input>:
+        count UTF-8 bytes, UTF-16 units and code points of file <input> ('-' is stdin) without decoding.
+        <input> is assumed to be valid (check it with 'encode')
+        -e <form>:encoding of <input> (default:detected by BOM or utf8)
+    normalize [<option>] <form> <words>:
+        normalize UTF-8 <words> to <form> and print them line by line
+        -t <file>:refer unicodedata file (txt) (default:./unicodedata.txt)
+        -b <file>:refer unicodedata file (bin) (default:./unicodedata.bin)
+        -q :only quick check (print yes, no or maybe)
+        -i <file>:normalize UTF-8 <file> by streaming instead of <words> ('-' is stdin)
+        -o <file>:stdout to <file>
+        <form>:=nfc|nfd|nfkc|nfkd
+    case [<option>] <case> <words>:
+        convert case of UTF-8 <words> to <case> and print them line by line
+        full mappings of SpecialCasing.txt and CaseFolding.txt are used if the binary has them (see txt2bin)
+        -t <file>:refer unicodedata file (txt) (default:./unicodedata.txt)
+        -b <file>:refer unicodedata file (bin) (default:./unicodedata.bin)
+        -i <file>:convert UTF-8 <file> by streaming instead of <words> ('-' is stdin)
+        -o <file>:stdout to <file>
+        <case>:=lower|upper|title|fold|simplefold
+    graphemes [<option>] <words>:
+        print byte offsets of extended grapheme cluster boundaries of UTF-8 <words> line by line
+        break properties are guessed from general category unless the binary has them (see txt2bin)
+        -t <file>:refer unicodedata file (txt) (default:./unicodedata.txt)
+        -b <file>:refer unicodedata file (bin) (default:./unicodedata.bin)
+        -c :print count of clusters instead
+        -s <separator>:print clusters joined by <separator> instead
+        -i <file>:read UTF-8 <file> by streaming instead of <words> ('-' is stdin)
+        -o <file>:stdout to <file>
+    width [<option>] <words>:
+        print display width (columns in terminals) of UTF-8 <words> line by line
+        East_Asian_Width W and F are 2, marks, format and control characters are 0
+        -t <file>:refer unicodedata file (txt) (default:./unicodedata.txt)
+        -b <file>:refer unicodedata file (bin) (default:./unicodedata.bin)
+        -i <file>:print width of each line of UTF-8 <file> by streaming instead of <words> ('-' is stdin)
+        -o <file>:stdout to <file>
+    segment [<option>] <unit> <words>:
+        print byte offsets of word or sentence boundaries of UTF-8 <words> line by line
+        break properties are guessed from general category unless the binary has them (see txt2bin)
+        -t <file>:refer unicodedata file (txt) (default:./unicodedata.txt)
+        -b <file>:refer unicodedata file (bin) (default:./unicodedata.bin)
+        -c :print count of segments instead
+        -s <separator>:print segments joined by <separator> instead
+        -i <file>:read UTF-8 <file> by streaming instead of <words> ('-' is stdin)
+        -o <file>:stdout to <file>
+        <unit>:=word|sentence
+    scripts [<option>] <words>:
+        print byte offsets and script of maximal same-script runs of UTF-8 <words> line by line
+        Common and Inherited characters join the surrounding run. needs Scripts.txt in the binary (see txt2bin)
+        -t <file>:refer unicodedata file (txt) (default:./unicodedata.txt)
+        -b <file>:refer unicodedata file (bin) (default:./unicodedata.bin)
+        -i <file>:read UTF-8 <file> by streaming instead of <words> ('-' is stdin)
+        -o <file>:stdout to <file>
 )";
         Cout << helpstr;
         return 0;
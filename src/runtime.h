@@ -27,6 +27,9 @@ DLL_EXPORT extern commonlib2::StdOutWrapper &Clog;
 #endif
 #ifdef __cplusplus
 extern "C" {
+#else
+#include <stddef.h>
+#include <uchar.h>
 #endif
 #ifdef __EMSCRIPTEN__
 #if USE_CALLBACK
@@ -45,6 +48,26 @@ DLL_EXPORT int STDCALL init_io(int sync, const char **err);
 
 DLL_EXPORT int STDCALL runtime_main(int argc, char **argv);
 
+//transcode size units of in into out without allocation. units are in native byte order
+//returns 1 if whole in is converted, 0 if in has an invalid sequence, -1 if out is too short,
+//-2 if in is null with size or out is null with capacity.
+//*written is units stored in out (always valid prefix) and *err_pos is units of in consumed,
+//which is the position of the invalid sequence or of the code point that did not fit. both may be null
+DLL_EXPORT int STDCALL utf8_to_utf16(const char *in, size_t size, char16_t *out, size_t capacity, size_t *written, size_t *err_pos);
+DLL_EXPORT int STDCALL utf8_to_utf32(const char *in, size_t size, char32_t *out, size_t capacity, size_t *written, size_t *err_pos);
+DLL_EXPORT int STDCALL utf16_to_utf8(const char16_t *in, size_t size, char *out, size_t capacity, size_t *written, size_t *err_pos);
+DLL_EXPORT int STDCALL utf16_to_utf32(const char16_t *in, size_t size, char32_t *out, size_t capacity, size_t *written, size_t *err_pos);
+DLL_EXPORT int STDCALL utf32_to_utf8(const char32_t *in, size_t size, char *out, size_t capacity, size_t *written, size_t *err_pos);
+DLL_EXPORT int STDCALL utf32_to_utf16(const char32_t *in, size_t size, char16_t *out, size_t capacity, size_t *written, size_t *err_pos);
+
+//units which transcoding valid in produces. use to size out exactly before the functions above
+DLL_EXPORT size_t STDCALL utf8_to_utf16_length(const char *in, size_t size);
+DLL_EXPORT size_t STDCALL utf8_to_utf32_length(const char *in, size_t size);
+DLL_EXPORT size_t STDCALL utf16_to_utf8_length(const char16_t *in, size_t size);
+DLL_EXPORT size_t STDCALL utf16_to_utf32_length(const char16_t *in, size_t size);
+DLL_EXPORT size_t STDCALL utf32_to_utf8_length(const char32_t *in, size_t size);
+DLL_EXPORT size_t STDCALL utf32_to_utf16_length(const char32_t *in, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,53 @@
+#include <unicodedata.h>
+
+#include <cstdio>
+
+#include "common.h"
+
+using namespace commonlib2;
+
+//print runs of utf-8 from fp. a run can span blocks
+int scripts_stream(const ScriptTable &table, const FlatTable &flat, FILE *fp) {
+    ScriptCursor cur;
+    auto print = [&](size_t begin, size_t end, std::uint16_t script) {
+        Cout << begin << " " << end << " " << flat.property(property_script, script) << "\n";
+    };
+    auto ret = read_utf8_blocks(fp, [&](const char *in, size_t len, size_t, bool) {
+        table.each_run(cur, in, len, print);
+        return len;
+    });
+    if (ret < 0) {
+        return ret;
+    }
+    table.finish(cur, print);
+    return 0;
+}
+
+int scripts_text(int argc, char **argv, int i) {
+    TextOptions opt;
+    if (!parse_text_options(i, argc, argv, opt)) {
+        return -1;
+    }
+    if (!opt.input.size() && i >= argc) {
+        Clog << "error: need more argument\n";
+        return -1;
+    }
+    const ScriptTable *table = nullptr;
+    const FlatTable *flat = nullptr;
+    TextCommand cmd;
+    cmd.failure = "unicodedata has no scripts (see txt2bin -r)";
+    cmd.load = [&](UnicodeData &data) {
+        table = &get_script_table(data);
+        flat = &data.flat;
+        return table->built;
+    };
+    cmd.stream = [&](FILE *fp) {
+        return scripts_stream(*table, *flat, fp);
+    };
+    cmd.word = [&](const char *str, size_t size) {
+        for (auto &run : script_runs(*table, str, size)) {
+            Cout << run.begin << " " << run.end << " " << flat->property(property_script, run.script) << "\n";
+        }
+    };
+    return run_text_command(opt, i, argc, argv, cmd);
+}
@@ -1,5 +1,8 @@
 #include <unicodedata.h>
 
+#include <atomic>
+#include <thread>
+
 #include "common.h"
 
 using namespace commonlib2;
@@ -8,7 +11,54 @@ bool check_charname(const std::string &str, char *cmp, bool strict) {
     return strict ? (str == cmp) : (str.find(cmp) != ~0);
 }
 
-int search(int argc, char **argv, int i, bool rnflag) {
+//call out(item) for each code in [begin,end] which find(code, item) is true, in code point order
+//find runs on worker threads by chunk when threads>1; out always runs on caller thread
+template <class Item, class Find, class Out>
+void scan_codes(size_t threads, char32_t begin, char32_t end, Find &&find, Out &&out) {
+    if (begin > end) return;
+    constexpr char32_t chunk = 0x1000;
+    size_t count = (end - begin) / chunk + 1;
+    if (threads <= 1 || count == 1) {
+        for (auto code = begin;; code++) {
+            Item item;
+            if (find(code, item)) {
+                out(item);
+            }
+            if (code == end) break;
+        }
+        return;
+    }
+    std::vector<std::vector<Item>> results(count);
+    std::atomic_size_t next = 0;
+    auto worker = [&] {
+        for (size_t i = next++; i < count; i = next++) {
+            char32_t first = begin + (char32_t)i * chunk;
+            char32_t last = end - first < chunk ? end : first + chunk - 1;
+            for (auto code = first;; code++) {
+                Item item;
+                if (find(code, item)) {
+                    results[i].push_back(item);
+                }
+                if (code == last) break;
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads && i < count; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : pool) {
+        t.join();
+    }
+    for (auto &result : results) {
+        for (auto &item : result) {
+            out(item);
+        }
+    }
+}
+
+int search(int argc, char **argv, int i, bool rnflag, size_t threads) {
     bool ok = false;
     bool bin = false;
     bool u8 = false;
@@ -46,6 +96,11 @@ int search(int argc, char **argv, int i, bool rnflag) {
                     }
                     output = true;
                 }
+                else if (c == 'j') {
+                    if (!get_threads(threads, i, argc, argv)) {
+                        return -1;
+                    }
+                }
                 else if (rnflag && (c == 'c' || c == 'd' || c == 'i' || c == 's' || c == 'l')) {
                 }
                 else {
@@ -61,20 +116,7 @@ int search(int argc, char **argv, int i, bool rnflag) {
         Clog << "error: need more argument\n";
         return -1;
     }
-    HUNICODEDATA data = nullptr;
-    if (infile.size()) {
-        if (bin) {
-            data = unicodedata_from_binary(infile.c_str());
-        }
-        else {
-            Cout << "as text\n";
-            data = unicodedata_from_text(infile.c_str());
-        }
-    }
-    else {
-        infile = "./unicodedata.txt or ./unicodedata.bin";
-        data = get_default_unicodedata();
-    }
+    HUNICODEDATA data = open_unicodedata(infile, bin);
     if (!data) {
         Clog << "error:failed to load unicodedata from " << infile << "\n";
         return -1;
@@ -88,49 +130,47 @@ int search(int argc, char **argv, int i, bool rnflag) {
             print_codeinfo(info, u8, quiet);
         }
     };
+    auto print_code = [&](char32_t code) {
+        CODEINFO_VIEW info;
+        if (get_codeinfo_view(data, code, &info)) {
+            print_out(&info);
+        }
+    };
     UnicodeData *udata = (UnicodeData *)data;
     std::string arg = argv[i];
     i++;
-    if (arg == "name" || arg == "strict") {
-        for (; i < argc; i++) {
-            for (auto k = 0; k < 0x110000; k++) {
-                CODEINFO info = nullptr;
-                if (get_codeinfo(data, k, &info)) {
-                    std::string str(get_charname(info));
-                    if (check_charname(str, argv[i], arg[0] == 's')) {
-                        print_out(info);
-                    }
-                    clean_codeinfo(&info);
-                }
-            }
-        }
+    if (threads != 1 && arg != "range") {
+        Clog << "warning: -j is used only by range\n";
     }
-    else if (arg == "block" || arg == "include") {
+    if (arg == "name" || arg == "strict") {
+        auto &index = get_name_index(*udata);
         for (; i < argc; i++) {
-            for (auto k = 0; k < 0x110000; k++) {
-                CODEINFO info = nullptr;
-                if (get_codeinfo(data, k, &info)) {
-                    std::string str(get_block(info));
-                    if (check_charname(str, argv[i], arg[0] == 'b')) {
-                        print_out(info);
+            std::vector<std::pair<char32_t, char32_t>> hits;
+            index.find(argv[i], arg[0] == 's', hits);
+            for (auto &range : hits) {
+                for (auto k = range.first; k <= range.second; k++) {
+                    CODEINFO_VIEW info;
+                    if (get_codeinfo_view(data, k, &info)) {
+                        print_out(&info);
                     }
-                    clean_codeinfo(&info);
                 }
             }
         }
     }
-    else if (arg == "category") {
+    else if (arg == "block" || arg == "include" || arg == "category") {
+        auto kind = arg[0] == 'c' ? property_category : property_block;
+        auto &sets = get_property_sets(*udata);
+        auto count = get_property_count(data, kind);
         for (; i < argc; i++) {
-            for (auto k = 0; k < 0x110000; k++) {
-                CODEINFO info = nullptr;
-                if (get_codeinfo(data, k, &info)) {
-                    std::string str(get_category(info));
-                    if (str == argv[i]) {
-                        print_out(info);
-                    }
-                    clean_codeinfo(&info);
+            //union sets of every matched value; only matched code points are visited
+            CodeSet matched;
+            for (auto id = 0; id < count; id++) {
+                std::string str(get_property_name(data, kind, id));
+                if (check_charname(str, argv[i], arg[0] != 'i')) {
+                    matched = CodeSet::unite(matched, *sets.find(kind, id));
                 }
             }
+            matched.each(print_code);
         }
     }
     else if (arg == "code") {
@@ -139,10 +179,9 @@ int search(int argc, char **argv, int i, bool rnflag) {
             if (!get_code(argv[i], code)) {
                 continue;
             }
-            CODEINFO info = nullptr;
-            if (get_codeinfo(data, code, &info)) {
-                print_out(info);
-                clean_codeinfo(&info);
+            CODEINFO_VIEW info;
+            if (get_codeinfo_view(data, code, &info)) {
+                print_out(&info);
             }
             else {
                 Clog << "warning: code " << argv[i]
@@ -156,13 +195,14 @@ int search(int argc, char **argv, int i, bool rnflag) {
             if (!get_range(argv[i], begin, end)) {
                 continue;
             }
-            for (uint32_t code = begin; code <= end; code++) {
-                CODEINFO info = nullptr;
-                if (get_codeinfo(data, code, &info)) {
-                    print_out(info);
-                    clean_codeinfo(&info);
-                }
-            }
+            scan_codes<CODEINFO_VIEW>(
+                threads, begin, end,
+                [&](char32_t k, CODEINFO_VIEW &info) {
+                    return get_codeinfo_view(data, k, &info) != 0;
+                },
+                [&](CODEINFO_VIEW &info) {
+                    print_out(&info);
+                });
         }
     }
     else if (arg == "logic") {
@@ -173,15 +213,7 @@ int search(int argc, char **argv, int i, bool rnflag) {
                 return -1;
             }
             i++;
-            for (auto k = 0; k < 0x110000; k++) {
-                CODEINFO info = nullptr;
-                if (get_codeinfo(data, k, &info)) {
-                    if (logic(k, get_charname(info), get_category(info), get_block(info))) {
-                        print_out(info);
-                    }
-                    clean_codeinfo(&info);
-                }
-            }
+            logic_compile(logic, data).each(print_code);
         }
     }
     else if (arg == "word") {
@@ -189,10 +221,9 @@ int search(int argc, char **argv, int i, bool rnflag) {
             std::u32string str;
             Reader(argv[i]) >> str;
             for (auto c : str) {
-                CODEINFO info = nullptr;
-                if (get_codeinfo(data, c, &info)) {
-                    print_out(info);
-                    clean_codeinfo(&info);
+                CODEINFO_VIEW info;
+                if (get_codeinfo_view(data, c, &info)) {
+                    print_out(&info);
                 }
                 else {
                     Clog << "warning: invalid codepoint\n";
@@ -0,0 +1,143 @@
+#include <unicodedata.h>
+
+#include <cstdio>
+
+#include "common.h"
+
+using namespace commonlib2;
+
+struct SegmentReport {
+    bool count = false;
+    bool separate = false;
+    std::string separator;
+};
+
+//report segments of utf-8 from fp by blocks. text after a pending boundary is held until it is settled
+int segment_stream(const SegmentTable &table, const SegmentReport &report, FILE *fp) {
+    std::string held;
+    size_t offset = 0, count = 0, written = 0;
+    SegmentCursor cur;
+    auto report_boundary = [&](size_t at) {
+        count++;
+        if (report.separate) {
+            auto base = offset - held.size();
+            Cout.write(held.data() + (written - base), at - written);
+            Cout << report.separator;
+            written = at;
+        }
+        else if (!report.count) {
+            Cout << at << "\n";
+        }
+    };
+    if (!report.count && !report.separate) {
+        Cout << 0 << "\n";
+    }
+    auto ret = read_utf8_blocks(fp, [&](const char *in, size_t len, size_t, bool eof) {
+        if (!offset && len) {
+            count = 1;
+        }
+        if (report.separate) {
+            held.append(in, len);
+        }
+        offset += len;
+        table.boundaries(cur, in, len, report_boundary);
+        if (eof) {
+            table.finish(cur, report_boundary);
+        }
+        if (report.separate) {
+            auto base = offset - held.size();
+            auto keep = table.is_pending(cur) ? cur.pending : offset;
+            Cout.write(held.data() + (written - base), keep - written);
+            written = keep;
+            held.erase(0, written - base);
+        }
+        return len;
+    });
+    if (ret < 0) {
+        return ret;
+    }
+    if (report.count) {
+        Cout << count << "\n";
+    }
+    else if (!report.separate && offset) {
+        Cout << offset << "\n";
+    }
+    return 0;
+}
+
+void segment_word(const SegmentTable &table, const SegmentReport &report, const char *word, size_t size) {
+    if (report.count) {
+        Cout << table.count(word, size) << "\n";
+        return;
+    }
+    size_t begin = 0;
+    if (!report.separate) {
+        Cout << 0;
+    }
+    while (begin < size) {
+        auto end = table.next_boundary(word, size, begin);
+        if (report.separate) {
+            Cout.write(word + begin, end - begin);
+            if (end < size) {
+                Cout << report.separator;
+            }
+        }
+        else {
+            Cout << " " << end;
+        }
+        begin = end;
+    }
+    Cout << "\n";
+}
+
+int segment_text(int argc, char **argv, int i) {
+    TextOptions opt;
+    SegmentReport report;
+    auto extra = [&](char c, int &i) {
+        if (!report.count && c == 'c') {
+            report.count = true;
+        }
+        else if (!report.separate && c == 's') {
+            if (!get_morearg(report.separator, i, argc, argv)) {
+                return -1;
+            }
+            report.separate = true;
+        }
+        else {
+            return 0;
+        }
+        return 1;
+    };
+    if (!parse_text_options(i, argc, argv, opt, extra)) {
+        return -1;
+    }
+    if (i >= argc || (!opt.input.size() && i + 1 >= argc)) {
+        Clog << "error: need more argument\n";
+        return -1;
+    }
+    std::string unit = argv[i];
+    i++;
+    if (unit != "word" && unit != "sentence") {
+        Clog << "error: unit " << unit << " unsupported\n";
+        return -1;
+    }
+    auto word = unit == "word";
+    if (report.count && report.separate) {
+        Clog << "warning: -s is ignored with -c\n";
+        report.separate = false;
+    }
+    const SegmentTable *table = nullptr;
+    TextCommand cmd;
+    cmd.failure = "failed to build " + unit + " table";
+    cmd.load = [&](UnicodeData &data) {
+        table = word ? &get_word_table(data) : &get_sentence_table(data);
+        return table->built;
+    };
+    cmd.stream = [&](FILE *fp) {
+        return segment_stream(*table, report, fp);
+    };
+    cmd.word = [&](const char *str, size_t size) {
+        segment_word(*table, report, str, size);
+    };
+    return run_text_command(opt, i, argc, argv, cmd);
+}
@@ -0,0 +1,174 @@
+/*
+    build time generator of builtin unicode tables
+    usage: unicodegen <unicodedata.bin> <output header>
+    input may be any binary version (1-5). output defines
+    constexpr FlatTable builtin::table which needs no initialization at run time
+*/
+#include <unicodedata.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using namespace commonlib2;
+
+bool load_input(const char *path, UnicodeData &data) {
+    auto map = std::make_unique<FileMap>(path);
+    if (map->is_open() && map->size() >= 4 && ::memcmp(map->c_str(), "UDv5", 4) == 0) {
+        return map_unicodedata(std::move(map), data);
+    }
+    Deserializer<FileReader> r(path);
+    if (r.eof()) {
+        return false;
+    }
+    return deserialize_unicodedata(r, data);
+}
+
+template <class T, class F>
+void write_array(std::ostream &out, const char *type, const char *name, const T *p, size_t size, F &&elm) {
+    out << "        constexpr " << type << " " << name << "[] = {";
+    for (size_t i = 0; i < size; i++) {
+        if (i % 16 == 0) {
+            out << "\n            ";
+        }
+        elm(p[i]);
+        out << ",";
+    }
+    out << "\n        };\n\n";
+}
+
+void write_record(std::ostream &out, const FlatCodeInfo &rec) {
+    FlatCodeInfo def;
+    out << "\n            {";
+    bool first = true;
+    auto field = [&](const char *name, auto value, auto defvalue) {
+        if (value == defvalue) return;
+        out << (first ? "" : ", ") << "." << name << " = " << (long long)value;
+        first = false;
+    };
+#define FIELD(name) field(#name, rec.name, def.name)
+    FIELD(codepoint);
+    FIELD(name);
+    FIELD(decomposition);
+    FIELD(upper);
+    FIELD(lower);
+    FIELD(title);
+    if (rec.numeric != def.numeric) {
+        //LLONG_MIN can not be written as literal
+        out << (first ? "" : ", ") << ".numeric = (std::int64_t)" << (unsigned long long)rec.numeric << "ull";
+        first = false;
+    }
+    FIELD(digit);
+    FIELD(decimal);
+    FIELD(numeric_flag);
+    FIELD(case_flag);
+    FIELD(category);
+    FIELD(bidiclass);
+    FIELD(east_asian_width);
+    FIELD(ccc);
+    FIELD(decomposition_command);
+    FIELD(decomposition_size);
+    FIELD(mirrored);
+    FIELD(range);
+    FIELD(block);
+#undef FIELD
+    out << "},";
+}
+
+bool write_header(std::ostream &out, const FlatTable &t, const char *source) {
+    out << "//generated by unicodegen from " << source << ". do not edit\n"
+        << "#pragma once\n"
+        << "#include <unicodedata.h>\n\n"
+        << "namespace PROJECT_NAME {\n"
+        << "    namespace builtin {\n";
+    auto hex = [&](auto c) {
+        out << "0x" << std::hex << (unsigned long long)c << std::dec;
+    };
+    write_array(out, "std::uint16_t", "stage1", t.stage1, codepoint_limit >> codetable_shift, hex);
+    write_array(out, "std::uint16_t", "stage2", t.stage2, t.stage2_size, hex);
+    write_array(out, "char32_t", "decomposition", t.decomposition, t.decomposition_size, hex);
+    write_array(out, "char", "strings", t.strings, t.strings_size, [&](char c) {
+        out << (int)(signed char)c;
+    });
+    //kinds missing in the input (older UDv5 images) are left empty
+    for (auto i = 0; i < property_count; i++) {
+        std::string name = "property_" + std::to_string(i);
+        if (t.property_size[i]) {
+            write_array(out, "std::uint32_t", name.c_str(), t.properties[i], t.property_size[i], hex);
+        }
+    }
+    if (t.case_mapping_count) {
+        write_array(out, "FlatCaseMapping", "case_mappings", t.case_mappings, t.case_mapping_count, [&](const FlatCaseMapping &m) {
+            out << "{" << m.codepoint << ", " << (int)m.kind << ", " << (int)m.size << ", 0, " << m.offset << "}";
+        });
+    }
+    if (t.range_property_count) {
+        write_array(out, "FlatRangeProperty", "range_properties", t.range_properties, t.range_property_count, [&](const FlatRangeProperty &r) {
+            out << "{" << r.first << ", " << r.last << ", " << r.kind << ", " << r.value << "}";
+        });
+    }
+    out << "        constexpr FlatCodeInfo records[] = {";
+    for (size_t i = 0; i < t.record_count; i++) {
+        write_record(out, t.records[i]);
+    }
+    out << "\n        };\n\n";
+    out << "        constexpr FlatHeader header{.record_size = sizeof(FlatCodeInfo), .record_count = "
+        << t.record_count << "};\n\n";
+    out << "        constexpr FlatTable table{\n"
+        << "            .header = &header,\n"
+        << "            .stage1 = stage1,\n"
+        << "            .stage2 = stage2,\n"
+        << "            .stage2_size = sizeof(stage2) / sizeof(stage2[0]),\n"
+        << "            .records = records,\n"
+        << "            .record_count = sizeof(records) / sizeof(records[0]),\n"
+        << "            .decomposition = decomposition,\n"
+        << "            .decomposition_size = sizeof(decomposition) / sizeof(decomposition[0]),\n"
+        << "            .strings = strings,\n"
+        << "            .strings_size = sizeof(strings),\n"
+        << "            .properties = {";
+    for (auto i = 0; i < property_count; i++) {
+        out << (i ? ", " : "") << (t.property_size[i] ? "property_" + std::to_string(i) : "nullptr");
+    }
+    out << "},\n"
+        << "            .property_size = {";
+    for (auto i = 0; i < property_count; i++) {
+        out << (i ? ", " : "");
+        if (t.property_size[i]) {
+            out << "sizeof(property_" << i << ") / sizeof(std::uint32_t)";
+        }
+        else {
+            out << "0";
+        }
+    }
+    out << "},\n";
+    if (t.case_mapping_count) {
+        out << "            .case_mappings = case_mappings,\n"
+            << "            .case_mapping_count = sizeof(case_mappings) / sizeof(case_mappings[0]),\n";
+    }
+    if (t.range_property_count) {
+        out << "            .range_properties = range_properties,\n"
+            << "            .range_property_count = sizeof(range_properties) / sizeof(range_properties[0]),\n";
+    }
+    out << "        };\n"
+        << "    }  // namespace builtin\n"
+        << "}  // namespace PROJECT_NAME\n";
+    return (bool)out;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "usage: unicodegen <unicodedata.bin> <output header>\n";
+        return -1;
+    }
+    UnicodeData data;
+    if (!load_input(argv[1], data)) {
+        std::cerr << "error:failed to load unicodedata from " << argv[1] << "\n";
+        return -1;
+    }
+    std::ofstream out(argv[2]);
+    if (!out.is_open() || !write_header(out, data.flat, argv[1])) {
+        std::cerr << "error:failed to write " << argv[2] << "\n";
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include <utf_bulk.h>
+
+#include "common.h"
+
+using namespace commonlib2;
+
+template <class From, class To>
+int transcode_exact(const From *in, size_t size, To *out, size_t capacity, size_t *written, size_t *err_pos) {
+    UTFResult res;
+    if ((!in && size) || (!out && capacity)) {
+        if (written) *written = 0;
+        if (err_pos) *err_pos = 0;
+        return -2;
+    }
+    if (in) {
+        res = utf_transcode_exact(in, size, out, capacity);
+    }
+    if (written) *written = res.written;
+    if (err_pos) *err_pos = res.read;
+    return res.err == 0 ? 1 : res.err == -1 ? -1 : 0;
+}
+
+#define DEFINE_TRANSCODE(NAME, FROM, TO, TO_SIZE)                                                                \
+    int STDCALL NAME(const FROM *in, size_t size, TO *out, size_t capacity, size_t *written, size_t *err_pos) {  \
+        return transcode_exact(in, size, out, capacity, written, err_pos);                                       \
+    }                                                                                                            \
+                                                                                                                 \
+    size_t STDCALL NAME##_length(const FROM *in, size_t size) {                                                  \
+        if (!in) return 0;                                                                                       \
+        return utf_length(Sized<const FROM>(in, size), TO_SIZE);                                                 \
+    }
+
+DEFINE_TRANSCODE(utf8_to_utf16, char, char16_t, 2)
+DEFINE_TRANSCODE(utf8_to_utf32, char, char32_t, 4)
+DEFINE_TRANSCODE(utf16_to_utf8, char16_t, char, 1)
+DEFINE_TRANSCODE(utf16_to_utf32, char16_t, char32_t, 4)
+DEFINE_TRANSCODE(utf32_to_utf8, char32_t, char, 1)
+DEFINE_TRANSCODE(utf32_to_utf16, char32_t, char16_t, 2)
+
+#undef DEFINE_TRANSCODE
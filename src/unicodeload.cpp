@@ -2,22 +2,55 @@
 #include "unicodeload.h"
 
 #include <unicodedata.h>
+#include <utf_bulk.h>
 
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 using namespace commonlib2;
 
+static_assert((int)UNICODE_PROPERTY_CATEGORY == (int)property_category &&
+                  (int)UNICODE_PROPERTY_BLOCK == (int)property_block &&
+                  (int)UNICODE_PROPERTY_DECOMPOSITION_ATTRIBUTE == (int)property_decomposition_command &&
+                  (int)UNICODE_PROPERTY_SCRIPT_EXTENSIONS == (int)property_script_extensions,
+              "property kind mismatch");
+static_assert((int)UNICODE_NFC == (int)normalize_nfc && (int)UNICODE_NFKD == (int)normalize_nfkd &&
+                  (int)UNICODE_QC_YES == (int)normalize_yes && (int)UNICODE_QC_MAYBE == (int)normalize_maybe,
+              "normalize form mismatch");
+static_assert((int)UNICODE_CASE_LOWER == (int)case_lower && (int)UNICODE_CASE_TITLE == (int)case_title &&
+                  (int)UNICODE_CASE_FOLD == (int)case_fold_full && (int)UNICODE_CASE_FOLD_SIMPLE == (int)case_fold_simple,
+              "case kind mismatch");
+
 #ifndef USE_BUILTIN_BINARY
 #define USE_BUILTIN_BINARY 0
 #endif
 
-struct CODEINFO_impl {
-    CodeInfo *base = nullptr;
-    char32_t real = ~0;
-    std::string v3_str;
-    std::string dummyname;
-    std::string u8str;
+#ifndef USE_BUILTIN_TABLE
+#define USE_BUILTIN_TABLE 0
+#endif
+
+#if USE_BUILTIN_TABLE
+#include "builtin_table.h"
+#endif
+
+constexpr unsigned int computed_name = 0x1;
+constexpr unsigned int computed_numeric = 0x2;
+constexpr unsigned int computed_u8str = 0x4;
+
+const FlatCodeInfo *base_of(CODEINFO info) {
+    return (const FlatCodeInfo *)info->base;
+}
+
+const FlatTable *table_of(CODEINFO info) {
+    return (const FlatTable *)info->table;
+}
+
+struct U8Buffer {
+    CODEINFO_impl *info;
+    void push_back(unsigned char c) {
+        info->u8str[info->u8size++] = (char)c;
+    }
 };
 
 UnicodeData *new_data() {
@@ -30,7 +63,7 @@ UnicodeData *new_data() {
 
 CODEINFO_impl *new_info() {
     try {
-        return new CODEINFO_impl();
+        return new CODEINFO_impl{};
     } catch (...) {
         return nullptr;
     }
@@ -51,15 +84,48 @@ HUNICODEDATA unicodedata_from_binary_impl_detail(Deserializer<Buf> &r) {
     return (HUNICODEDATA)ret;
 }
 
+template <class C>
+HUNICODEDATA unicodedata_from_mapped_impl(C *filepath) {
+    std::unique_ptr<FileMap> map;
+    try {
+        map = std::make_unique<FileMap>(filepath);
+    } catch (...) {
+        return nullptr;
+    }
+    if (!map->is_open() || map->size() < 4 || ::memcmp(map->c_str(), "UDv5", 4) != 0) {
+        return nullptr;
+    }
+    UnicodeData *ret = new_data();
+    if (!ret)
+        return nullptr;
+    if (!map_unicodedata(std::move(map), *ret)) {
+        delete ret;
+        return nullptr;
+    }
+    return (HUNICODEDATA)ret;
+}
+
 template <class C>
 HUNICODEDATA unicodedata_from_binary_impl(C *filepath) {
+    if (auto data = unicodedata_from_mapped_impl(filepath)) {
+        return data;
+    }
     Deserializer<FileReader> r(filepath);
     return unicodedata_from_binary_impl_detail(r);
 }
 
-#if USE_BUILTIN_BINARY
+#if USE_BUILTIN_TABLE
+//tables are constexpr and already in place. nothing to parse or validate
+HUNICODEDATA unicodedata_from_builtin() {
+    UnicodeData *ret = new_data();
+    if (!ret)
+        return nullptr;
+    ret->flat = builtin::table;
+    return (HUNICODEDATA)ret;
+}
+#elif USE_BUILTIN_BINARY
 const char *load_builtin_unicodedata(size_t &size) {
-    static const unsigned char CODE[] = {
+    alignas(8) static const unsigned char CODE[] = {
 #include "binary.csv"
     };
     size = sizeof(CODE);
@@ -69,6 +135,16 @@ const char *load_builtin_unicodedata(size_t &size) {
 HUNICODEDATA unicodedata_from_builtin() {
     size_t size;
     const char *data = load_builtin_unicodedata(size);
+    if (size >= 4 && ::memcmp(data, "UDv5", 4) == 0) {
+        UnicodeData *ret = new_data();
+        if (!ret)
+            return nullptr;
+        if (!ret->flat.load(data, size)) {
+            delete ret;
+            return nullptr;
+        }
+        return (HUNICODEDATA)ret;
+    }
     Deserializer<Sized<const char>> r(Sized(data, size));
     return unicodedata_from_binary_impl_detail(r);
 }
@@ -115,7 +191,7 @@ HUNICODEDATA default_unicodedata(const char *binpath = "./unicodedata.bin", cons
     if (auto data = unicodedata_from_text(txtpath)) {
         return data;
     }
-#if USE_BUILTIN_BINARY
+#if USE_BUILTIN_BINARY || USE_BUILTIN_TABLE
     return unicodedata_from_builtin();
 #endif
     return nullptr;
@@ -152,17 +228,23 @@ void STDCALL release_unicodedata(HUNICODEDATA f) {
     delete data;
 }
 
-CodeInfo *get_codepointobj(HUNICODEDATA data, char32_t code) {
+const FlatCodeInfo *get_codepointobj(HUNICODEDATA data, char32_t code) {
     UnicodeData *dat = (UnicodeData *)data;
-    if (auto it = dat->codes.find(code); it != dat->codes.end()) {
-        return &(*it).second;
-    }
-    for (auto &r : dat->ranges) {
-        if (code >= r.begin->codepoint && code <= r.end->codepoint) {
-            return r.begin;
-        }
-    }
-    return nullptr;
+    return dat->flat.find(code);
+}
+
+int STDCALL get_codeinfo_view(HUNICODEDATA data, char32_t code, CODEINFO_VIEW *view) {
+    if (!data || !view)
+        return 0;
+    const FlatCodeInfo *detail = get_codepointobj(data, code);
+    if (!detail)
+        return 0;
+    view->base = detail;
+    view->table = &((UnicodeData *)data)->flat;
+    view->real = code;
+    view->computed = 0;
+    view->u8size = 0;
+    return 1;
 }
 
 int STDCALL get_codeinfo(HUNICODEDATA data, char32_t code, CODEINFO *pinfo) {
@@ -170,22 +252,14 @@ int STDCALL get_codeinfo(HUNICODEDATA data, char32_t code, CODEINFO *pinfo) {
         return 0;
     CODEINFO_impl **res = pinfo;
 
-    CodeInfo *detail = get_codepointobj(data, code);
+    const FlatCodeInfo *detail = get_codepointobj(data, code);
     if (!detail)
         return 0;
 
     auto ret = new_info();
     if (!ret)
         return 0;
-    ret->base = detail;
-    ret->real = code;
-    if (code != detail->codepoint) {
-        ret->dummyname = detail->name;
-        ret->dummyname.erase(0, 1);
-        ret->dummyname.erase(ret->dummyname.end() - 8, ret->dummyname.end());
-    }
-    ret->v3_str = detail->numeric.stringify();
-    Reader(std::u32string(1, code)) >> u8filter >> ret->u8str;
+    get_codeinfo_view(data, code, ret);
     *res = ret;
     return 1;
 }
@@ -209,24 +283,32 @@ const char *STDCALL get_charname(CODEINFO point) {
     if (!point)
         return nullptr;
     CODEINFO_impl *info = point;
-    if (info->dummyname.size()) {
-        return info->dummyname.c_str();
+    auto name = table_of(info)->str(base_of(info)->name);
+    if (info->real == base_of(info)->codepoint) {
+        return name;
+    }
+    if (!(info->computed & computed_name)) {
+        auto ranged = range_name(name);
+        auto size = ranged.size() < sizeof(info->name) ? ranged.size() : sizeof(info->name) - 1;
+        ::memcpy(info->name, ranged.data(), size);
+        info->name[size] = 0;
+        info->computed |= computed_name;
     }
-    return info->base->name.c_str();
+    return info->name[0] ? info->name : name;
 }
 
 const char *STDCALL get_category(CODEINFO point) {
     if (!point)
         return nullptr;
     CODEINFO_impl *info = point;
-    return info->base->category.c_str();
+    return table_of(info)->property(property_category, base_of(info)->category);
 }
 
 unsigned int STDCALL get_ccc(CODEINFO point) {
     if (!point)
         return ~0;
     CODEINFO_impl *info = point;
-    return info->base->ccc;
+    return base_of(info)->ccc;
 }
 
 const char32_t *STDCALL get_decompsition(CODEINFO point, size_t *size) {
@@ -234,44 +316,408 @@ const char32_t *STDCALL get_decompsition(CODEINFO point, size_t *size) {
         return nullptr;
     CODEINFO_impl *info = point;
     if (size) {
-        *size = info->base->decomposition.to.size();
+        *size = base_of(info)->decomposition_size;
     }
-    return info->base->decomposition.to.c_str();
+    return table_of(info)->decomposition_of(*base_of(info));
 }
 
 const char *STDCALL get_decompsition_attribute(CODEINFO point) {
     if (!point)
         return nullptr;
     CODEINFO_impl *info = point;
-    return info->base->decomposition.command.c_str();
+    return table_of(info)->property(property_decomposition_command, base_of(info)->decomposition_command);
 }
 
 int STDCALL is_mirrored(CODEINFO point) {
     if (!point)
         return -1;
     CODEINFO_impl *info = point;
-    return info->base->mirrored;
+    return base_of(info)->mirrored;
 }
 
 const char *STDCALL get_bidiclass(CODEINFO point) {
     if (!point)
         return nullptr;
     CODEINFO_impl *info = point;
-    return info->base->bidiclass.c_str();
+    return table_of(info)->property(property_bidiclass, base_of(info)->bidiclass);
 }
 
 const char *STDCALL get_east_asian_wides(CODEINFO point) {
     if (!point)
         return nullptr;
     CODEINFO_impl *info = point;
-    return info->base->east_asian_width.c_str();
+    return table_of(info)->property(property_east_asian_width, base_of(info)->east_asian_width);
 }
 
 const char *STDCALL get_block(CODEINFO point) {
     if (!point)
         return nullptr;
     CODEINFO_impl *info = point;
-    return info->base->block.c_str();
+    return table_of(info)->property(property_block, base_of(info)->block);
+}
+
+int STDCALL get_category_id(CODEINFO point) {
+    if (!point)
+        return -1;
+    CODEINFO_impl *info = point;
+    return base_of(info)->category;
+}
+
+int STDCALL get_decompsition_attribute_id(CODEINFO point) {
+    if (!point)
+        return -1;
+    CODEINFO_impl *info = point;
+    return base_of(info)->decomposition_command;
+}
+
+int STDCALL get_bidiclass_id(CODEINFO point) {
+    if (!point)
+        return -1;
+    CODEINFO_impl *info = point;
+    return base_of(info)->bidiclass;
+}
+
+int STDCALL get_east_asian_wides_id(CODEINFO point) {
+    if (!point)
+        return -1;
+    CODEINFO_impl *info = point;
+    return base_of(info)->east_asian_width;
+}
+
+int STDCALL get_block_id(CODEINFO point) {
+    if (!point)
+        return -1;
+    CODEINFO_impl *info = point;
+    return base_of(info)->block;
+}
+
+int STDCALL get_property_id(HUNICODEDATA data, int kind, const char *name) {
+    if (!data || !name || kind < 0 || kind >= property_count)
+        return -1;
+    UnicodeData *dat = (UnicodeData *)data;
+    std::uint32_t id = 0;
+    if (!dat->flat.find_property((PropertyKind)kind, name, id)) {
+        return -1;
+    }
+    return (int)id;
+}
+
+const char *STDCALL get_property_name(HUNICODEDATA data, int kind, int id) {
+    if (!data || kind < 0 || kind >= property_count)
+        return nullptr;
+    UnicodeData *dat = (UnicodeData *)data;
+    if (id < 0 || (size_t)id >= dat->flat.property_size[kind]) {
+        return nullptr;
+    }
+    return dat->flat.property((PropertyKind)kind, id);
+}
+
+int STDCALL get_property_count(HUNICODEDATA data, int kind) {
+    if (!data || kind < 0 || kind >= property_count)
+        return -1;
+    UnicodeData *dat = (UnicodeData *)data;
+    return (int)dat->flat.property_size[kind];
+}
+
+int STDCALL get_property_ranges(HUNICODEDATA data, int kind, int id, const char32_t **ranges, size_t *count) {
+    if (!data || !ranges || !count || kind < 0 || kind >= property_count || id < 0)
+        return 0;
+    auto &sets = get_property_sets(*(UnicodeData *)data);
+    auto set = sets.find((PropertyKind)kind, id);
+    if (!set)
+        return 0;
+    static_assert(sizeof(CodeInterval) == sizeof(char32_t) * 2, "CodeInterval is exposed as char32_t pairs");
+    *ranges = set->ranges.size() ? &set->ranges[0].first : nullptr;
+    *count = set->ranges.size();
+    return 1;
+}
+
+int STDCALL get_properties(HUNICODEDATA data, const char32_t *codes, size_t size, unsigned int mask, UNICODE_BATCH *out) {
+    if (!data || (!codes && size) || !out)
+        return 0;
+    if (((mask & UNICODE_BATCH_CATEGORY) && !out->category) || ((mask & UNICODE_BATCH_CCC) && !out->ccc) ||
+        ((mask & UNICODE_BATCH_EAST_ASIAN_WIDTH) && !out->east_asian_width) ||
+        ((mask & UNICODE_BATCH_BIDICLASS) && !out->bidiclass) || ((mask & UNICODE_BATCH_NUMERIC) && !out->numeric) ||
+        ((mask & UNICODE_BATCH_BLOCK) && !out->block))
+        return 0;
+    const FlatTable &flat = ((UnicodeData *)data)->flat;
+    if (!flat.is_loaded())
+        return 0;
+    //resolve a chunk of indexes first, then fill each requested column in its own loop
+    constexpr size_t chunk = 256;
+    std::uint16_t idx[chunk];
+    auto records = flat.records;
+    for (size_t base = 0; base < size; base += chunk) {
+        auto n = size - base < chunk ? size - base : chunk;
+        flat.indexes(codes + base, n, idx);
+        if (mask & UNICODE_BATCH_CATEGORY) {
+            for (size_t i = 0; i < n; i++) out->category[base + i] = records[idx[i]].category;
+        }
+        if (mask & UNICODE_BATCH_CCC) {
+            for (size_t i = 0; i < n; i++) out->ccc[base + i] = records[idx[i]].ccc;
+        }
+        if (mask & UNICODE_BATCH_EAST_ASIAN_WIDTH) {
+            for (size_t i = 0; i < n; i++) out->east_asian_width[base + i] = records[idx[i]].east_asian_width;
+        }
+        if (mask & UNICODE_BATCH_BIDICLASS) {
+            for (size_t i = 0; i < n; i++) out->bidiclass[base + i] = records[idx[i]].bidiclass;
+        }
+        if (mask & UNICODE_BATCH_NUMERIC) {
+            for (size_t i = 0; i < n; i++) out->numeric[base + i] = records[idx[i]].numeric_value().num();
+        }
+        if (mask & UNICODE_BATCH_BLOCK) {
+            for (size_t i = 0; i < n; i++) out->block[base + i] = records[idx[i]].block;
+        }
+    }
+    return 1;
+}
+
+size_t STDCALL get_properties_u8(HUNICODEDATA data, const char *str, size_t size, char32_t *codes, size_t capacity,
+                                 unsigned int mask, UNICODE_BATCH *out) {
+    if (!str || !codes)
+        return ~0;
+    UTFResult res;
+    if (capacity >= size) {
+        res = utf8_to_utf32(Sized<const char>{str, size}, Sized<char32_t>{codes, capacity});
+    }
+    else {
+        //validate first so that short capacity is detected before writing
+        res = utf8_validate(Sized<const char>{str, size});
+        if (res.err == 0) {
+            size_t need = 0;
+            for (size_t i = 0; i < size; i++) {
+                need += ((unsigned char)str[i] & 0xc0) != 0x80;
+            }
+            if (need > capacity)
+                return ~0;
+            res = utf_detail::utf8_to_utf32_scalar((const unsigned char *)str, size, codes);
+        }
+    }
+    if (res.err != 0)
+        return ~0;
+    auto count = res.written;
+    if (!get_properties(data, codes, count, mask, out))
+        return ~0;
+    return count;
+}
+
+//quick check validates str on the way
+const NormalizeTable *normalize_table_of(HUNICODEDATA data, int form, const char *str, size_t size, NormalizeCheck &check) {
+    if (!data || (!str && size) || form < 0 || form >= normalize_form_count)
+        return nullptr;
+    auto &table = get_normalize_table(*(UnicodeData *)data);
+    if (!table.built)
+        return nullptr;
+    UTFResult res;
+    check = table.quick_check((NormalizeForm)form, str, size, res);
+    if (res.err != 0)
+        return nullptr;
+    return &table;
+}
+
+size_t STDCALL normalize_u8(HUNICODEDATA data, int form, const char *str, size_t size, char *out, size_t capacity) {
+    NormalizeCheck check;
+    auto table = normalize_table_of(data, form, str, size, check);
+    if (!table || (!out && capacity))
+        return ~0;
+    if (check == normalize_yes) {
+        if (size <= capacity)
+            ::memcpy(out, str, size);
+        return size;
+    }
+    std::string result;
+    try {
+        table->normalize((NormalizeForm)form, str, size, result);
+    } catch (...) {
+        return ~0;
+    }
+    if (result.size() <= capacity)
+        ::memcpy(out, result.data(), result.size());
+    return result.size();
+}
+
+int STDCALL quick_check_u8(HUNICODEDATA data, int form, const char *str, size_t size) {
+    NormalizeCheck check;
+    auto table = normalize_table_of(data, form, str, size, check);
+    if (!table)
+        return -1;
+    return check;
+}
+
+int STDCALL is_normalized_u8(HUNICODEDATA data, int form, const char *str, size_t size) {
+    NormalizeCheck check;
+    auto table = normalize_table_of(data, form, str, size, check);
+    if (!table)
+        return -1;
+    if (check != normalize_maybe)
+        return check == normalize_yes;
+    std::string result;
+    try {
+        table->normalize((NormalizeForm)form, str, size, result);
+    } catch (...) {
+        return -1;
+    }
+    return result.size() == size && ::memcmp(result.data(), str, size) == 0;
+}
+
+size_t STDCALL convert_case_u8(HUNICODEDATA data, int kind, const char *str, size_t size, char *out, size_t capacity) {
+    if (!data || (!str && size) || (!out && capacity) || kind < 0 || kind >= case_kind_count)
+        return ~0;
+    auto &table = get_case_table(*(UnicodeData *)data);
+    if (!table.built || utf8_validate(Sized<const char>{str, size}).err != 0)
+        return ~0;
+    std::string result;
+    try {
+        table.convert((CaseKind)kind, str, size, result);
+    } catch (...) {
+        return ~0;
+    }
+    if (result.size() <= capacity)
+        ::memcpy(out, result.data(), result.size());
+    return result.size();
+}
+
+const GraphemeTable *grapheme_table_of(HUNICODEDATA data) {
+    if (!data)
+        return nullptr;
+    auto &table = get_grapheme_table(*(UnicodeData *)data);
+    return table.built ? &table : nullptr;
+}
+
+size_t STDCALL count_graphemes_u8(HUNICODEDATA data, const char *str, size_t size) {
+    auto table = grapheme_table_of(data);
+    if (!table || (!str && size) || utf8_validate(Sized<const char>{str, size}).err != 0)
+        return ~0;
+    return table->count(str, size);
+}
+
+size_t STDCALL next_grapheme_u8(HUNICODEDATA data, const char *str, size_t size, size_t pos) {
+    auto table = grapheme_table_of(data);
+    if (!table || (!str && size) || pos > size)
+        return ~0;
+    std::uint8_t state = grapheme_start;
+    while (pos < size) {
+        char32_t code;
+        int len;
+        if (utf_detail::utf8_decode_one((const unsigned char *)str + pos, size - pos, code, len))
+            return ~0;
+        if (table->step(state, code))
+            break;
+        pos += len;
+    }
+    return pos;
+}
+
+size_t next_segment_u8(const SegmentTable &table, const char *str, size_t size, size_t pos) {
+    if ((!str && size) || pos > size)
+        return ~0;
+    SegmentCursor cur;
+    auto found = size;
+    auto done = false;
+    auto settle = [&](size_t at) {
+        if (!done)
+            found = at;
+        done = true;
+    };
+    while (pos < size && !done) {
+        char32_t code;
+        int len;
+        if (utf_detail::utf8_decode_one((const unsigned char *)str + pos, size - pos, code, len))
+            return ~0;
+        table.step(cur, code, pos, settle);
+        pos += len;
+    }
+    if (!done)
+        table.finish(cur, settle);
+    return found;
+}
+
+size_t STDCALL next_word_u8(HUNICODEDATA data, const char *str, size_t size, size_t pos) {
+    if (!data)
+        return ~0;
+    auto &table = get_word_table(*(UnicodeData *)data);
+    return table.built ? next_segment_u8(table, str, size, pos) : ~0;
+}
+
+size_t STDCALL next_sentence_u8(HUNICODEDATA data, const char *str, size_t size, size_t pos) {
+    if (!data)
+        return ~0;
+    auto &table = get_sentence_table(*(UnicodeData *)data);
+    return table.built ? next_segment_u8(table, str, size, pos) : ~0;
+}
+
+const WidthTable *width_table_of(HUNICODEDATA data) {
+    if (!data)
+        return nullptr;
+    auto &table = get_width_table(*(UnicodeData *)data);
+    return table.built ? &table : nullptr;
+}
+
+size_t STDCALL display_width_u8(HUNICODEDATA data, const char *str, size_t size) {
+    auto table = width_table_of(data);
+    if (!table || (!str && size) || utf8_validate(Sized<const char>{str, size}).err != 0)
+        return ~0;
+    return table->width(str, size);
+}
+
+int STDCALL code_width(HUNICODEDATA data, char32_t code) {
+    auto table = width_table_of(data);
+    if (!table)
+        return -1;
+    auto width = table->get(code);
+    return width == width_control ? -1 : width;
+}
+
+const ScriptTable *script_table_of(HUNICODEDATA data) {
+    if (!data)
+        return nullptr;
+    auto &table = get_script_table(*(UnicodeData *)data);
+    return table.built ? &table : nullptr;
+}
+
+size_t STDCALL script_runs_u8(HUNICODEDATA data, const char *str, size_t size, UNICODE_SCRIPT_RUN *out, size_t capacity) {
+    auto table = script_table_of(data);
+    if (!table || (!str && size) || utf8_validate(Sized<const char>{str, size}).err != 0)
+        return ~0;
+    size_t count = 0;
+    auto add = [&](size_t begin, size_t end, std::uint16_t script) {
+        if (out && count < capacity)
+            out[count] = UNICODE_SCRIPT_RUN{begin, end, script};
+        count++;
+    };
+    ScriptCursor cur;
+    table->each_run(cur, str, size, add);
+    table->finish(cur, add);
+    return count;
+}
+
+int STDCALL code_script(HUNICODEDATA data, char32_t code) {
+    auto table = script_table_of(data);
+    if (!table || code >= codepoint_limit)
+        return -1;
+    return table->get(code);
+}
+
+char32_t case_of(CODEINFO point, std::uint32_t mapped) {
+    return mapped == (std::uint32_t)-1 ? point->real : (char32_t)mapped;
+}
+
+char32_t STDCALL get_uppercase(CODEINFO point) {
+    if (!point)
+        return ~0;
+    return case_of(point, base_of(point)->upper);
+}
+
+char32_t STDCALL get_lowercase(CODEINFO point) {
+    if (!point)
+        return ~0;
+    return case_of(point, base_of(point)->lower);
+}
+
+char32_t STDCALL get_titlecase(CODEINFO point) {
+    if (!point)
+        return ~0;
+    return case_of(point, base_of(point)->title);
 }
 
 int STDCALL
@@ -279,49 +725,75 @@ get_numeric_digit(CODEINFO point) {
     if (!point)
         return -1;
     CODEINFO_impl *info = point;
-    return info->base->numeric.v1;
+    return base_of(info)->digit;
 }
 
 int STDCALL get_numeric_decimal(CODEINFO point) {
     if (!point)
         return -1;
     CODEINFO_impl *info = point;
-    return info->base->numeric.v2;
+    return base_of(info)->decimal;
 }
 
 double STDCALL get_numeric_number(CODEINFO point) {
     if (!point)
         return NAN;
     CODEINFO_impl *info = point;
-    return info->base->numeric.num();
+    return base_of(info)->numeric_value().num();
 }
 
 const char *STDCALL get_numeric_number_str(CODEINFO point) {
     if (!point)
         return nullptr;
     CODEINFO_impl *info = point;
-    return info->v3_str.c_str();
+    if (!(info->computed & computed_numeric)) {
+        base_of(info)->numeric_value().stringify(info->numeric, sizeof(info->numeric));
+        info->computed |= computed_numeric;
+    }
+    return info->numeric;
 }
 
 const char *STDCALL get_u8str(CODEINFO point, size_t *size) {
     if (!point)
         return nullptr;
     CODEINFO_impl *info = point;
+    if (!(info->computed & computed_u8str)) {
+        U8Buffer buf{info};
+        info->u8size = 0;
+        make_utf8_from_utf32(info->real, buf);
+        info->u8str[info->u8size] = 0;
+        info->computed |= computed_u8str;
+    }
     if (size) {
-        *size = info->u8str.size();
+        *size = info->u8size;
     }
-    return info->u8str.c_str();
+    return info->u8str;
 }
 
 template <class C>
-int save_unicodedata_as_binary_impl(HUNICODEDATA data, C *filename) {
+int save_unicodedata_as_binary_impl(HUNICODEDATA data, C *filename, int version = flat_version) {
     if (!data || !filename)
         return 0;
     UnicodeData *dat = (UnicodeData *)data;
+    if (version < 1 || version > flat_version) {
+        return 0;
+    }
+    if (version < flat_version && !dat->codes.size()) {
+        return 0;
+    }
     Serializer<FileWriter> ws(filename);
     if (!ws.get().is_open())
         return 0;
-    serialize_unicodedata(ws, *dat);
+    if (version == flat_version) {
+        if (dat->mapped) {
+            return ws.get().write(dat->mapped->c_str(), dat->mapped->size());
+        }
+        if (dat->image.size()) {
+            return ws.get().write(dat->image.data(), dat->image.size());
+        }
+        return serialize_flat(ws, dat->flat);
+    }
+    serialize_unicodedata(ws, *dat, version);
     return 1;
 }
 
@@ -329,6 +801,10 @@ int STDCALL save_unicodedata_as_binary(HUNICODEDATA data, const char *filename)
     return save_unicodedata_as_binary_impl(data, filename);
 }
 
+int STDCALL save_unicodedata_as_binary_version(HUNICODEDATA data, const char *filename, int version) {
+    return save_unicodedata_as_binary_impl(data, filename, version);
+}
+
 template <class C>
 int load_text_and_save_binary_impl(C *txtfile, C *binfile) {
     if (!txtfile || !binfile) {
@@ -351,6 +827,10 @@ int STDCALL save_unicodedata_as_binaryW(HUNICODEDATA data, const wchar_t *filena
     return save_unicodedata_as_binary_impl(data, filename);
 }
 
+int STDCALL save_unicodedata_as_binary_versionW(HUNICODEDATA data, const wchar_t *filename, int version) {
+    return save_unicodedata_as_binary_impl(data, filename, version);
+}
+
 int STDCALL load_text_and_save_binaryW(const wchar_t *txtfile, const wchar_t *binfile) {
     return load_text_and_save_binary_impl(txtfile, binfile);
 }
@@ -16,11 +16,43 @@ typedef void *HUNICODEDATA;
 typedef struct CODEINFO_impl *CODEINFO;
 typedef struct _TMPBUF TMPBUF;
 
+enum UNICODE_PROPERTY {
+    UNICODE_PROPERTY_CATEGORY,
+    UNICODE_PROPERTY_BIDICLASS,
+    UNICODE_PROPERTY_EAST_ASIAN_WIDTH,
+    UNICODE_PROPERTY_BLOCK,
+    UNICODE_PROPERTY_DECOMPOSITION_ATTRIBUTE,
+    UNICODE_PROPERTY_SCRIPT,
+    UNICODE_PROPERTY_SCRIPT_EXTENSIONS,
+};
+
+typedef struct UNICODE_SCRIPT_RUN {
+    size_t begin;
+    size_t end;
+    int script;  //id of UNICODE_PROPERTY_SCRIPT
+} UNICODE_SCRIPT_RUN;
+
 #ifdef __cplusplus
 extern "C" {
 #else
 #include <uchar.h>
 #endif
+
+//borrowed view of one code point. members are internal; fill with get_codeinfo_view
+//derived strings (range names, numeric text, utf-8) are made on first use inside the view,
+//so a view must not be shared between threads
+struct CODEINFO_impl {
+    const void *base;
+    const void *table;
+    char32_t real;
+    unsigned int computed;
+    size_t u8size;
+    char u8str[8];
+    char numeric[32];
+    char name[128];
+};
+typedef struct CODEINFO_impl CODEINFO_VIEW;
+
 DLL_EXPORT HUNICODEDATA STDCALL get_default_unicodedata();
 DLL_EXPORT HUNICODEDATA STDCALL get_default_unicodedata_withpath(const char *binpath, const char *txtpath);
 DLL_EXPORT HUNICODEDATA STDCALL unicodedata_from_binary(const char *filepath);
@@ -31,6 +63,9 @@ DLL_EXPORT HUNICODEDATA STDCALL unicodedata_from_textW(const wchar_t *filepath);
 #endif
 
 DLL_EXPORT int STDCALL get_codeinfo(HUNICODEDATA data, char32_t code, CODEINFO *pinfo);
+//no allocation. pass &view to getters below; view is valid while data is alive
+//needless to call clean_codeinfo
+DLL_EXPORT int STDCALL get_codeinfo_view(HUNICODEDATA data, char32_t code, CODEINFO_VIEW *view);
 
 DLL_EXPORT char32_t get_codepoint(CODEINFO point);
 DLL_EXPORT const char *STDCALL get_charname(CODEINFO point);
@@ -47,15 +82,126 @@ DLL_EXPORT double STDCALL get_numeric_number(CODEINFO point);
 DLL_EXPORT const char *STDCALL get_numeric_number_str(CODEINFO point);
 DLL_EXPORT const char *STDCALL get_u8str(CODEINFO point, size_t *size); 
 DLL_EXPORT const char *STDCALL get_block(CODEINFO point);
+//simple (single code point) case mapping of UnicodeData.txt, or the code point itself if none
+DLL_EXPORT char32_t STDCALL get_uppercase(CODEINFO point);
+DLL_EXPORT char32_t STDCALL get_lowercase(CODEINFO point);
+DLL_EXPORT char32_t STDCALL get_titlecase(CODEINFO point);
 DLL_EXPORT void clean_codeinfo(CODEINFO *pinfo);
 
+//property values as interned ids (compare ids instead of strings)
+DLL_EXPORT int STDCALL get_category_id(CODEINFO point);
+DLL_EXPORT int STDCALL get_decompsition_attribute_id(CODEINFO point);
+DLL_EXPORT int STDCALL get_bidiclass_id(CODEINFO point);
+DLL_EXPORT int STDCALL get_east_asian_wides_id(CODEINFO point);
+DLL_EXPORT int STDCALL get_block_id(CODEINFO point);
+DLL_EXPORT int STDCALL get_property_id(HUNICODEDATA data, int kind, const char *name);
+DLL_EXPORT const char *STDCALL get_property_name(HUNICODEDATA data, int kind, int id);
+DLL_EXPORT int STDCALL get_property_count(HUNICODEDATA data, int kind);
+//code points which have property value id as sorted inclusive ranges
+//(*ranges)[2*n] is first and (*ranges)[2*n+1] is last of n-th range. borrowed from data
+DLL_EXPORT int STDCALL get_property_ranges(HUNICODEDATA data, int kind, int id, const char32_t **ranges, size_t *count);
+
+enum UNICODE_BATCH_MASK {
+    UNICODE_BATCH_CATEGORY = 0x1,
+    UNICODE_BATCH_CCC = 0x2,
+    UNICODE_BATCH_EAST_ASIAN_WIDTH = 0x4,
+    UNICODE_BATCH_BIDICLASS = 0x8,
+    UNICODE_BATCH_NUMERIC = 0x10,
+    UNICODE_BATCH_BLOCK = 0x20,
+};
+
+//parallel output arrays of batch lookup. only arrays selected by mask are written
+//unassigned code points get id 0, ccc 0 and NAN
+typedef struct UNICODE_BATCH {
+    unsigned char *category;
+    unsigned char *ccc;
+    unsigned char *east_asian_width;
+    unsigned char *bidiclass;
+    double *numeric;
+    unsigned short *block;
+} UNICODE_BATCH;
+
+DLL_EXPORT int STDCALL get_properties(HUNICODEDATA data, const char32_t *codes, size_t size, unsigned int mask, UNICODE_BATCH *out);
+//decode utf-8 str into codes (capacity>=size is always enough) then same as get_properties
+//str is validated strictly (no overlong, surrogate or >U+10FFFF) by the simd kernel chosen at run time
+//returns count of code points or (size_t)-1 if str is not valid utf-8 or capacity is short
+DLL_EXPORT size_t STDCALL get_properties_u8(HUNICODEDATA data, const char *str, size_t size, char32_t *codes, size_t capacity,
+                                            unsigned int mask, UNICODE_BATCH *out);
+
+enum UNICODE_NORMALIZE_FORM {
+    UNICODE_NFC,
+    UNICODE_NFD,
+    UNICODE_NFKC,
+    UNICODE_NFKD,
+};
+
+enum UNICODE_QUICK_CHECK {
+    UNICODE_QC_YES,
+    UNICODE_QC_NO,
+    UNICODE_QC_MAYBE,
+};
+
+//normalize utf-8 str to form (UNICODE_NFC...). tables are built from data on first call
+//returns bytes of normalized text, which is written to out only if it fits capacity
+//(call with capacity 0 to get size), or (size_t)-1 if str is not valid utf-8 or form is unknown
+DLL_EXPORT size_t STDCALL normalize_u8(HUNICODEDATA data, int form, const char *str, size_t size, char *out, size_t capacity);
+//UNICODE_QC_* of str without normalizing, or -1 on error like normalize_u8
+DLL_EXPORT int STDCALL quick_check_u8(HUNICODEDATA data, int form, const char *str, size_t size);
+//1 if str is in form, 0 if not, -1 on error. normalizes only if quick check is maybe
+DLL_EXPORT int STDCALL is_normalized_u8(HUNICODEDATA data, int form, const char *str, size_t size);
+
+enum UNICODE_CASE {
+    UNICODE_CASE_LOWER,
+    UNICODE_CASE_UPPER,
+    UNICODE_CASE_TITLE,
+    UNICODE_CASE_FOLD,
+    UNICODE_CASE_FOLD_SIMPLE,
+};
+
+//convert case of utf-8 str by kind (UNICODE_CASE_*) with full mappings of SpecialCasing.txt and
+//CaseFolding.txt if data has them (binary version 5). folding is lowercasing without CaseFolding.txt
+//returns bytes like normalize_u8, or (size_t)-1 if str is not valid utf-8 or kind is unknown
+DLL_EXPORT size_t STDCALL convert_case_u8(HUNICODEDATA data, int kind, const char *str, size_t size, char *out, size_t capacity);
+
+//extended grapheme clusters of UAX #29 with GraphemeBreakProperty.txt and emoji-data.txt if data has them
+//(binary version 5), otherwise with break properties guessed from general category
+//count of clusters in utf-8 str, or (size_t)-1 if str is not valid utf-8
+DLL_EXPORT size_t STDCALL count_graphemes_u8(HUNICODEDATA data, const char *str, size_t size);
+//offset of the end of the cluster which begins at str[pos], or (size_t)-1 if the cluster is not valid utf-8.
+//only the cluster is decoded, so iterating whole str by this is linear
+DLL_EXPORT size_t STDCALL next_grapheme_u8(HUNICODEDATA data, const char *str, size_t size, size_t pos);
+
+//word and sentence boundaries of UAX #29 with WordBreakProperty.txt and SentenceBreakProperty.txt if data has them
+//(binary version 5), otherwise with break properties guessed from general category.
+//offset of the end of the segment which begins at str[pos], or (size_t)-1 if the segment is not valid utf-8.
+//pos should be a boundary. decoding stops at the first settled boundary, so iterating whole str by this is linear
+//except where WB6, WB7b, WB12 or SB8 look ahead
+DLL_EXPORT size_t STDCALL next_word_u8(HUNICODEDATA data, const char *str, size_t size, size_t pos);
+DLL_EXPORT size_t STDCALL next_sentence_u8(HUNICODEDATA data, const char *str, size_t size, size_t pos);
+
+//columns of utf-8 str in terminals. East_Asian_Width W and F (and Emoji_Presentation if data has emoji-data.txt)
+//take 2 columns, combining marks, format and control characters none, and others 1.
+//returns (size_t)-1 if str is not valid utf-8
+DLL_EXPORT size_t STDCALL display_width_u8(HUNICODEDATA data, const char *str, size_t size);
+//columns of code like wcwidth: 0, 1, 2 or -1 for control characters
+DLL_EXPORT int STDCALL code_width(HUNICODEDATA data, char32_t code);
+
+//maximal same-script runs of utf-8 str with Scripts.txt and ScriptExtensions.txt (binary version 5).
+//Common and Inherited characters join the surrounding run. runs are written to out up to capacity.
+//returns count of runs, or (size_t)-1 if str is not valid utf-8 or data has no scripts
+DLL_EXPORT size_t STDCALL script_runs_u8(HUNICODEDATA data, const char *str, size_t size, UNICODE_SCRIPT_RUN *out, size_t capacity);
+//Script of code as id of UNICODE_PROPERTY_SCRIPT, or -1 if data has no scripts
+DLL_EXPORT int STDCALL code_script(HUNICODEDATA data, char32_t code);
+
 DLL_EXPORT void STDCALL release_unicodedata(HUNICODEDATA f);
 
 DLL_EXPORT int STDCALL save_unicodedata_as_binary(HUNICODEDATA data, const char *filename);
+DLL_EXPORT int STDCALL save_unicodedata_as_binary_version(HUNICODEDATA data, const char *filename, int version);
 DLL_EXPORT int STDCALL load_text_and_save_binary(const char *txtfile, const char *binfile);
 
 #ifdef _WIN32
 DLL_EXPORT int STDCALL save_unicodedata_as_binaryW(HUNICODEDATA data, const wchar_t *filename);
+DLL_EXPORT int STDCALL save_unicodedata_as_binary_versionW(HUNICODEDATA data, const wchar_t *filename, int version);
 DLL_EXPORT int STDCALL load_text_and_save_binaryW(const wchar_t *txtfile, const wchar_t *binfile);
 #endif
 
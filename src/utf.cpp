@@ -1,7 +1,9 @@
 #include <argvlib.h>
 #include <extutil.h>
 
-#include <iomanip>
+#include <utf_bulk.h>
+
+#include <cstring>
 
 #include "common.h"
 
@@ -12,61 +14,194 @@ struct FormatFlags {
     bool space = true;
     bool raw = false;
     bool decimal = false;
+    bool lossy = false;
 };
 
-template <class C>
-void print_as_command(const C& str, std::string& cmd, FormatFlags& flags) {
+void print_line() {
+#ifdef COMMONLIB2_IS_UNIX_LIKE
+    Cout << "\n";
+#endif
+}
+
+//two digit tables: hexpair[c] is c in two hex digits, decpair[c] (c<100) in two decimal digits
+struct DigitTable {
+    char hexpair[256][2];
+    char decpair[100][2];
+
+    constexpr DigitTable()
+        : hexpair(), decpair() {
+        constexpr const char* hex = "0123456789abcdef";
+        for (auto i = 0; i < 256; i++) {
+            hexpair[i][0] = hex[i >> 4];
+            hexpair[i][1] = hex[i & 0xf];
+        }
+        for (auto i = 0; i < 100; i++) {
+            decpair[i][0] = '0' + i / 10;
+            decpair[i][1] = '0' + i % 10;
+        }
+    }
+};
+
+constexpr DigitTable digit_table;
+
+//renders code units into a block buffer and hands full blocks to Cout
+struct UnitFormatter {
+    static constexpr size_t block = 1 << 16;
+    //longest unit: " 0x" + 10 decimal digits
+    static constexpr size_t max_unit = 16;
+    FormatFlags& flags;
+    char buf[block];
+    size_t len = 0;
     bool first = true;
-    auto print_prefix = [&] {
-        if (flags.space && !first) {
-            Cout << " ";
+
+    UnitFormatter(FormatFlags& flags)
+        : flags(flags) {}
+
+    ~UnitFormatter() {
+        flush();
+    }
+
+    void flush() {
+        if (len) {
+            Cout.write(buf, len);
+            len = 0;
         }
-        if (flags.prefix) {
-            Cout << "0x";
+    }
+
+    void put_hex(std::uint32_t c, int bytes) {
+        auto p = buf + len;
+        for (auto i = bytes - 1; i >= 0; i--) {
+            auto& pair = digit_table.hexpair[(c >> (i * 8)) & 0xff];
+            *p++ = pair[0];
+            *p++ = pair[1];
         }
-    };
-    if (cmd == "utf8") {
-        std::string tmp;
-        Reader(str) >> tmp;
-        for (auto& c : tmp) {
-            print_prefix();
-            if (!flags.decimal) {
-                Cout << std::setfill('0') << std::hex << std::setw(2);
+        len = p - buf;
+    }
+
+    void put_decimal(std::uint32_t c) {
+        char tmp[10];
+        auto p = tmp + sizeof(tmp);
+        while (c >= 100) {
+            auto& pair = digit_table.decpair[c % 100];
+            c /= 100;
+            *--p = pair[1];
+            *--p = pair[0];
+        }
+        if (c >= 10) {
+            *--p = digit_table.decpair[c][1];
+            *--p = digit_table.decpair[c][0];
+        }
+        else {
+            *--p = '0' + c;
+        }
+        auto size = tmp + sizeof(tmp) - p;
+        ::memcpy(buf + len, p, size);
+        len += size;
+    }
+
+    template <class C>
+    void put(const C* p, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            if (len + max_unit > block) {
+                flush();
+            }
+            if (flags.space && !first) {
+                buf[len++] = ' ';
+            }
+            if (flags.prefix) {
+                buf[len++] = '0';
+                buf[len++] = 'x';
+            }
+            if (flags.decimal) {
+                put_decimal((std::uint32_t)p[i]);
+            }
+            else {
+                put_hex((std::uint32_t)p[i], sizeof(C));
             }
-            Cout << (unsigned int)(unsigned char)c;
             first = false;
         }
     }
+};
+
+template <class C>
+void print_as_command(const C& str, std::string& cmd, FormatFlags& flags) {
+    UnitFormatter out(flags);
+    if (cmd == "utf8") {
+        std::string tmp;
+        Reader(str) >> tmp;
+        out.put((const unsigned char*)tmp.data(), tmp.size());
+    }
     else if (cmd == "utf16") {
         std::u16string tmp;
         Reader(str) >> tmp;
-        for (auto& c : tmp) {
-            print_prefix();
-            if (!flags.decimal) {
-                Cout << std::setfill('0') << std::hex << std::setw(4);
-            }
-            Cout << (unsigned int)c;
-            first = false;
-        }
+        out.put(tmp.data(), tmp.size());
     }
     else if (cmd == "utf32") {
         std::u32string tmp;
         Reader(str) >> tmp;
-        for (auto& c : tmp) {
-            print_prefix();
-            if (!flags.decimal) {
-                Cout << std::setfill('0') << std::hex << std::setw(8);
+        out.put(tmp.data(), tmp.size());
+    }
+}
+
+//read utf-8 words from fp by blocks and print them without holding whole input
+int outputstream(std::string& cmd, FILE* fp, FormatFlags& flags) {
+    std::string clean;
+    std::u16string u16;
+    std::u32string u32;
+    UTFErrorReport report;
+    UnitFormatter out(flags);
+    auto ret = read_utf8_blocks(
+        fp, [&](const char* in, size_t len, size_t offset, bool) {
+            report.base = offset;
+            if (flags.raw || cmd == "utf8") {
+                auto text = in;
+                auto textlen = len;
+                if (flags.lossy) {
+                    clean.resize(utf_replace_bound(len, 1, 1));
+                    textlen = utf_transcode_replace(in, len, &clean[0], clean.size(), report).written;
+                    text = clean.data();
+                }
+                if (flags.raw) {
+                    out.flush();
+                    Cout.write(text, textlen);
+                }
+                else {
+                    out.put((const unsigned char*)text, textlen);
+                }
             }
-            Cout << (unsigned int)c;
-            first = false;
-        }
+            else if (cmd == "utf16") {
+                u16.resize(len + 1);
+                auto res = flags.lossy ? utf_transcode_replace(in, len, &u16[0], u16.size(), report)
+                                       : utf_transcode(in, len, &u16[0], u16.size());
+                out.put(u16.data(), res.written);
+            }
+            else {
+                u32.resize(len + 1);
+                auto res = flags.lossy ? utf_transcode_replace(in, len, &u32[0], u32.size(), report)
+                                       : utf_transcode(in, len, &u32[0], u32.size());
+                out.put(u32.data(), res.written);
+            }
+            return len;
+        },
+        flags.lossy);
+    out.flush();
+    if (ret == 0) {
+        print_replace_report(report, 1);
     }
+    return ret;
 }
 
-void print_line() {
-#ifdef COMMONLIB2_IS_UNIX_LIKE
-    Cout << "\n";
-#endif
+int outputfile(std::string& cmd, const std::string& name, FormatFlags& flags) {
+    auto fp = open_input(name);
+    if (!fp) {
+        return -1;
+    }
+    auto ret = outputstream(cmd, fp, flags);
+    close_input(fp);
+    if (ret == 0) {
+        print_line();
+    }
+    return ret;
 }
 
 void outputword(std::string& cmd, int& i, int argc, char** argv, FormatFlags& flags) {
@@ -171,6 +306,7 @@ int show_code(std::string& cmd, int& i, int argc, char** argv, FormatFlags& flag
     }
     std::u32string converted;
     int err = 0;
+    UTFErrorReport report;
     if (from == "utf8") {
         std::string u8str;
         for (; i < argc; i++) {
@@ -187,7 +323,14 @@ int show_code(std::string& cmd, int& i, int argc, char** argv, FormatFlags& flag
             }
             u8str.push_back((unsigned char)code);
         }
-        Reader(std::move(u8str)).readwhile(converted, utf8toutf32, &err);
+        if (flags.lossy) {
+            converted.resize(u8str.size());
+            auto res = utf_transcode_replace(u8str.data(), u8str.size(), &converted[0], converted.size(), report);
+            converted.resize(res.written);
+        }
+        else {
+            Reader(std::move(u8str)).readwhile(converted, utf8toutf32, &err);
+        }
         if (err) {
             Clog << "error: invalid utf8 codes. error at: " << err << "\n";
             return -1;
@@ -209,7 +352,14 @@ int show_code(std::string& cmd, int& i, int argc, char** argv, FormatFlags& flag
             }
             u16str.push_back(code);
         }
-        Reader(std::move(u16str)).readwhile(converted, utf16toutf32, &err);
+        if (flags.lossy) {
+            converted.resize(u16str.size());
+            auto res = utf_transcode_replace(u16str.data(), u16str.size(), &converted[0], converted.size(), report);
+            converted.resize(res.written);
+        }
+        else {
+            Reader(std::move(u16str)).readwhile(converted, utf16toutf32, &err);
+        }
         if (err) {
             Clog << "error: invalid utf16 codes. error at: " << err << "\n";
             return -1;
@@ -235,6 +385,7 @@ int show_code(std::string& cmd, int& i, int argc, char** argv, FormatFlags& flag
         Clog << "error:invalid UTF name:" << from << "\n";
         return -1;
     }
+    print_replace_report(report, 1);
     if (flags.raw) {
         std::string tmp;
         Reader(converted) >> tmp;
@@ -273,6 +424,7 @@ int show_range(std::string& cmd, int& i, int argc, char** argv, FormatFlags& fla
 int utfshow(std::string& cmd, int argc, char** argv, int i) {
     bool ok = false;
     bool output = false;
+    std::string input;
     FormatFlags flags;
     for (; i < argc; i++) {
         if (argv[i][0] == '-') {
@@ -295,6 +447,14 @@ int utfshow(std::string& cmd, int argc, char** argv, int i) {
                 else if (!flags.decimal && c == 'd') {
                     flags.decimal = true;
                 }
+                else if (!flags.lossy && c == 'l') {
+                    flags.lossy = true;
+                }
+                else if (!input.size() && c == 'i') {
+                    if (!get_morearg(input, i, argc, argv)) {
+                        return -1;
+                    }
+                }
                 else {
                     Clog << "warning: ignored '" << c << "'\n";
                 }
@@ -311,6 +471,9 @@ int utfshow(std::string& cmd, int argc, char** argv, int i) {
     std::string arg = argv[i];
     i++;
     if (arg == "word") {
+        if (input.size()) {
+            return outputfile(cmd, input, flags);
+        }
         outputword(cmd, i, argc, argv, flags);
     }
     else if (arg == "code") {
@@ -0,0 +1,59 @@
+#include <unicodedata.h>
+
+#include <cstdio>
+
+#include "common.h"
+
+using namespace commonlib2;
+
+//print width of each line of utf-8 from fp. a line can span blocks
+int width_stream(const WidthTable &table, FILE *fp) {
+    size_t line = 0;
+    bool pending = false;
+    auto ret = read_utf8_blocks(fp, [&](const char *in, size_t len, size_t, bool) {
+        for (size_t begin = 0; begin < len;) {
+            auto found = (const char *)::memchr(in + begin, '\n', len - begin);
+            auto end = found ? found - in : len;
+            line += table.width(in + begin, end - begin);
+            pending = true;
+            if (!found) break;
+            Cout << line << "\n";
+            line = 0;
+            pending = false;
+            begin = end + 1;
+        }
+        return len;
+    });
+    if (ret < 0) {
+        return ret;
+    }
+    if (pending) {
+        Cout << line << "\n";
+    }
+    return 0;
+}
+
+int width_text(int argc, char **argv, int i) {
+    TextOptions opt;
+    if (!parse_text_options(i, argc, argv, opt)) {
+        return -1;
+    }
+    if (!opt.input.size() && i >= argc) {
+        Clog << "error: need more argument\n";
+        return -1;
+    }
+    const WidthTable *table = nullptr;
+    TextCommand cmd;
+    cmd.failure = "failed to build width table";
+    cmd.load = [&](UnicodeData &data) {
+        table = &get_width_table(data);
+        return table->built;
+    };
+    cmd.stream = [&](FILE *fp) {
+        return width_stream(*table, fp);
+    };
+    cmd.word = [&](const char *str, size_t size) {
+        Cout << table->width(str, size) << "\n";
+    };
+    return run_text_command(opt, i, argc, argv, cmd);
+}
@@ -0,0 +1,198 @@
+//transition tables of SegmentTable against the plain rules of UAX #29 evaluated one by one at each position,
+//looking behind and ahead over classes. text is fed as code points whose values are break classes
+#include <unicodedata.h>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace commonlib2;
+
+bool is_word_newline(std::uint8_t c) {
+    return c == wb_cr || c == wb_lf || c == wb_newline;
+}
+
+bool word_ignorable(std::uint8_t c) {
+    return c == wb_extend || c == wb_format || c == wb_zwj;
+}
+
+bool word_mid(std::uint8_t c) {
+    return c == wb_midnumlet || c == wb_single_quote;
+}
+
+//index of the code point which rules see before i (WB4). -1 if none
+ptrdiff_t word_prev(const std::vector<std::uint8_t> &cls, ptrdiff_t i) {
+    auto j = i - 1;
+    while (j >= 0 && word_ignorable(cls[j])) {
+        j--;
+    }
+    if (j < 0 || is_word_newline(cls[j])) return i - 1;
+    return j;
+}
+
+//class of the code point which rules see after i (WB4). word_break_count if none
+int word_next(const std::vector<std::uint8_t> &cls, size_t i) {
+    for (i++; i < cls.size(); i++) {
+        if (!word_ignorable(cls[i])) return cls[i];
+    }
+    return word_break_count;
+}
+
+bool word_break_at(const std::vector<std::uint8_t> &cls, size_t i) {
+    auto a = cls[i - 1], b = cls[i];
+    if (a == wb_cr && b == wb_lf) return false;                                                     //WB3
+    if (is_word_newline(a) || is_word_newline(b)) return true;                                            //WB3a, WB3b
+    if (a == wb_zwj && (b == wb_extended_pictographic || b == wb_aletter_pictographic)) return false;  //WB3c
+    if (a == wb_wsegspace && b == wb_wsegspace) return false;                                       //WB3d
+    if (word_ignorable(b)) return false;                                                            //WB4
+    auto p = word_prev(cls, i);
+    auto pp = word_prev(cls, p);
+    int prev = cls[p];
+    int before = pp >= 0 ? cls[pp] : word_break_count;
+    auto after = word_next(cls, i);
+    if (is_ahletter(prev) && is_ahletter(b)) return false;                                               //WB5
+    if (is_ahletter(prev) && (b == wb_midletter || word_mid(b)) && is_ahletter(after)) return false;     //WB6
+    if (is_ahletter(before) && (prev == wb_midletter || word_mid(prev)) && is_ahletter(b)) return false;  //WB7
+    if (prev == wb_hebrew_letter && b == wb_single_quote) return false;                                  //WB7a
+    if (prev == wb_hebrew_letter && b == wb_double_quote && after == wb_hebrew_letter) return false;      //WB7b
+    if (before == wb_hebrew_letter && prev == wb_double_quote && b == wb_hebrew_letter) return false;     //WB7c
+    if (prev == wb_numeric && b == wb_numeric) return false;                                             //WB8
+    if (is_ahletter(prev) && b == wb_numeric) return false;                                              //WB9
+    if (prev == wb_numeric && is_ahletter(b)) return false;                                              //WB10
+    if (before == wb_numeric && (prev == wb_midnum || word_mid(prev)) && b == wb_numeric) return false;  //WB11
+    if (prev == wb_numeric && (b == wb_midnum || word_mid(b)) && after == wb_numeric) return false;      //WB12
+    if (prev == wb_katakana && b == wb_katakana) return false;                                           //WB13
+    if ((is_ahletter(prev) || prev == wb_numeric || prev == wb_katakana || prev == wb_extendnumlet) &&
+        b == wb_extendnumlet) {
+        return false;  //WB13a
+    }
+    if (prev == wb_extendnumlet && (is_ahletter(b) || b == wb_numeric || b == wb_katakana)) return false;  //WB13b
+    if (prev == wb_regional_indicator && b == wb_regional_indicator) {
+        size_t count = 0;
+        for (auto q = p; q >= 0 && cls[q] == wb_regional_indicator; q = word_prev(cls, q)) {
+            count++;
+        }
+        if (count % 2) return false;  //WB15, WB16
+    }
+    return true;  //WB999
+}
+
+bool is_parasep(std::uint8_t c) {
+    return c == sb_cr || c == sb_lf || c == sb_sep;
+}
+
+bool sentence_ignorable(std::uint8_t c) {
+    return c == sb_extend || c == sb_format;
+}
+
+//index of the code point which rules see before i (SB5). -1 if none
+ptrdiff_t sentence_prev(const std::vector<std::uint8_t> &cls, ptrdiff_t i) {
+    auto j = i - 1;
+    while (j >= 0 && sentence_ignorable(cls[j])) {
+        j--;
+    }
+    if (j < 0 || is_parasep(cls[j])) return i - 1;
+    return j;
+}
+
+bool sentence_break_at(const std::vector<std::uint8_t> &cls, size_t i) {
+    auto a = cls[i - 1], b = cls[i];
+    if (a == sb_cr && b == sb_lf) return false;  //SB3
+    if (is_parasep(a)) return true;        //SB4
+    if (sentence_ignorable(b)) return false;     //SB5
+    auto p = sentence_prev(cls, i);
+    if (cls[p] == sb_aterm && b == sb_numeric) return false;  //SB6
+    if (cls[p] == sb_aterm && b == sb_upper) {
+        auto pp = sentence_prev(cls, p);
+        if (pp >= 0 && (cls[pp] == sb_upper || cls[pp] == sb_lower)) return false;  //SB7
+    }
+    auto q = p;
+    auto spaced = false;
+    while (q >= 0 && cls[q] == sb_sp) {
+        q = sentence_prev(cls, q);
+        spaced = true;
+    }
+    while (q >= 0 && cls[q] == sb_close) {
+        q = sentence_prev(cls, q);
+    }
+    if (q < 0 || (cls[q] != sb_aterm && cls[q] != sb_sterm)) return false;  //SB998
+    if (cls[q] == sb_aterm) {
+        for (auto k = i; k < cls.size(); k++) {
+            auto c = cls[k];
+            if (c == sb_lower) return false;  //SB8
+            if (is_parasep(c) || c == sb_oletter || c == sb_upper || c == sb_aterm || c == sb_sterm) break;
+        }
+    }
+    if (b == sb_scontinue || b == sb_aterm || b == sb_sterm) return false;        //SB8a
+    if (!spaced && (b == sb_close || b == sb_sp || is_parasep(b))) return false;  //SB9
+    if (b == sb_sp || is_parasep(b)) return false;                           //SB10
+    return true;                                                                   //SB11
+}
+
+std::vector<size_t> rule_boundaries(bool word, const std::vector<std::uint8_t> &cls) {
+    std::vector<size_t> ret;
+    for (size_t i = 1; i < cls.size(); i++) {
+        if (word ? word_break_at(cls, i) : sentence_break_at(cls, i)) {
+            ret.push_back(i);
+        }
+    }
+    return ret;
+}
+
+std::vector<size_t> table_boundaries(const SegmentTable &table, const std::vector<std::uint8_t> &cls) {
+    std::u32string text(cls.begin(), cls.end());
+    std::vector<size_t> ret;
+    SegmentCursor cur;
+    auto add = [&](size_t at) {
+        ret.push_back(at);
+    };
+    table.boundaries(cur, text.data(), text.size(), add);
+    table.finish(cur, add);
+    return ret;
+}
+
+//table which maps code point c to class c
+SegmentTable class_table(bool word) {
+    SegmentTable table;
+    table.machine = word ? &word_machine : &sentence_machine;
+    std::vector<std::uint8_t> classes(codepoint_limit, 0);
+    for (int c = 0; c < table.machine->classes; c++) {
+        classes[c] = (std::uint8_t)c;
+    }
+    table.classes.build(classes);
+    table.built = true;
+    return table;
+}
+
+int check(bool word) {
+    auto table = class_table(word);
+    auto classes = table.machine->classes;
+    std::mt19937 engine(word ? 29 : 30);
+    std::vector<std::uint8_t> cls;
+    auto failed = 0;
+    for (size_t run = 0; run < 200000 && failed < 5; run++) {
+        //few classes per sequence so that rules spanning several code points match often
+        std::uint8_t pick[4];
+        for (auto &p : pick) {
+            p = (std::uint8_t)(engine() % classes);
+        }
+        cls.resize(1 + engine() % 12);
+        for (auto &c : cls) {
+            c = engine() % 3 ? pick[engine() % 4] : (std::uint8_t)(engine() % classes);
+        }
+        auto expected = rule_boundaries(word, cls);
+        if (table_boundaries(table, cls) != expected) {
+            ::printf("%s boundaries differ for classes", word ? "word" : "sentence");
+            for (auto c : cls) {
+                ::printf(" %d", c);
+            }
+            ::printf("\n");
+            failed++;
+        }
+    }
+    return failed;
+}
+
+int main() {
+    return check(true) + check(false) ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+//random access into ToUTF32 with checkpoint index, mixing positions past the end with ones inside
+#include <utfreader.h>
+
+#include <cstdio>
+#include <string>
+
+using namespace commonlib2;
+
+int check(const std::string& text, const std::u32string& expect, size_t interval) {
+    ToUTF32<std::string> codes(text, interval);
+    auto failed = 0;
+    auto at = [&](size_t pos) {
+        auto want = pos < expect.size() ? expect[pos] : char32_t();
+        auto got = codes[pos];
+        if (got != want) {
+            ::printf("interval %zu: [%zu] is %x, expected %x\n", interval, pos, (unsigned)got, (unsigned)want);
+            failed++;
+        }
+    };
+    //past the end before size is known, then back to the start
+    at(expect.size());
+    at(0);
+    at(expect.size() + 5);
+    at(expect.size() - 1);
+    for (size_t pos = 0; pos <= expect.size() + 1; pos++) {
+        at(pos);
+        at(expect.size());
+        at(pos / 2);
+    }
+    for (size_t pos = expect.size() + 1; pos-- > 0;) {
+        at(pos);
+    }
+    if (codes.size() != expect.size()) {
+        ::printf("interval %zu: size is %zu, expected %zu\n", interval, codes.size(), expect.size());
+        failed++;
+    }
+    return failed;
+}
+
+int main() {
+    std::string text = "abc\xe3\x81\x82" "def\xf0\x9f\x98\x80" "ghi\xc3\xa9" "jk";
+    std::u32string expect = U"abc\u3042def\U0001F600ghi\u00e9jk";
+    auto failed = 0;
+    for (size_t interval = 1; interval <= expect.size() + 1; interval++) {
+        failed += check(text, expect, interval);
+    }
+    return failed ? 1 : 0;
+}